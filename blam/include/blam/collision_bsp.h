@@ -165,6 +165,126 @@ struct blam_collision_bsp_test_vector_result
   } leaves;
 }; BLAM_ASSERT_SIZE(struct blam_collision_bsp_test_vector_result, 0x418);
 
+/**
+ * \brief (NON-VANILLA) A single intersection of a vector with a collision BSP.
+ *
+ * Holds the same as the leading fields of 
+ * `struct blam_collision_bsp_test_vector_result`, without the leaves visited.
+ */
+struct blam_collision_bsp_test_vector_hit
+{
+  blam_real     fraction;   ///< The relative distance to the intersection.
+  blam_plane3d *last_split; ///< The splitting plane of the intersection.
+
+  struct blam_collision_surface_result surface; ///< The intersected surface.
+};
+
+/**
+ * \brief (NON-VANILLA) Counts the work done by BSP leak mitigations against a 
+ *        budget, since it was made.
+ */
+struct blam_collision_bsp_budget_stats
+{
+  blam_long attempt_count;   ///< The number of leak resolutions attempted.
+  blam_long visit_count;     ///< The number of nodes, candidates and leaves they
+                             ///< visited.
+  blam_long exhausted_count; ///< The number of tests whose budget ran out.
+  blam_long tick_count;      ///< The number of ticks begun.
+};
+
+/**
+ * \brief (NON-VANILLA) Bounds the work BSP leak mitigations may do, per test and
+ *        per tick.
+ *
+ * Every attempt to resolve a BSP leak is charged, as is every visit the attempt
+ * makes: each node up the path, each node descended by the search for the leaf
+ * across a split, each candidate tried, and each leaf searched for a surface. Once either the test or the tick runs
+ * out of budget, further leaks are allowed to occur, as they would in Halo. 
+ * Limits are negative if there is none.
+ *
+ * A budget is written by the tests it is charged by, so it may not be used by 
+ * several threads at once.
+ */
+struct blam_collision_bsp_budget
+{
+  blam_long query_attempts; ///< The most leak resolutions per test.
+  blam_long query_visits;   ///< The most visits per test.
+  blam_long tick_attempts;  ///< The most leak resolutions per tick.
+  blam_long tick_visits;    ///< The most visits per tick.
+  
+  blam_long tick_attempts_left; ///< The leak resolutions left to the current tick.
+  blam_long tick_visits_left;   ///< The visits left to the current tick.
+  
+  struct blam_collision_bsp_budget_stats stats; ///< The work done.
+};
+
+/**
+ * \brief (NON-VANILLA) Controls the mitigations applied by BSP-vector 
+ *        intersection tests.
+ *
+ * A configuration is only read by the tests it is passed to, so tests with 
+ * different configurations may run at the same time; unless they share a budget.
+ */
+struct blam_collision_bsp_config
+{
+  blam_bool mitigate_phantom_bsp; ///< If set, suspected phantom BSP is validated,
+                                  ///< and rejected if a BSP leak follows.
+  blam_bool mitigate_bsp_leaks;   ///< If set, BSP leaks are resolved where possible.
+  
+  struct blam_collision_bsp_budget *budget; ///< If not `NULL`, bounds the work of
+                                            ///< resolving BSP leaks.
+};
+
+/**
+ * \brief (NON-VANILLA) The configuration used by tests that do not take one; all
+ *        mitigations are applied.
+ */
+extern const struct blam_collision_bsp_config blam_collision_bsp_default_config;
+
+/**
+ * \brief (NON-VANILLA) Carries the location of a vector in a collision BSP over to
+ *        the next BSP-vector intersection test.
+ *
+ * Callers whose vectors start near where their previous vector ended can pass the
+ * same token to each test, so that the top levels of the BSP are not tested again.
+ * The token is opaque; zero-initialize it before its first use. A token made 
+ * against another BSP is ignored.
+ */
+struct blam_collision_bsp_coherence
+{
+  const struct blam_collision_bsp *bsp; ///< The BSP the token was made against.
+
+  blam_real3d center; ///< The end of the previous vector.
+  blam_real   radius; ///< The radius of a ball around #center within the region 
+                      ///< of #node, or `-1` if the token is not usable.
+
+  blam_index_long node;        ///< The deepest node the previous vector was within.
+                               ///< If negative, the (unsanitized) leaf index.
+  blam_long       depth;       ///< The number of nodes in #path.
+  blam_index_long path[0x100]; ///< The nodes on the path to #node, from the root.
+};
+
+/**
+ * \brief (NON-VANILLA) Makes a mitigation budget, and begins its first tick.
+ *
+ * \param [out] budget         The budget.
+ * \param [in]  query_attempts The most leak resolutions per test, or negative.
+ * \param [in]  query_visits   The most visits per test, or negative.
+ * \param [in]  tick_attempts  The most leak resolutions per tick, or negative.
+ * \param [in]  tick_visits    The most visits per tick, or negative.
+ */
+void blam_collision_bsp_budget_init(
+  struct blam_collision_bsp_budget *budget,
+  blam_long                         query_attempts,
+  blam_long                         query_visits,
+  blam_long                         tick_attempts,
+  blam_long                         tick_visits);
+
+/**
+ * \brief (NON-VANILLA) Begins a new tick, restoring the budget of the tick.
+ */
+void blam_collision_bsp_budget_begin_tick(struct blam_collision_bsp_budget *budget);
+
 /**
  * \brief Finds the leaf of a collision BSP containing \a point.
  *
@@ -181,6 +301,29 @@ blam_index_long blam_collision_bsp_search(
   blam_index_long                  root,
   const blam_real3d               *point);
 
+/**
+ * \brief (NON-VANILLA) Searches a BSP for the leaf containing a point, starting
+ *        from the leaf found by the previous search.
+ *
+ * When acceleration data is attached to \a bsp, the leaf in \a location is 
+ * tested against the splits that bound it, and kept if the point is still in 
+ * it. Otherwise, or on a miss, this falls back to #blam_collision_bsp_search.
+ * The result is always the same as that of #blam_collision_bsp_search.
+ *
+ * \param [in]     bsp      The BSP to search.
+ * \param [in]     point    The point to search for.
+ * \param [in,out] location The location of the previous point. Supply a leaf
+ *                          of `-1` for the first search. Only the leaf is
+ *                          read or written.
+ *
+ * \return The index of the leaf containing \a point, or 
+ *         `-1` if \a point is not enclosed within \a bsp.
+ */
+blam_index_long blam_collision_bsp_search_incremental(
+  const struct blam_collision_bsp *bsp,
+  const blam_real3d               *point,
+  struct blam_structure_location  *location);
+
 /**
  * \brief Searches a BSP2D subtree for the surface containing a point.
  *
@@ -219,6 +362,220 @@ blam_bool blam_collision_bsp_test_vector(
   blam_flags_long                  flags, // enum blam_collision_test_flags
   struct blam_collision_bsp_test_vector_result *data);
 
+/**
+ * \brief (NON-VANILLA) Tests a vector against a collision BSP, with the given 
+ *        mitigations.
+ *
+ * With no \a data, this serves line-of-sight and visibility checks. The traversal
+ * is the same either way: it already stops at the first surface it commits, and 
+ * whether a surface is committed can hinge on what lies behind it, as a surface 
+ * suspected to be phantom BSP is only rejected by a BSP leak that follows it. 
+ * Only the stores of the result are saved.
+ *
+ * \param [in]  config             The mitigations to apply.
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  origin             The starting point of the vector.
+ * \param [in]  delta              The vector endpoint, relative to \a origin.
+ * \param [in]  max_scale          The proportional distance of \a origin to search.
+ * \param [in]  flags              See `enum blam_collision_test_flags`.
+ * \param [out] data               Receives the intersection result, or `NULL` if
+ *                                 only the fact of an intersection is needed.
+ *
+ * \return `true` if an intersection occurred, otherwise `false`.
+ */
+blam_bool blam_collision_bsp_test_vector_configured(
+  const struct blam_collision_bsp_config *config,
+  const struct blam_collision_bsp        *bsp,
+  struct blam_bit_vector                  breakable_surfaces,
+  const blam_real3d                      *origin,
+  const blam_real3d                      *delta,
+  blam_real                               max_scale,
+  blam_flags_long                         flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_result *data);
+
+/**
+ * \brief (NON-VANILLA) Tests a vector against a collision BSP, starting from where 
+ *        a previous test left off.
+ *
+ * The result is the same as that of #blam_collision_bsp_test_vector. If the vector
+ * is within the region \a coherence was left at, the traversal starts there 
+ * instead of at the root. Either way, \a coherence is updated for the next test.
+ *
+ * \param [in]     bsp                The collision BSP to test against.
+ * \param [in]     breakable_surfaces The breakable surfaces state.
+ * \param [in]     origin             The starting point of the vector.
+ * \param [in]     delta              The vector endpoint, relative to \a origin.
+ * \param [in]     max_scale          The proportional distance of \a origin to search.
+ * \param [in]     flags              See `enum blam_collision_test_flags`.
+ * \param [in,out] coherence          The coherence token, or `NULL`.
+ * \param [out]    data               Receives the intersection result.
+ *
+ * \return `true` if an intersection occurred, otherwise `false`.
+ */
+blam_bool blam_collision_bsp_test_vector_coherent(
+  const struct blam_collision_bsp     *bsp,
+  struct blam_bit_vector               breakable_surfaces,
+  const blam_real3d                   *origin,
+  const blam_real3d                   *delta,
+  blam_real                            max_scale,
+  blam_flags_long                      flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_coherence *coherence,
+  struct blam_collision_bsp_test_vector_result *data);
+
+/**
+ * \brief (NON-VANILLA) Tests a vector against a collision BSP, without recording
+ *        the leaves visited.
+ *
+ * The intersection is the same as that of #blam_collision_bsp_test_vector, but
+ * only the leading fields of the result are written. Meant for callers that 
+ * never read `leaves`, to save writing up to 0x100 leaf indices per test.
+ *
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  origin             The starting point of the vector.
+ * \param [in]  delta              The vector endpoint, relative to \a origin.
+ * \param [in]  max_scale          The proportional distance of \a origin to search.
+ * \param [in]  flags              See `enum blam_collision_test_flags`.
+ * \param [out] hit                Receives the intersection result. As with 
+ *                                 #blam_collision_bsp_test_vector, only the 
+ *                                 fraction is written if there is none.
+ *
+ * \return `true` if an intersection occurred, otherwise `false`.
+ */
+blam_bool blam_collision_bsp_test_vector_lite(
+  const struct blam_collision_bsp           *bsp,
+  struct blam_bit_vector                     breakable_surfaces,
+  const blam_real3d                         *origin,
+  const blam_real3d                         *delta,
+  blam_real                                  max_scale,
+  blam_flags_long                            flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_hit *hit);
+
+/**
+ * \brief (NON-VANILLA) Tests a vector against a collision BSP for every surface it
+ *        intersects, nearest first.
+ *
+ * The traversal carries on past each intersected surface as if it were not 
+ * there, with phantom BSP and BSP leak mitigations applied to each surface in 
+ * turn. The first hit is the result of #blam_collision_bsp_test_vector. The 
+ * leaves visited are not recorded.
+ *
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  origin             The starting point of the vector.
+ * \param [in]  delta              The vector endpoint, relative to \a origin.
+ * \param [in]  max_scale          The proportional distance of \a origin to search.
+ * \param [in]  flags              See `enum blam_collision_test_flags`.
+ * \param [out] hits               Receives the intersections, in order.
+ * \param [in]  hit_capacity       The number of elements of \a hits. The test 
+ *                                 stops once this many surfaces are intersected.
+ *
+ * \return The number of intersections written to \a hits.
+ */
+blam_long blam_collision_bsp_test_vector_all(
+  const struct blam_collision_bsp           *bsp,
+  struct blam_bit_vector                     breakable_surfaces,
+  const blam_real3d                         *origin,
+  const blam_real3d                         *delta,
+  blam_real                                  max_scale,
+  blam_flags_long                            flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_hit *hits,
+  blam_long                                  hit_capacity);
+
+/**
+ * \brief (NON-VANILLA) The maximum number of vectors in a packet.
+ *
+ * \sa #blam_collision_bsp_test_vector_packet
+ */
+#define BLAM_COLLISION_BSP_PACKET_SIZE 8
+
+/**
+ * \brief (NON-VANILLA) Tests a packet of vectors against a collision BSP.
+ *
+ * Each result is the same as that of #blam_collision_bsp_test_vector for the 
+ * corresponding vector. The vectors are descended together for as long as they
+ * all go down the same side of each splitting plane, so the top levels of the 
+ * BSP are only tested once for a packet of nearby vectors, such as a fan of 
+ * vectors from a shared origin.
+ *
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  origins            The starting point of each vector.
+ * \param [in]  deltas             The endpoint of each vector, relative to its 
+ *                                 origin.
+ * \param [in]  count              The number of vectors, at most 
+ *                                 #BLAM_COLLISION_BSP_PACKET_SIZE.
+ * \param [in]  max_scale          The proportional distance of each origin to 
+ *                                 search.
+ * \param [in]  flags              See `enum blam_collision_test_flags`.
+ * \param [out] data               Receives the intersection result of each vector.
+ *
+ * \return A mask with bit `i` set if vector `i` intersected a surface.
+ */
+blam_flags_long blam_collision_bsp_test_vector_packet(
+  const struct blam_collision_bsp              *bsp,
+  struct blam_bit_vector                        breakable_surfaces,
+  const blam_real3d                            *origins,
+  const blam_real3d                            *deltas,
+  blam_long                                     count,
+  blam_real                                     max_scale,
+  blam_flags_long                               flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_result *data);
+
+/**
+ * \brief (NON-VANILLA) The number of vectors descended at once by 
+ *        #blam_collision_bsp_test_vector_interleaved.
+ */
+#define BLAM_COLLISION_BSP_INTERLEAVE_WIDTH 8
+
+/**
+ * \brief (NON-VANILLA) A single BSP-vector intersection test of a batch.
+ *
+ * \sa #blam_collision_bsp_test_vector_interleaved
+ */
+struct blam_collision_bsp_batch_query
+{
+  blam_real3d     origin;    ///< The starting point of the vector.
+  blam_real3d     delta;     ///< The vector endpoint, relative to #origin.
+  blam_real       max_scale; ///< The proportional distance of #origin to search.
+  blam_flags_long flags;     ///< See `enum blam_collision_test_flags`.
+};
+
+/**
+ * \brief (NON-VANILLA) Tests a batch of unrelated vectors against a collision BSP.
+ *
+ * Each result is the same as that of #blam_collision_bsp_test_vector_configured
+ * for the corresponding query. Up to #BLAM_COLLISION_BSP_INTERLEAVE_WIDTH vectors
+ * are descended at once, a node at a time each, in turn. The next node of each
+ * is prefetched before moving on to the others, so that the memory accesses of
+ * the vectors overlap rather than each waiting on its own. This suits a batch of
+ * incoherent vectors on a BSP too large for the cache; nearby vectors are better
+ * tested as a packet, see #blam_collision_bsp_test_vector_packet.
+ *
+ * \param [in]  config             The mitigations to apply, or `NULL` for 
+ *                                 #blam_collision_bsp_default_config.
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  queries            The tests to perform.
+ * \param [in]  count              The number of \a queries.
+ * \param [out] results            Receives the intersection result of each query,
+ *                                 or `NULL` if only the fact of an intersection 
+ *                                 is needed.
+ * \param [out] hits               Receives `true` for each query that intersected
+ *                                 a surface, otherwise `false`. May be `NULL`.
+ *
+ * \return The number of queries that intersected a surface.
+ */
+blam_long blam_collision_bsp_test_vector_interleaved(
+  const struct blam_collision_bsp_config       *config,
+  const struct blam_collision_bsp              *bsp,
+  struct blam_bit_vector                        breakable_surfaces,
+  const struct blam_collision_bsp_batch_query  *queries,
+  blam_long                                     count,
+  struct blam_collision_bsp_test_vector_result *results,
+  blam_bool                                    *hits);
+
 /** 
  * \brief Classifies a collision BSP leaf.
  *
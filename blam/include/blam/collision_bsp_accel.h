@@ -0,0 +1,520 @@
+#ifndef BLAM_COLLISION_BSP_ACCEL_H
+#define BLAM_COLLISION_BSP_ACCEL_H
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "collision_bsp.h"
+
+// NOTE: THE STRUCTURES IN THIS FILE ARE NOT IN VANILLA HALO.
+//       They hold data derived from a collision BSP ahead of time, so that queries
+//       against that BSP can skip work that only depends on its static geometry.
+//       All tables are flat arrays addressed by index.
+//
+//       Other than #blam_collision_bsp_accel_find, the registry functions must
+//       not be called while queries run, or while another registry function runs
+//       on another thread.
+
+////////////////////////////////////////////////////////////////////////////////
+// Coplanar Plane Classes
+
+/**
+ * \brief A partition of the planes of a collision BSP that no nearly-coplanar pair
+ *        of planes crosses.
+ *
+ * Planes are in the same class when a chain of nearly-coplanar planes links them.
+ * Near-coplanarity is not transitive, so two planes of one class need not be 
+ * nearly coplanar, but two planes of different classes never are.
+ */
+struct blam_collision_bsp_plane_classes
+{
+  blam_long        plane_count; ///< The number of planes in the BSP.
+  blam_index_long *classes;     ///< For each plane, the lowest plane index in its class.
+};
+
+/**
+ * \brief Tests if two planes are in the same class.
+ *
+ * \return `false` if the planes cannot be nearly coplanar, otherwise `true`.
+ */
+static inline
+bool blam_collision_bsp_plane_classes_share(
+  const struct blam_collision_bsp_plane_classes *classes,
+  blam_index_long                                plane_index,
+  blam_index_long                                other_plane_index)
+{
+  if (plane_index < 0 || plane_index >= classes->plane_count
+    || other_plane_index < 0 || other_plane_index >= classes->plane_count)
+    return true;
+
+  return classes->classes[plane_index] == classes->classes[other_plane_index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Leak Resolution
+
+/**
+ * \brief A (leaf, plane) pair with precomputed Form 1 BSP leak resolutions.
+ */
+struct blam_collision_bsp_leak_entry
+{
+  blam_index_long leaf;            ///< The index of the leaf.
+  blam_index_long plane;           ///< The index of the plane crossed into the leaf.
+  blam_index_long first_candidate; ///< The index of the first candidate.
+  blam_long       candidate_count; ///< The number of candidates.
+};
+
+/**
+ * \brief An alternate plane to search a leaf under to resolve a Form 1 BSP leak.
+ */
+struct blam_collision_bsp_leak_candidate
+{
+  blam_index_long plane;     ///< The index of the alternate plane.
+  blam_index_long reference; ///< The index of the BSP2D reference for #plane in
+                             ///< the leaf, into `bsp2d.references`.
+};
+
+/**
+ * \brief Precomputed Form 1 BSP leak resolutions for a collision BSP.
+ *
+ * For every covered leaf and every plane on the path to that leaf, the table
+ * holds the nearly-coplanar planes further up the path that the leaf has a BSP2D
+ * reference for, in the order they would be tried. Pairs without any such plane
+ * have no entry, so a leaf must be covered for a missing entry to be meaningful.
+ *
+ * A leaf is covered when it is reachable from exactly one node, at a depth within
+ * the limits of the BSP-vector intersection test.
+ */
+struct blam_collision_bsp_leak_table
+{
+  blam_long   leaf_count;     ///< The number of leaves in the BSP.
+  blam_ulong *covered_leaves; ///< The set of covered leaves, as bits.
+
+  blam_long                             entry_count;
+  struct blam_collision_bsp_leak_entry *entries;
+
+  blam_long                                 candidate_count;
+  struct blam_collision_bsp_leak_candidate *candidates;
+
+  blam_long        bucket_count; ///< The number of #buckets; a power of two.
+  blam_index_long *buckets;      ///< Open-addressed entry indices, or `-1`.
+};
+
+/**
+ * \brief Tests if a leak table covers a leaf.
+ */
+static inline
+bool blam_collision_bsp_leak_table_covers(
+  const struct blam_collision_bsp_leak_table *table,
+  blam_index_long                             leaf_index)
+{
+  const int bits = CHAR_BIT * sizeof(*table->covered_leaves);
+  return 0 <= leaf_index && leaf_index < table->leaf_count
+    && (table->covered_leaves[leaf_index / bits] & ((blam_ulong)1 << (leaf_index % bits))) != 0;
+}
+
+/**
+ * \brief Finds the leak table entry for a leaf and the plane crossed into it.
+ *
+ * \param [in] table       The leak table.
+ * \param [in] leaf_index  The index of the leaf.
+ * \param [in] plane_index The index of the plane.
+ *
+ * \return The entry, or `NULL` if there is none.
+ */
+const struct blam_collision_bsp_leak_entry *blam_collision_bsp_leak_table_find(
+  const struct blam_collision_bsp_leak_table *table,
+  blam_index_long                             leaf_index,
+  blam_index_long                             plane_index);
+
+////////////////////////////////////////////////////////////////////////////////
+// Phantom BSP Certification
+
+/**
+ * \brief The BSP2D references whose leaf faces cannot produce phantom BSP.
+ *
+ * A reference is certified when the face of its leaf on its plane is covered by 
+ * the surfaces its BSP2D resolves to, and none of those surfaces are breakable. 
+ * Surfaces may fall short of the face by a few units in the last place of their
+ * own coordinates, so that faces meeting their surfaces exactly at the edges are 
+ * still certified; however large the map is. Any surface found through a 
+ * certified reference then passes surface validation for a vector that is not 
+ * nearly parallel to the plane, except within that distance of its edges.
+ */
+struct blam_collision_bsp_certification
+{
+  blam_long   reference_count;      ///< The number of BSP2D references in the BSP.
+  blam_ulong *certified_references; ///< The set of certified references, as bits.
+};
+
+/**
+ * \brief Tests if a BSP2D reference is certified.
+ */
+static inline
+bool blam_collision_bsp_certification_test(
+  const struct blam_collision_bsp_certification *certification,
+  blam_index_long                                reference_index)
+{
+  const int bits = CHAR_BIT * sizeof(*certification->certified_references);
+  return 0 <= reference_index && reference_index < certification->reference_count
+    && (certification->certified_references[reference_index / bits] & ((blam_ulong)1 << (reference_index % bits))) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sealed-World Repair
+
+/**
+ * \brief A copy of a collision BSP with BSP2D references synthesized for leaf faces
+ *        that lack them.
+ *
+ * A face of a leaf on a plane up its path gets a reference when the other side of
+ * the plane holds BSP exterior and the leaf has none for the plane. The reference
+ * is taken from the first of:
+ *   1. the leaf's own reference for the nearest nearly-coplanar plane up its path 
+ *      (Form 1 BSP leak), or
+ *   2. the reference of the leaf across the nearest nearly-coplanar split up its 
+ *      path, if that split has a leaf on its other side (Form 2 BSP leak),
+ * provided the source plane projects onto the same cardinal plane. Queries against
+ * the repaired BSP find these surfaces directly, without leak resolution, and 
+ * without validating candidate surfaces first.
+ */
+struct blam_collision_bsp_repair
+{
+  struct blam_collision_bsp bsp; ///< The repaired BSP. Only its leaves and BSP2D 
+                                 ///< references are copies; all other blocks are 
+                                 ///< shared with the original BSP.
+  blam_long synthesized_count;   ///< The number of references synthesized.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Empty-Space Skipping
+
+/**
+ * \brief An axis-aligned bounding box.
+ *
+ * The box is empty if `lower.components[0] > upper.components[0]`.
+ */
+struct blam_collision_bsp_box
+{
+  blam_real3d lower; ///< The lower bound of each component.
+  blam_real3d upper; ///< The upper bound of each component.
+};
+
+/**
+ * \brief Conservative bounds of the BSP interior below each node of a collision 
+ *        BSP.
+ *
+ * The box of a node contains every interior leaf below it. The boxes are padded 
+ * by a distance well above the precision of the BSP's coordinates, so a vector 
+ * segment missing the box of a node only reaches BSP exterior below that node.
+ * Leaves that are not covered by the leak table, and leaves left unbounded by 
+ * their path, are treated as unbounded.
+ */
+struct blam_collision_bsp_content_bounds
+{
+  blam_long                      node_count; ///< The number of nodes in the BSP.
+  struct blam_collision_bsp_box *nodes;      ///< The box of each node.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Incremental Point Location
+
+/**
+ * \brief A half-space bounding a leaf.
+ */
+struct blam_collision_bsp_leaf_bound
+{
+  blam_index_long plane; ///< The index of the plane.
+  blam_index_long side;  ///< The child taken at the plane: `1` if in front, else `0`.
+};
+
+/**
+ * \brief The range of bounds of a leaf.
+ */
+struct blam_collision_bsp_leaf_bound_range
+{
+  blam_index_long first; ///< The index of the first bound.
+  blam_long       count; ///< The number of bounds, or `0` if there are none.
+};
+
+/**
+ * \brief The half-spaces that decide whether a point is in each leaf of a collision
+ *        BSP.
+ *
+ * The bounds of a covered leaf are the splits on its path, less those the leaf is
+ * further than a margin away from. A point is found in the leaf by a search from
+ * the root exactly when it is on the side of every bound that the path takes.
+ * Leaves that are unbounded, degenerate, or not covered have every split on their
+ * path as bounds, if covered, and none otherwise.
+ */
+struct blam_collision_bsp_leaf_bounds
+{
+  blam_long                                   leaf_count; ///< The number of leaves in the BSP.
+  struct blam_collision_bsp_leaf_bound_range *ranges;     ///< The bounds of each leaf.
+
+  blam_long                             bound_count;
+  struct blam_collision_bsp_leaf_bound *bounds;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Breakable Surfaces
+
+/**
+ * \brief The number of bits of a breakable surfaces state that surfaces can refer
+ *        to; `breakable_surface` is a byte.
+ */
+#define BLAM_COLLISION_BSP_BREAKABLE_STATE_BITS 0x100
+
+/**
+ * \brief The breakable surfaces of a collision BSP.
+ *
+ * A BSP without breakable surfaces never reads the breakable surfaces state, so
+ * results of tests against it stay valid when the state changes.
+ */
+struct blam_collision_bsp_breakables
+{
+  blam_long        surface_count; ///< The number of breakable surfaces.
+  blam_index_long *surfaces;      ///< The indices of the breakable surfaces, in order.
+  blam_long        state_count;   ///< The number of leading bits of the state 
+                                  ///< that the surfaces refer to.
+};
+
+/**
+ * \brief Tracks changes to a breakable surfaces state.
+ *
+ * The generation is bumped whenever the state differs from the one last seen, so
+ * results derived under the state can be keyed by generation. Only the bits 
+ * surfaces can refer to are compared, so the comparison costs a few words. 
+ * Zero-initialize a tracker before its first use.
+ */
+struct blam_collision_bsp_breakable_generation
+{
+  blam_ulong generation; ///< The generation of the state last seen; `0` before
+                         ///< any state is seen.
+  blam_short count;      ///< The number of bits of the state last seen.
+  blam_ulong state[BLAM_COLLISION_BSP_BREAKABLE_STATE_BITS / (CHAR_BIT * sizeof(blam_ulong))];
+                         ///< The leading bits of the state last seen.
+};
+
+/**
+ * \brief Observes a breakable surfaces state.
+ *
+ * \param [in,out] tracker            The tracker.
+ * \param [in]     breakable_surfaces The current breakable surfaces state.
+ *
+ * \return The generation of \a breakable_surfaces. It is the same as returned
+ *         last time if the state did not change since.
+ */
+blam_ulong blam_collision_bsp_breakable_generation_update(
+  struct blam_collision_bsp_breakable_generation *tracker,
+  struct blam_bit_vector                          breakable_surfaces);
+
+////////////////////////////////////////////////////////////////////////////////
+// Acceleration Bundle
+
+/**
+ * \brief Flags that control which acceleration data is derived for a BSP.
+ */
+enum blam_collision_bsp_accel_flags
+{
+  // If set, queries run against a repaired copy of the BSP.
+  // See `struct blam_collision_bsp_repair`.
+  k_collision_bsp_accel_repair_leaks = 1L << 0
+};
+
+/**
+ * \brief The data derived from a collision BSP to accelerate queries against it.
+ */
+struct blam_collision_bsp_accel
+{
+  const struct blam_collision_bsp *bsp;   ///< The BSP the data was derived from.
+  blam_flags_long                  flags; ///< See `enum blam_collision_bsp_accel_flags`.
+
+  struct blam_collision_bsp_plane_classes plane_classes;
+  struct blam_collision_bsp_repair        repair;
+  struct blam_collision_bsp_leak_table    leak_table;
+  struct blam_collision_bsp_certification certification;
+  struct blam_collision_bsp_content_bounds content_bounds;
+  struct blam_collision_bsp_leaf_bounds    leaf_bounds;
+  struct blam_collision_bsp_breakables     breakables;
+
+  const void *mapping;      ///< The sidecar file the tables are mapped from, or 
+                            ///< `NULL` if they were allocated. See 
+                            ///< collision_bsp_sidecar.h.
+  blam_long   mapping_size; ///< The size of #mapping, in bytes.
+};
+
+/**
+ * \brief Gets the collision BSP that queries using acceleration data run against.
+ *
+ * The tables in \a accel index into the leaves and BSP2D references of this BSP.
+ */
+static inline
+const struct blam_collision_bsp *blam_collision_bsp_accel_target(
+  const struct blam_collision_bsp_accel *accel)
+{
+  return (accel->flags & k_collision_bsp_accel_repair_leaks) ? &accel->repair.bsp : accel->bsp;
+}
+
+/**
+ * \brief Derives the acceleration data for a collision BSP.
+ *
+ * \param [in]  bsp   The collision BSP.
+ * \param [in]  flags See `enum blam_collision_bsp_accel_flags`.
+ * \param [out] accel Receives the acceleration data.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+blam_bool blam_collision_bsp_accel_build(
+  const struct blam_collision_bsp *bsp,
+  blam_flags_long                  flags, // enum blam_collision_bsp_accel_flags
+  struct blam_collision_bsp_accel *accel);
+
+/**
+ * \brief Releases the resources held by acceleration data, whether it was derived
+ *        or mapped from a sidecar file.
+ */
+void blam_collision_bsp_accel_destroy(struct blam_collision_bsp_accel *accel);
+
+/**
+ * \brief Gets the number of bytes held by the tables of acceleration data.
+ *
+ * Allocator overhead is not included.
+ */
+blam_long blam_collision_bsp_accel_footprint(const struct blam_collision_bsp_accel *accel);
+
+////////////////////////////////////////////////////////////////////////////////
+// Registry
+
+/**
+ * \brief The acceleration data the registry holds for a collision BSP.
+ */
+struct blam_collision_bsp_accel_report
+{
+  const struct blam_collision_bsp *bsp;             ///< The BSP.
+  blam_long                        footprint;       ///< The bytes held by the data;
+                                                    ///< see #blam_collision_bsp_accel_footprint.
+  blam_long                        reference_count; ///< The number of acquisitions
+                                                    ///< not yet released.
+  blam_bool                        owned;           ///< `true` if the registry derived
+                                                    ///< the data, or `false` if it
+                                                    ///< was attached.
+};
+
+/**
+ * \brief Counts the activity of the registry, since the program started.
+ */
+struct blam_collision_bsp_accel_registry_stats
+{
+  blam_long entry_count;    ///< The number of BSPs with acceleration data.
+  blam_long memory_size;    ///< The bytes held by data the registry derived.
+  blam_long memory_cap;     ///< The most bytes that data may hold, or `-1`.
+
+  blam_long acquire_count;  ///< The number of acquisitions.
+  blam_long hit_count;      ///< The number of acquisitions of registered data.
+  blam_long build_count;    ///< The number of times data was derived or mapped.
+  blam_long map_count;      ///< The number of times data was mapped from a
+                            ///< sidecar file.
+  blam_long failure_count;  ///< The number of acquisitions that found no data,
+                            ///< because it could not be derived or did not fit.
+  blam_long eviction_count; ///< The number of times derived data was released to
+                            ///< stay within the memory cap.
+};
+
+/**
+ * \brief Attaches acceleration data to its collision BSP.
+ *
+ * Queries against `accel->bsp` use \a accel until it is detached. The caller
+ * retains ownership of \a accel, and it is never evicted. Any data the registry 
+ * derived for the BSP is released.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated,
+ *         or if data acquired for the BSP is still in use.
+ */
+blam_bool blam_collision_bsp_accel_attach(const struct blam_collision_bsp_accel *accel);
+
+/**
+ * \brief Detaches any acceleration data from a collision BSP.
+ *
+ * Data acquired for the BSP that is still in use stays registered until it is
+ * released.
+ */
+void blam_collision_bsp_accel_detach(const struct blam_collision_bsp *bsp);
+
+/**
+ * \brief Finds the acceleration data registered for a collision BSP.
+ *
+ * Queries against the BSP call this on every test, and run the plain traversal if
+ * it returns `NULL`. It may be called by several threads at once.
+ *
+ * \return The acceleration data, or `NULL` if there is none.
+ */
+const struct blam_collision_bsp_accel *blam_collision_bsp_accel_find(
+  const struct blam_collision_bsp *bsp);
+
+/**
+ * \brief Acquires the acceleration data for a collision BSP, deriving it if it is
+ *        not registered yet.
+ *
+ * Data the registry derives is kept after it is released, until it must be evicted
+ * to stay within the memory cap; the data least recently acquired is evicted first.
+ * Data already registered for the BSP is returned whatever flags it was derived 
+ * with.
+ *
+ * \param [in] bsp   The collision BSP.
+ * \param [in] flags See `enum blam_collision_bsp_accel_flags`.
+ *
+ * \return The acceleration data, or `NULL` if it could not be derived or does not
+ *         fit within the memory cap. Queries against \a bsp then run the plain
+ *         traversal.
+ */
+const struct blam_collision_bsp_accel *blam_collision_bsp_accel_acquire(
+  const struct blam_collision_bsp *bsp,
+  blam_flags_long                  flags); // enum blam_collision_bsp_accel_flags
+
+/**
+ * \brief Releases acceleration data returned by #blam_collision_bsp_accel_acquire.
+ */
+void blam_collision_bsp_accel_release(const struct blam_collision_bsp_accel *accel);
+
+/**
+ * \brief Sets the most bytes the data derived by the registry may hold.
+ *
+ * Data that is not in use is evicted until the registry is within the cap. Data
+ * attached by the caller does not count against the cap.
+ *
+ * \param [in] memory_cap The cap, or a negative value for no cap.
+ */
+void blam_collision_bsp_accel_set_memory_cap(blam_long memory_cap);
+
+/**
+ * \brief Sets the directory of the sidecar files of the data the registry derives.
+ *
+ * Data is mapped from its sidecar if there is one, and the sidecar is written
+ * otherwise. See #blam_collision_bsp_accel_load.
+ *
+ * \param [in] directory The directory, or `NULL` to always derive the data.
+ *
+ * \return `true` on success, otherwise `false` if the path is too long.
+ */
+blam_bool blam_collision_bsp_accel_set_sidecar_directory(const char *directory);
+
+/**
+ * \brief Gets the activity of the registry.
+ */
+void blam_collision_bsp_accel_registry_stats(struct blam_collision_bsp_accel_registry_stats *stats);
+
+/**
+ * \brief Reports the acceleration data the registry holds for each collision BSP.
+ *
+ * \param [out] reports Receives a report for each BSP, up to \a count.
+ * \param [in]  count   The capacity of \a reports.
+ *
+ * \return The number of BSPs with acceleration data, which may be more than
+ *         \a count.
+ */
+blam_long blam_collision_bsp_accel_registry_report(
+  struct blam_collision_bsp_accel_report *reports,
+  blam_long                               count);
+
+#endif // BLAM_COLLISION_BSP_ACCEL_H
@@ -0,0 +1,93 @@
+#ifndef BLAM_COLLISION_BSP_BATCH_H
+#define BLAM_COLLISION_BSP_BATCH_H
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "collision_bsp.h"
+
+// NOTE: THE FUNCTIONS IN THIS FILE ARE NOT IN VANILLA HALO.
+//       They run many independent BSP-vector intersection tests against a single
+//       collision BSP at once, for offline tools. Threads are only used when the 
+//       library is built with `BLAM_THREADS`; otherwise a pool has no threads of
+//       its own, and batches run on the calling thread.
+
+/**
+ * \brief The maximum number of threads a batch runs on.
+ */
+#define BLAM_COLLISION_BSP_BATCH_MAX_THREADS 64
+
+/**
+ * \brief A set of worker threads that batches run on.
+ *
+ * The threads are started when the pool is created and wait for batches until it 
+ * is destroyed, so that small batches do not pay for starting threads. A pool 
+ * runs one batch at a time; batches may not be submitted to it from several 
+ * threads at once.
+ */
+struct blam_collision_bsp_batch_pool;
+
+/**
+ * \brief Creates a pool of worker threads.
+ *
+ * \param [in] thread_count The number of threads batches run on, including the
+ *                          thread submitting them. At most 
+ *                          #BLAM_COLLISION_BSP_BATCH_MAX_THREADS are used.
+ *
+ * \return The pool, or `NULL` if memory could not be allocated. If some threads 
+ *         cannot be started, the pool runs on those that were.
+ */
+struct blam_collision_bsp_batch_pool *blam_collision_bsp_batch_pool_create(blam_long thread_count);
+
+/**
+ * \brief Stops the threads of a pool and releases it.
+ */
+void blam_collision_bsp_batch_pool_destroy(struct blam_collision_bsp_batch_pool *pool);
+
+/**
+ * \brief Gets the number of threads batches submitted to a pool run on, including
+ *        the thread submitting them.
+ */
+blam_long blam_collision_bsp_batch_pool_thread_count(const struct blam_collision_bsp_batch_pool *pool);
+
+/**
+ * \brief Tests a batch of vectors against a collision BSP.
+ *
+ * Each result is the same as that of #blam_collision_bsp_test_vector_configured
+ * for the corresponding query. The batch is divided evenly between the threads 
+ * of \a pool, and a thread that runs out of queries takes from the shares of the
+ * others. Each thread tests with a context of its own, so only \a bsp and the 
+ * data attached to it are shared; neither may change until the batch is done. A
+ * budget in \a config is charged by every thread, so it may only be given to a 
+ * batch run without a pool.
+ *
+ * Each thread runs its queries with #blam_collision_bsp_test_vector_interleaved.
+ * The calling thread takes part, and the function returns once the batch is done.
+ *
+ * \param [in]  pool               The threads to run on, or `NULL` to run on the
+ *                                 calling thread only.
+ * \param [in]  config             The mitigations to apply, or `NULL` for 
+ *                                 #blam_collision_bsp_default_config.
+ * \param [in]  bsp                The collision BSP to test against.
+ * \param [in]  breakable_surfaces The breakable surfaces state.
+ * \param [in]  queries            The tests to perform.
+ * \param [in]  count              The number of \a queries.
+ * \param [out] results            Receives the intersection result of each query,
+ *                                 or `NULL` if only the fact of an intersection 
+ *                                 is needed.
+ * \param [out] hits               Receives `true` for each query that intersected
+ *                                 a surface, otherwise `false`. May be `NULL`.
+ *
+ * \return The number of queries that intersected a surface.
+ */
+blam_long blam_collision_bsp_test_vector_batch(
+  struct blam_collision_bsp_batch_pool         *pool,
+  const struct blam_collision_bsp_config       *config,
+  const struct blam_collision_bsp              *bsp,
+  struct blam_bit_vector                        breakable_surfaces,
+  const struct blam_collision_bsp_batch_query  *queries,
+  blam_long                                     count,
+  struct blam_collision_bsp_test_vector_result *results,
+  blam_bool                                    *hits);
+
+#endif // BLAM_COLLISION_BSP_BATCH_H
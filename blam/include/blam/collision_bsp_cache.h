@@ -0,0 +1,131 @@
+#ifndef BLAM_COLLISION_BSP_CACHE_H
+#define BLAM_COLLISION_BSP_CACHE_H
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "collision_bsp.h"
+
+// NOTE: THE STRUCTURES IN THIS FILE ARE NOT IN VANILLA HALO.
+//       They let a caller answer BSP-vector intersection tests it already made
+//       within the same tick without traversing the BSP again.
+
+/**
+ * \brief The number of words of the key of a cached test.
+ */
+#define BLAM_COLLISION_BSP_CACHE_KEY_SIZE 9
+
+/**
+ * \brief Counts the activity of a cache, since it was created.
+ *
+ * The hit rate is `hit_count / lookup_count`.
+ */
+struct blam_collision_bsp_cache_stats
+{
+  blam_long lookup_count;   ///< The number of tests made through the cache.
+  blam_long hit_count;      ///< The number of tests answered from the cache.
+  blam_long eviction_count; ///< The number of results of the current tick that
+                            ///< were replaced by another.
+  blam_long tick_count;     ///< The number of ticks begun.
+
+  blam_long capacity;    ///< The number of results the cache holds.
+  blam_long memory_size; ///< The number of bytes allocated for the results.
+};
+
+/**
+ * \brief A cached BSP-vector intersection test.
+ */
+struct blam_collision_bsp_cache_entry
+{
+  const struct blam_collision_bsp *bsp;  ///< The BSP tested against, or `NULL` if
+                                         ///< the entry was never used.
+  blam_long tick;                        ///< The tick the test was made in.
+  blam_ulong key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE]; ///< The bits of the vector,
+                                                     ///< scale, flags and
+                                                     ///< breakable surfaces
+                                                     ///< generation.
+  blam_bool hit;                         ///< `true` if an intersection occurred.
+  struct blam_collision_bsp_test_vector_result result; ///< The intersection result.
+};
+
+/**
+ * \brief A direct-mapped cache of the BSP-vector intersection tests made within
+ *        the current tick.
+ *
+ * Tests are only answered from the cache if they are bit-identical to a test
+ * made since the tick began, so the results are always the same as those of
+ * #blam_collision_bsp_test_vector. A cache may not be used by several threads
+ * at once.
+ */
+struct blam_collision_bsp_cache
+{
+  blam_long tick;                                 ///< The current tick.
+  blam_long capacity;                             ///< The number of #entries; a
+                                                  ///< power of two.
+  struct blam_collision_bsp_cache_entry *entries; ///< The cached tests.
+
+  struct blam_collision_bsp_cache_stats stats; ///< The activity of the cache.
+};
+
+/**
+ * \brief Creates an empty cache.
+ *
+ * \param [out] cache       The cache.
+ * \param [in]  memory_size The most bytes to allocate for the results. The
+ *                          capacity is the largest power of two that fits.
+ *
+ * \return `true` on success, or `false` if \a memory_size does not fit a single
+ *         result or memory could not be allocated.
+ */
+bool blam_collision_bsp_cache_create(
+  struct blam_collision_bsp_cache *cache,
+  blam_long                        memory_size);
+
+/**
+ * \brief Releases the memory held by a cache.
+ */
+void blam_collision_bsp_cache_destroy(struct blam_collision_bsp_cache *cache);
+
+/**
+ * \brief Begins a new tick, forgetting every test made before it.
+ *
+ * This must also be called whenever the BSPs tested against may have changed.
+ */
+void blam_collision_bsp_cache_begin_tick(struct blam_collision_bsp_cache *cache);
+
+/**
+ * \brief Tests a vector against a collision BSP, or answers the test from a cache
+ *        if it was made already in the current tick.
+ *
+ * The result is the same as that of #blam_collision_bsp_test_vector.
+ *
+ * \param [in,out] cache                 The cache.
+ * \param [in]     bsp                   The collision BSP to test against.
+ * \param [in]     breakable_surfaces    The breakable surfaces state.
+ * \param [in]     breakable_generation  Identifies \a breakable_surfaces; it must
+ *                                       change whenever the state does within a
+ *                                       tick. See 
+ *                                       #blam_collision_bsp_breakable_generation_update.
+ *                                       Ignored if the acceleration data attached
+ *                                       to \a bsp lists no breakable surfaces.
+ * \param [in]     origin                The starting point of the vector.
+ * \param [in]     delta                 The vector endpoint, relative to \a origin.
+ * \param [in]     max_scale             The proportional distance of \a origin to
+ *                                       search.
+ * \param [in]     flags                 See `enum blam_collision_test_flags`.
+ * \param [out]    data                  Receives the intersection result.
+ *
+ * \return `true` if an intersection occurred, otherwise `false`.
+ */
+blam_bool blam_collision_bsp_test_vector_cached(
+  struct blam_collision_bsp_cache *cache,
+  const struct blam_collision_bsp *bsp,
+  struct blam_bit_vector           breakable_surfaces,
+  blam_ulong                       breakable_generation,
+  const blam_real3d               *origin,
+  const blam_real3d               *delta,
+  blam_real                        max_scale,
+  blam_flags_long                  flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_result *data);
+
+#endif // BLAM_COLLISION_BSP_CACHE_H
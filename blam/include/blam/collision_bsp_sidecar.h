@@ -0,0 +1,139 @@
+#ifndef BLAM_COLLISION_BSP_SIDECAR_H
+#define BLAM_COLLISION_BSP_SIDECAR_H
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "collision_bsp.h"
+#include "collision_bsp_accel.h"
+
+// NOTE: THE STRUCTURES IN THIS FILE ARE NOT IN VANILLA HALO.
+//       They let the acceleration data derived from a collision BSP be saved to a
+//       sidecar file, and mapped back in read-only on a later load of the same BSP
+//       instead of being derived again.
+//
+//       A sidecar holds the tables of `struct blam_collision_bsp_accel` as they
+//       are in memory, each aligned to 16 bytes, after a header that identifies
+//       the BSP by content hash and the flags the data was derived with. Tables
+//       hold no pointers, so sidecars are shared by 32-bit and 64-bit builds, but
+//       not across byte orders.
+
+/**
+ * \brief The version of the sidecar format.
+ *
+ * It must change whenever the layout of the tables or the way they are derived
+ * does, so that stale sidecars are derived again.
+ */
+#define BLAM_COLLISION_BSP_SIDECAR_VERSION 2
+
+/**
+ * \brief The most characters of a sidecar file name, with its terminator.
+ */
+#define BLAM_COLLISION_BSP_SIDECAR_NAME_SIZE 0x20
+
+/**
+ * \brief A hash of the content of a collision BSP.
+ *
+ * Two BSPs with the same tag block contents have the same hash, wherever they are
+ * in memory. The hash is fast rather than cryptographic.
+ */
+struct blam_collision_bsp_content_hash
+{
+  blam_ulong words[2]; ///< The 64 bits of the hash, low word first.
+};
+
+/**
+ * \brief Hashes the tag blocks of a collision BSP.
+ *
+ * Covers the nodes, planes, leaves, BSP2D references and nodes, surfaces, edges and
+ * vertices, including their counts.
+ */
+void blam_collision_bsp_hash_content(
+  const struct blam_collision_bsp        *bsp,
+  struct blam_collision_bsp_content_hash *hash);
+
+/**
+ * \brief Gets the file name of the sidecar for a BSP content hash and flags.
+ *
+ * \param [in]  hash  The content hash of the BSP.
+ * \param [in]  flags See `enum blam_collision_bsp_accel_flags`.
+ * \param [out] name  Receives the file name, such as `0123456789abcdef-00000001.bsc`.
+ */
+void blam_collision_bsp_sidecar_name(
+  const struct blam_collision_bsp_content_hash *hash,
+  blam_flags_long                               flags, // enum blam_collision_bsp_accel_flags
+  char                                          name[BLAM_COLLISION_BSP_SIDECAR_NAME_SIZE]);
+
+/**
+ * \brief Writes acceleration data to a sidecar file.
+ *
+ * The data is written to a temporary file beside \a path, which then replaces the
+ * sidecar in one step, so that a process mapping the sidecar meanwhile finds either
+ * the old one or the new one whole. The header is written last, so a temporary
+ * file left behind by a crash never matches.
+ *
+ * \param [in] accel The acceleration data, derived or mapped.
+ * \param [in] hash  The content hash of `accel->bsp`.
+ * \param [in] path  The path of the sidecar file, which is replaced.
+ *
+ * \return `true` on success, otherwise `false` if the file could not be written
+ *         or could not replace the sidecar. On Windows, a sidecar that is mapped
+ *         cannot be replaced.
+ */
+blam_bool blam_collision_bsp_sidecar_write(
+  const struct blam_collision_bsp_accel        *accel,
+  const struct blam_collision_bsp_content_hash *hash,
+  const char                                   *path);
+
+/**
+ * \brief Maps the acceleration data for a collision BSP from a sidecar file.
+ *
+ * The tables of \a accel point into the read-only mapping, which is unmapped by
+ * #blam_collision_bsp_accel_destroy.
+ *
+ * \param [in]  bsp   The collision BSP.
+ * \param [in]  hash  The content hash of \a bsp.
+ * \param [in]  flags See `enum blam_collision_bsp_accel_flags`.
+ * \param [in]  path  The path of the sidecar file.
+ * \param [out] accel Receives the acceleration data.
+ *
+ * \return `true` on success, otherwise `false` if the file does not exist, cannot
+ *         be mapped, was not written for \a hash, \a flags and this version, or
+ *         holds an index out of bounds of \a bsp. Queries trust the indices in
+ *         the tables, so a damaged sidecar is rejected rather than read.
+ */
+blam_bool blam_collision_bsp_sidecar_map(
+  const struct blam_collision_bsp              *bsp,
+  const struct blam_collision_bsp_content_hash *hash,
+  blam_flags_long                               flags, // enum blam_collision_bsp_accel_flags
+  const char                                   *path,
+  struct blam_collision_bsp_accel              *accel);
+
+/**
+ * \brief Unmaps a sidecar file mapped by #blam_collision_bsp_sidecar_map.
+ *
+ * This is called by #blam_collision_bsp_accel_destroy.
+ */
+void blam_collision_bsp_sidecar_unmap(const void *mapping, blam_long mapping_size);
+
+/**
+ * \brief Maps the acceleration data for a collision BSP from its sidecar, or
+ *        derives it and writes the sidecar if there is none.
+ *
+ * \param [in]  bsp       The collision BSP.
+ * \param [in]  flags     See `enum blam_collision_bsp_accel_flags`.
+ * \param [in]  directory The directory of the sidecar, named by
+ *                        #blam_collision_bsp_sidecar_name, or `NULL` to only
+ *                        derive the data.
+ * \param [out] accel     Receives the acceleration data.
+ *
+ * \return `true` on success, otherwise `false` if the data could not be derived.
+ *         Failing to write the sidecar is not an error.
+ */
+blam_bool blam_collision_bsp_accel_load(
+  const struct blam_collision_bsp *bsp,
+  blam_flags_long                  flags, // enum blam_collision_bsp_accel_flags
+  const char                      *directory,
+  struct blam_collision_bsp_accel *accel);
+
+#endif // BLAM_COLLISION_BSP_SIDECAR_H
@@ -294,6 +294,82 @@ blam_real_highp blam_plane2d_test(const blam_plane2d *plane, const blam_real2d *
   return blam_real2d_dot(&plane->normal, v) - plane->d;
 }
 
+// (NON-VANILLA) FILTERED PREDICATES:
+// The following compute the sign of one of the tests above in single precision,
+// along with a bound on the error of doing so. Only when the result is within the
+// bound of zero is the test repeated as above, so the decision is always the one 
+// the test above makes. Overflow, underflow to zero and NaN all fall back, since
+// the bound is then infinite, NaN or not exceeded.
+
+/**
+ * \brief The relative error bound of the filtered predicates.
+ *
+ * It covers both the single precision result and the `blam_real_highp` result it
+ * stands in for, with room to spare; each is off by a few units in the last place
+ * of the sum of the magnitudes of the terms at most.
+ */
+#define BLAM_REAL_FILTER_RELATIVE_ERROR 0x1p-20f
+
+/**
+ * \brief The absolute error bound of the filtered predicates, for terms that 
+ *        underflow.
+ */
+#define BLAM_REAL_FILTER_ABSOLUTE_ERROR 0x1p-140f
+
+/**
+ * \brief Returns `blam_plane3d_test(plane, v) >= 0.0`.
+ */
+static inline
+bool blam_plane3d_test_front(const blam_plane3d *plane, const blam_real3d *v)
+{
+  const blam_real *nc = &plane->normal.components[0];
+  const blam_real *vc = &v->components[0];
+  const blam_real t0 = nc[0] * vc[0];
+  const blam_real t1 = nc[1] * vc[1];
+  const blam_real t2 = nc[2] * vc[2];
+  const blam_real test      = t0 + t1 + t2 - plane->d;
+  const blam_real magnitude = fabs(t0) + fabs(t1) + fabs(t2) + fabs(plane->d);
+  
+  if (BLAM_LIKELY(fabs(test) > magnitude * BLAM_REAL_FILTER_RELATIVE_ERROR + BLAM_REAL_FILTER_ABSOLUTE_ERROR))
+    return test > 0.0f;
+  
+  return blam_plane3d_test(plane, v) >= 0.0;
+}
+
+/**
+ * \brief Returns `blam_plane2d_test(plane, v) >= 0.0`.
+ */
+static inline
+bool blam_plane2d_test_front(const blam_plane2d *plane, const blam_real2d *v)
+{
+  const blam_real t0 = plane->normal.components[0] * v->components[0];
+  const blam_real t1 = plane->normal.components[1] * v->components[1];
+  const blam_real test      = t0 + t1 - plane->d;
+  const blam_real magnitude = fabs(t0) + fabs(t1) + fabs(plane->d);
+  
+  if (BLAM_LIKELY(fabs(test) > magnitude * BLAM_REAL_FILTER_RELATIVE_ERROR + BLAM_REAL_FILTER_ABSOLUTE_ERROR))
+    return test > 0.0f;
+  
+  return blam_plane2d_test(plane, v) >= 0.0;
+}
+
+/**
+ * \brief Returns `blam_real2d_det(u, v) > 0.0`.
+ */
+static inline
+bool blam_real2d_det_positive(const blam_real2d *u, const blam_real2d *v)
+{
+  const blam_real t0 = u->components[0] * v->components[1];
+  const blam_real t1 = u->components[1] * v->components[0];
+  const blam_real det       = t0 - t1;
+  const blam_real magnitude = fabs(t0) + fabs(t1);
+  
+  if (BLAM_LIKELY(fabs(det) > magnitude * BLAM_REAL_FILTER_RELATIVE_ERROR + BLAM_REAL_FILTER_ABSOLUTE_ERROR))
+    return det > 0.0f;
+  
+  return blam_real2d_det(u, v) > 0.0;
+}
+
 enum blam_projection_plane // should be enum_short but its written as dword
 {
   k_blam_projection_plane_yz,
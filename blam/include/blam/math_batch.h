@@ -0,0 +1,116 @@
+#ifndef BLAM_MATH_BATCH_H
+#define BLAM_MATH_BATCH_H
+
+#include "platform.h"
+#include "base.h"
+#include "math.h"
+
+// NOTE: THE FUNCTIONS IN THIS FILE ARE NOT IN VANILLA HALO.
+//       They apply the operations of math.h to many vectors at once, stored by
+//       component. Each result is the same as the corresponding function of
+//       math.h gives when `blam_real_highp` arithmetic is IEEE double precision
+//       (as with SSE2 math); with x87 math, math.h may round differently.
+//
+//       Every implementation gives the same results as the others. For this, the
+//       batch operations are built with SSE2 math on x86 even where the rest of
+//       the code uses x87 math, so 32-bit x86 builds need a processor with SSE2.
+//
+//       The implementation is chosen for the processor on first use; see
+//       #blam_math_batch_select.
+
+/**
+ * \brief An instruction set the batch operations can be implemented with.
+ */
+enum blam_math_isa
+{
+  k_blam_math_isa_scalar, ///< Portable C, one vector at a time.
+  k_blam_math_isa_sse2,   ///< Two vectors at a time.
+  k_blam_math_isa_avx2,   ///< Four vectors at a time.
+};
+
+/**
+ * \brief Three-dimensional vectors stored by component.
+ */
+struct blam_real3d_soa
+{
+  blam_real *components[3]; ///< The arrays of each component.
+};
+
+/**
+ * \brief Two-dimensional vectors stored by component.
+ */
+struct blam_real2d_soa
+{
+  blam_real *components[2]; ///< The arrays of each component.
+};
+
+/**
+ * \brief Selects the implementation of the batch operations.
+ *
+ * The best implementation the processor supports is selected on first use, so
+ * this only needs to be called to select a lesser one, such as for comparison.
+ * It must not be called while batch operations run on other threads.
+ *
+ * \param [in] isa The most capable instruction set to use.
+ *
+ * \return The instruction set selected; the most capable one up to \a isa that the
+ *         processor supports.
+ */
+enum blam_math_isa blam_math_batch_select(enum blam_math_isa isa);
+
+/**
+ * \brief Returns the instruction set of the batch operations.
+ */
+enum blam_math_isa blam_math_batch_isa(void);
+
+/**
+ * \brief Computes `blam_real3d_dot(u, v[i])` for each of \a count vectors \a v.
+ */
+void blam_real3d_dot_batch(
+  const blam_real3d            *u,
+  const struct blam_real3d_soa *v,
+  blam_long                     count,
+  blam_real_highp              *result);
+
+/**
+ * \brief Computes `blam_plane3d_test(plane, v[i])` for each of \a count points
+ *        \a v.
+ */
+void blam_plane3d_test_batch(
+  const blam_plane3d           *plane,
+  const struct blam_real3d_soa *v,
+  blam_long                     count,
+  blam_real_highp              *result);
+
+/**
+ * \brief Computes `blam_real3d_cross(u[i], v[i])` for each of \a count pairs of
+ *        vectors.
+ */
+void blam_real3d_cross_batch(
+  const struct blam_real3d_soa *u,
+  const struct blam_real3d_soa *v,
+  blam_long                     count,
+  const struct blam_real3d_soa *result);
+
+/**
+ * \brief Computes `blam_real3d_scalar_triple(u, v[i], w[i])` for each of \a count
+ *        pairs of vectors.
+ */
+void blam_real3d_scalar_triple_batch(
+  const blam_real3d            *u,
+  const struct blam_real3d_soa *v,
+  const struct blam_real3d_soa *w,
+  blam_long                     count,
+  blam_real_highp              *result);
+
+/**
+ * \brief Computes `blam_real2d_det(u[i], v[i])` for each of \a count pairs of
+ *        vectors.
+ */
+void blam_real2d_det_batch(
+  const struct blam_real2d_soa *u,
+  const struct blam_real2d_soa *v,
+  blam_long                     count,
+  blam_real_highp              *result);
+
+#endif // BLAM_MATH_BATCH_H
@@ -5,10 +5,12 @@
 # define BLAM_ATTRIBUTE(...) __attribute__ ((__VA_ARGS__))
 # define BLAM_ASSUME(cond) if (!(cond)) __builtin_unreachable()
 # define BLAM_EXPECT(exp, c) __builtin_expect ((exp), (c))
+# define BLAM_PREFETCH(address) __builtin_prefetch ((address))
 #else
 # define BLAM_ATTRIBUTE(...)
 # define BLAM_ASSUME(cond) 
 # define BLAM_EXPECT(exp, c) (exp)
+# define BLAM_PREFETCH(address) ((void)(address))
 #endif
 
 #define BLAM_LIKELY(exp)   BLAM_EXPECT(!!(exp), 1)
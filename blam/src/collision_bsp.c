@@ -1,4 +1,5 @@
 #include "blam/collision_bsp.h"
+#include "blam/collision_bsp_accel.h"
 
 #include <stdbool.h>
 
@@ -13,8 +14,11 @@
 // -----------------------------------------------------------------------------
 // INTERNAL DECLARATIONS, STRUCTURES, ENUMS
 
-static bool mitigate_phantom_bsp = true;
-static bool mitigate_bsp_leaks   = true;
+const struct blam_collision_bsp_config blam_collision_bsp_default_config =
+{
+  .mitigate_phantom_bsp = true,
+  .mitigate_bsp_leaks   = true
+};
 
 typedef struct blam_collision_bsp collision_bsp;
 typedef struct blam_bit_vector    bit_vector;
@@ -34,6 +38,84 @@ enum phantom_bsp_resolution_method
                                       ///< surface.
 };
 
+/**
+ * \brief The surfaces tested when a vector passes from one leaf into the next.
+ *
+ * \sa #leaf_actions
+ */
+enum leaf_action
+{
+  k_leaf_action_none,         ///< No surface is tested.
+  k_leaf_action_front_facing, ///< The front-facing surfaces of the previous leaf.
+  k_leaf_action_back_facing,  ///< The back-facing surfaces of the next leaf.
+  k_leaf_action_double_sided, ///< The double-sided surfaces between the leaves.
+  k_leaf_action_leak,         ///< (NON-VANILLA) Surfaces of a Form 3 BSP leak.
+};
+
+/**
+ * \brief The leaf actions enabled for a query, by its flags and mitigations.
+ *
+ * \sa #leaf_actions
+ */
+enum leaf_mode_flags
+{
+  k_leaf_mode_front_facing = 1 << 0, ///< Front-facing surfaces are tested, or 
+                                     ///< phantom BSP is mitigated.
+  k_leaf_mode_back_facing  = 1 << 1, ///< Back-facing surfaces are tested, or 
+                                     ///< phantom BSP is mitigated.
+  k_leaf_mode_double_sided = 1 << 2, ///< Double-sided surfaces are tested.
+  k_leaf_mode_leaks        = 1 << 3, ///< BSP leaks are mitigated.
+  
+  k_leaf_mode_count        = 1 << 4
+};
+
+#define LEAF_TYPE_INTERIOR(type) \
+  ((type) == k_bsp_leaf_type_interior || (type) == k_bsp_leaf_type_double_sided)
+
+/**
+ * \brief The action to take passing from a leaf of type \a previous into a leaf
+ *        of type \a current, under \a mode.
+ *
+ * The leaf type pairs of the actions are disjoint, so the order of the tests 
+ * does not matter; it is that of #collision_bsp_test_vector_leaf in Halo.
+ */
+#define LEAF_ACTION(mode, previous, current)                                       \
+  (((mode) & k_leaf_mode_front_facing) && LEAF_TYPE_INTERIOR(previous)              \
+      && (current) == k_bsp_leaf_type_exterior ? k_leaf_action_front_facing :      \
+   ((mode) & k_leaf_mode_back_facing) && (previous) == k_bsp_leaf_type_exterior    \
+      && LEAF_TYPE_INTERIOR(current) ? k_leaf_action_back_facing :                 \
+   ((mode) & k_leaf_mode_double_sided) && (previous) == k_bsp_leaf_type_double_sided \
+      && (current) == k_bsp_leaf_type_double_sided ? k_leaf_action_double_sided :  \
+   ((mode) & k_leaf_mode_leaks)                                                    \
+      && (((previous) == k_bsp_leaf_type_interior && (current) == k_bsp_leaf_type_double_sided) \
+       || ((previous) == k_bsp_leaf_type_double_sided && (current) == k_bsp_leaf_type_interior)) \
+      ? k_leaf_action_leak : k_leaf_action_none)
+
+#define LEAF_ACTIONS_ROW(mode, previous) \
+  { LEAF_ACTION(mode, previous, 0), LEAF_ACTION(mode, previous, 1), \
+    LEAF_ACTION(mode, previous, 2), LEAF_ACTION(mode, previous, 3) }
+
+#define LEAF_ACTIONS(mode) \
+  { LEAF_ACTIONS_ROW(mode, 0), LEAF_ACTIONS_ROW(mode, 1), \
+    LEAF_ACTIONS_ROW(mode, 2), LEAF_ACTIONS_ROW(mode, 3) }
+
+/**
+ * \brief The action to take on passing between leaves, by leaf mode (see 
+ *        `enum leaf_mode_flags`), previous leaf type and current leaf type.
+ */
+static const blam_enum_byte leaf_actions[k_leaf_mode_count][4][4] =
+{
+  LEAF_ACTIONS(0x0), LEAF_ACTIONS(0x1), LEAF_ACTIONS(0x2), LEAF_ACTIONS(0x3),
+  LEAF_ACTIONS(0x4), LEAF_ACTIONS(0x5), LEAF_ACTIONS(0x6), LEAF_ACTIONS(0x7),
+  LEAF_ACTIONS(0x8), LEAF_ACTIONS(0x9), LEAF_ACTIONS(0xA), LEAF_ACTIONS(0xB),
+  LEAF_ACTIONS(0xC), LEAF_ACTIONS(0xD), LEAF_ACTIONS(0xE), LEAF_ACTIONS(0xF)
+};
+
+#undef LEAF_ACTIONS
+#undef LEAF_ACTIONS_ROW
+#undef LEAF_ACTION
+#undef LEAF_TYPE_INTERIOR
+
 /**
  * \brief Manages additional, non-vanilla state for BSP-vector intersection tests.
  *
@@ -55,12 +137,177 @@ struct test_vector_context_ext
   
   struct
   {
-    blam_long       count;        ///< The number of nodes populating #stack.
-    blam_index_long stack[0x100]; ///< The stack of BSP node indices to get to the 
+    blam_long       count;        ///< The number of nodes on the path to the 
                                   ///< current node, including the current node.
-                                  ///< If at a leaf, the leaf index is unsanitized.
-  } nodes       ///< The stack of nodes to the current leaf (may be exterior).
-  , leaf_nodes; ///< The stack of nodes to the current or previous interior leaf.
+    blam_long       leaf_count;   ///< The number of nodes on the path to the 
+                                  ///< current or previous interior leaf.
+    blam_long       shared_count; ///< The number of nodes both paths begin with.
+    blam_index_long stack[0x100]; ///< The path to the current node grows up from 
+                                  ///< the bottom, and the remainder of the path 
+                                  ///< to the interior leaf grows down from the 
+                                  ///< top. If at a leaf, the leaf index is 
+                                  ///< unsanitized.
+  } nodes; ///< The paths of BSP node indices to the current leaf (may be 
+           ///< exterior) and to the current or previous interior leaf.
+};
+
+#ifdef BLAM_MEMOIZE
+#define TEST_VECTOR_MEMO_PLANES   0x40 ///< The number of plane test slots.
+#define TEST_VECTOR_MEMO_SURFACES 0x20 ///< The number of surface validation slots.
+
+/**
+ * \brief Memoizes plane tests and surface validations within a single query.
+ *
+ * Both caches are direct-mapped by index. A slot is only valid while its bit is 
+ * set in the corresponding mask, so the memo is reset by clearing the masks.
+ */
+struct test_vector_memo
+{
+  uint64_t valid_planes;    ///< The valid slots of #planes.
+  uint32_t valid_surfaces;  ///< The valid slots of #surfaces.
+  uint32_t surface_results; ///< The memoized validation results of #surfaces.
+  
+  struct
+  {
+    blam_index_long plane;       ///< The index of the plane.
+    blam_real_highp test_origin; ///< The plane test of the vector origin.
+    blam_real_highp dot_delta;   ///< The scalar product of the plane normal and 
+                                 ///< the vector delta.
+  } planes[TEST_VECTOR_MEMO_PLANES];
+  
+  blam_index_long surfaces[TEST_VECTOR_MEMO_SURFACES]; ///< The surface indices.
+};
+#endif // BLAM_MEMOIZE
+
+/**
+ * \brief A split whose far child subtree has yet to be traversed.
+ */
+struct test_vector_split
+{
+  blam_index_long node;     ///< The index of the far child of the split node.
+  blam_index_long plane;    ///< The index of the splitting plane.
+  blam_real       fraction; ///< The intersection with the splitting plane.
+  blam_real       terminal; ///< The maximum distance to traverse #node to.
+  blam_index_long handle;   ///< The handle of the split node in the node stack.
+};
+
+/**
+ * \brief A node a tested vector is known to be located within.
+ */
+struct test_vector_start
+{
+  blam_index_long        node;  ///< The node to locate the vector from.
+  blam_long              depth; ///< The number of nodes in #path.
+  const blam_index_long *path;  ///< The nodes on the path to #node, from the root.
+};
+
+/**
+ * \brief Describes a BSP-vector intersection test.
+ *
+ * \sa #collision_bsp_test_vector_query
+ */
+struct test_vector_query
+{
+  const collision_bsp *bsp;                ///< The BSP to test against.
+  bit_vector           breakable_surfaces; ///< The state of breakable surfaces.
+  const blam_real3d   *origin;             ///< The tested vector origin.
+  const blam_real3d   *delta;              ///< The tested vector endpoint, relative
+                                           ///< to #origin.
+  blam_real            max_scale;          ///< The maximum scale, as supplied.
+  blam_flags_long      flags;              ///< See `enum blam_collision_test_flags`.
+  
+  const struct blam_collision_bsp_config *config; ///< The mitigations to apply, or
+                                                  ///< `NULL` for the defaults.
+  
+  const struct test_vector_start      *start;     ///< If not `NULL`, the node to 
+                                                  ///< locate the vector from 
+                                                  ///< instead of the root.
+  struct blam_collision_bsp_coherence *coherence; ///< The coherence token, or 
+                                                  ///< `NULL`.
+  
+  test_vector_result *data; ///< Receives the intersection result, or `NULL` if 
+                            ///< only the fact of an intersection is needed.
+  struct blam_collision_bsp_test_vector_hit *hit; ///< If not `NULL`, receives the
+                                                  ///< intersection result without
+                                                  ///< the leaves visited.
+  
+  struct blam_collision_bsp_test_vector_hit *hits; ///< If not `NULL`, receives 
+                                                   ///< every intersection.
+  blam_long  hit_capacity; ///< The number of elements of #hits.
+  blam_long *hit_count;    ///< If not `NULL`, receives the number of 
+                           ///< intersections written to #hits.
+};
+
+/**
+ * \brief Manages the state shared by the vectors of a packet.
+ *
+ * \sa #blam_collision_bsp_test_vector_packet
+ */
+struct test_vector_packet
+{
+  const collision_bsp *bsp;                ///< The BSP to test against.
+  bit_vector           breakable_surfaces; ///< The state of breakable surfaces.
+  const struct blam_collision_bsp_config *config; ///< The mitigations to apply.
+  const blam_real3d   *origins;            ///< The tested vector origins.
+  const blam_real3d   *deltas;             ///< The tested vector endpoints, 
+                                           ///< relative to #origins.
+  blam_long            count;              ///< The number of tested vectors.
+  blam_real            max_scale;          ///< The maximum scale, as supplied.
+  blam_real            terminal;           ///< The maximum scale, clamped.
+  blam_flags_long      flags;              ///< See `enum blam_collision_test_flags`.
+  test_vector_result  *data;               ///< Receives the intersection results.
+  
+  blam_real lane_origins[3][BLAM_COLLISION_BSP_PACKET_SIZE]; ///< #origins, 
+                                                             ///< by component.
+  blam_real lane_deltas[3][BLAM_COLLISION_BSP_PACKET_SIZE];  ///< #deltas,
+                                                             ///< by component.
+  
+  blam_index_long path[0x100]; ///< The path to the current node.
+};
+
+/**
+ * \brief A vector being descended by #blam_collision_bsp_test_vector_interleaved.
+ *
+ * The descent is that of #collision_bsp_locate_vector, broken into steps that
+ * each wait on a single memory access.
+ */
+struct test_vector_lane
+{
+  blam_long       query;       ///< The index of the query, or `-1` if idle.
+  blam_index_long node;        ///< The node being descended to.
+  blam_index_long plane;       ///< The plane of #node once it has been loaded, 
+                               ///< otherwise `-1`.
+  blam_real       terminal;    ///< The maximum scale, clamped.
+  blam_long       depth;       ///< The number of nodes in #path.
+  blam_index_long path[0x100]; ///< The path to #node.
+};
+
+/**
+ * \brief The number of deferred splits kept by a single traversal loop.
+ *
+ * Deeper trees are handled by recursing into the near side of the split.
+ */
+#define TEST_VECTOR_SPLIT_STACK_SIZE 0x40
+
+/**
+ * \brief The budget of a test that is not bounded by one.
+ */
+#define TEST_VECTOR_BUDGET_UNLIMITED INT32_MAX
+
+/**
+ * \brief The mitigation budget of a single BSP-vector intersection test.
+ *
+ * \sa `struct blam_collision_bsp_budget`
+ */
+struct test_vector_budget
+{
+  struct blam_collision_bsp_budget *source; ///< The budget charged, or `NULL`.
+  
+  blam_long attempts;       ///< The most leak resolutions for the test.
+  blam_long visits;         ///< The most visits for the test.
+  blam_long attempts_spent; ///< The leak resolutions attempted so far.
+  blam_long visits_spent;   ///< The visits made so far.
+  bool      exhausted;      ///< `true` if a charge was refused.
 };
 
 /**
@@ -74,7 +321,30 @@ struct test_vector_context
   const blam_real3d   *origin; ///< The tested vector origin.
   const blam_real3d   *delta;  ///< The tested vector endpoint, relative to #origin.
 
-  test_vector_result  *data;   ///< Receives the intersection result.
+  test_vector_result  *data;   ///< Receives the intersection result, and the 
+                               ///< leaves visited. (NON-VANILLA) May be `NULL`, 
+                               ///< if only the fact of an intersection is needed.
+  blam_real            fraction; ///< (NON-VANILLA) The fraction of the committed
+                                 ///< intersection, if any, otherwise the initial 
+                                 ///< fraction of the result.
+  struct blam_collision_bsp_test_vector_hit *hit; ///< (NON-VANILLA) If not `NULL`,
+                                                  ///< receives the intersection 
+                                                  ///< result, but not the leaves.
+  
+  struct blam_collision_bsp_test_vector_hit *hits; ///< (NON-VANILLA) If not `NULL`,
+                                                   ///< receives every intersection, 
+                                                   ///< and the traversal carries on 
+                                                   ///< past each.
+  blam_long hit_count;    ///< The number of intersections written to #hits.
+  blam_long hit_capacity; ///< The number of elements of #hits.
+  
+  const struct blam_collision_bsp_accel *accel; ///< (NON-VANILLA) The acceleration 
+                                                ///< data attached to the BSP, if any.
+  const struct blam_collision_bsp_config *config; ///< (NON-VANILLA) The mitigations
+                                                  ///< to apply.
+  blam_flags_byte leaf_mode; ///< (NON-VANILLA) See `enum leaf_mode_flags`.
+  struct test_vector_budget budget; ///< (NON-VANILLA) The budget of BSP leak 
+                                    ///< mitigations.
 
   // ---------------------------------
   // Immediate History Values
@@ -83,8 +353,30 @@ struct test_vector_context
   blam_index_long         plane;     ///< The index of the last plane crossed.
   
   struct test_vector_context_ext ext; ///< (NON-VANILLA) Extended context data.
+  
+#ifdef BLAM_MEMOIZE
+  struct test_vector_memo memo; ///< (NON-VANILLA) Memoized tests for this query.
+#endif // BLAM_MEMOIZE
 };
 
+/**
+ * \brief Initializes the context for a BSP-vector intersection test.
+ *
+ * Only the bookkeeping is initialized; the node path storage is left as is.
+ * If \a config is `NULL`, #blam_collision_bsp_default_config is applied.
+ */
+static
+void test_vector_context_init(
+  struct test_vector_context *ctx,
+  const collision_bsp        *bsp,
+  bit_vector                  breakable_surfaces,
+  const blam_real3d          *origin,
+  const blam_real3d          *delta,
+  blam_flags_long             flags,
+  const struct blam_collision_bsp_config *config,
+  test_vector_result         *data,
+  blam_real                   fraction);
+
 /**
  * \brief Attempts to commit a surface intersection result to the context object.
  *
@@ -93,7 +385,9 @@ struct test_vector_context
  * \param [in]     plane_index   The index of the intersected plane.
  * \param [in]     surface_index The index of the intersected surface.
  * 
- * \return \c true if the result was committed, otherwise \c false.
+ * \return \c true if the result was committed, otherwise \c false. 
+ *         (NON-VANILLA) If gathering every intersection into `ctx->hits`, 
+ *         \c true only once it is full.
  */
 static
 blam_bool test_vector_context_try_commit_result(
@@ -114,9 +408,66 @@ static
 blam_bool test_vector_context_try_commit_pending_result(
   struct test_vector_context *ctx);
 
+/**
+ * \brief Tests a vector against a collision BSP.
+ *
+ * Common to the entry points for BSP-vector intersection tests.
+ *
+ * \param [in] query The test to perform.
+ *
+ * \return \c true if a surface was intersected, otherwise \c false.
+ */
+static
+blam_bool collision_bsp_test_vector_query(
+  const struct test_vector_query *query);
+
+/**
+ * \brief Tests some of the vectors of a packet against a collision BSP subtree.
+ *
+ * The vectors are descended together for as long as they go down the same side 
+ * of each splitting plane, with the same tests as #collision_bsp_locate_vector.
+ * Where they part, each side is descended on its own, and a vector split by the 
+ * plane is tested alone from there.
+ *
+ * \param [in,out] packet The packet.
+ * \param [in]     root   The index of the subtree root node.
+ * \param [in]     lanes  The mask of vectors in the packet to test.
+ * \param [in]     depth  The number of nodes on `packet->path` to \a root.
+ *
+ * \return The mask of vectors in \a lanes that intersected a surface.
+ */
+static
+blam_flags_long collision_bsp_test_vector_packet_node(
+  struct test_vector_packet *packet,
+  blam_index_long            root,
+  blam_flags_long            lanes,
+  blam_long                  depth);
+
+/**
+ * \brief Takes a single step of the descent of an interleaved vector.
+ *
+ * A step either loads the node and prefetches its plane, or tests the plane and 
+ * prefetches the child descended to.
+ *
+ * \param [in]     bsp   The collision BSP.
+ * \param [in]     query The test the vector belongs to.
+ * \param [in,out] lane  The vector.
+ *
+ * \return \c true once the vector is split by #test_vector_lane::node, or it is 
+ *         a leaf, otherwise \c false.
+ */
+static inline
+bool collision_bsp_interleave_step(
+  const collision_bsp                         *bsp,
+  const struct blam_collision_bsp_batch_query *query,
+  struct test_vector_lane                     *lane);
+
 /**
  * \brief Tests a vector against a collision BSP subtree.
  *
+ * The subtree is traversed front-to-back without recursion; the far side of each
+ * split is deferred onto a local work stack (see #test_vector_split).
+ *
  * \param [in,out] ctx      The test context.
  * \param [in]     root     The index of the subtree root node.
  *                          If this value is negative, it is treated as a leaf node.
@@ -135,6 +486,82 @@ blam_bool collision_bsp_test_vector_node(
   blam_real       terminal
 );
 
+/**
+ * \brief Locates the leaf holding an entire vector, if there is one.
+ *
+ * The BSP is descended exactly as #collision_bsp_test_vector_node would, for as
+ * long as both ends of the vector are on the same side of each splitting plane.
+ *
+ * \param [in]     bsp      The collision BSP.
+ * \param [in]     root     The index of the subtree root to descend from.
+ * \param [in]     origin   The tested vector origin.
+ * \param [in]     delta    The tested vector endpoint, relative to \a origin.
+ * \param [in]     terminal The maximum distance from \a origin, as a fraction of 
+ *                          \a delta.
+ * \param [in,out] path     Receives the nodes descended through, as the node path
+ *                          of `struct test_vector_context_ext` would.
+ * \param [in,out] depth    The number of nodes in \a path.
+ * \param [in,out] radius   Lowered to the distance from the end of the vector to 
+ *                          each plane descended through.
+ *
+ * \return The index of the first node that splits the vector if there is one, 
+ *         otherwise the (unsanitized) index of the leaf holding the vector.
+ */
+static
+blam_index_long collision_bsp_locate_vector(
+  const collision_bsp *bsp,
+  blam_index_long      root,
+  const blam_real3d   *origin,
+  const blam_real3d   *delta,
+  blam_real            terminal,
+  blam_index_long     *path,
+  blam_long           *depth,
+  blam_real_highp     *radius);
+
+/**
+ * \brief Resumes from a coherence token, if the tested vector is within its ball.
+ *
+ * \param [in]  coherence The coherence token.
+ * \param [in]  bsp       The collision BSP.
+ * \param [in]  origin    The tested vector origin.
+ * \param [in]  delta     The tested vector endpoint, relative to \a origin.
+ * \param [in]  terminal  The maximum distance from \a origin, as a fraction of 
+ *                        \a delta.
+ * \param [out] path      Receives the nodes on the path to the returned node.
+ * \param [out] depth     Receives the number of nodes in \a path.
+ * \param [out] radius    Receives a lower bound on the distance from the end of 
+ *                        the vector to each plane on \a path.
+ *
+ * \return The node to start the traversal from; `0` if the token is not usable.
+ */
+static
+blam_index_long collision_bsp_coherence_resume(
+  const struct blam_collision_bsp_coherence *coherence,
+  const collision_bsp                       *bsp,
+  const blam_real3d                         *origin,
+  const blam_real3d                         *delta,
+  blam_real                                  terminal,
+  blam_index_long                           *path,
+  blam_long                                 *depth,
+  blam_real_highp                           *radius);
+
+/**
+ * \brief Leaves a coherence token at the node a vector was located in.
+ *
+ * See #collision_bsp_locate_vector for the parameters.
+ */
+static
+void collision_bsp_coherence_update(
+  struct blam_collision_bsp_coherence *coherence,
+  const collision_bsp                 *bsp,
+  const blam_real3d                   *origin,
+  const blam_real3d                   *delta,
+  blam_real                            terminal,
+  blam_index_long                      node,
+  const blam_index_long               *path,
+  blam_long                            depth,
+  blam_real_highp                      radius);
+
 /**
  * \brief Tests a vector against a collision BSP subtree.
  *
@@ -168,6 +595,9 @@ blam_bool collision_bsp_test_vector_leaf(
  * \param [in] delta              The vector endpoint, relative to \a origin.
  * \param [in] fraction           The distance to the test point, as a fraction of 
  *                                \a delta.
+ * \param [out] reference_index   (NON-VANILLA) If not `NULL`, receives the index of 
+ *                                the BSP2D reference the surface was found through,
+ *                                or `-1` if no surface was hit.
  *
  * \return The index of the intersected surface, or `-1` if no surface was hit.
  */
@@ -180,6 +610,34 @@ blam_index_long collision_bsp_search_leaf(
   bool                 splits_interior,
   const blam_real3d   *origin,
   const blam_real3d   *delta,
+  blam_real            fraction,
+  blam_index_long     *reference_index);
+
+/**
+ * \brief Searches a single BSP2D reference of a BSP leaf for an intersected surface.
+ *
+ * NOTE: THIS FUNCTION IS NOT IN VANILLA HALO.
+ *
+ * Equivalent to #collision_bsp_search_leaf for a plane that splits BSP interior 
+ * and exterior, when \a reference_index is the leaf's first reference to the plane.
+ *
+ * \param [in] bsp             The collision BSP.
+ * \param [in] reference_index The index of the BSP2D reference.
+ * \param [in] plane_index     The index of the intersected plane.
+ * \param [in] origin          The vector starting point.
+ * \param [in] delta           The vector endpoint, relative to \a origin.
+ * \param [in] fraction        The distance to the test point, as a fraction of 
+ *                             \a delta.
+ *
+ * \return The index of the intersected surface, or `-1` if no surface was hit.
+ */
+static
+blam_index_long collision_bsp_search_reference(
+  const collision_bsp *bsp,
+  blam_index_long      reference_index,
+  blam_index_long      plane_index,
+  const blam_real3d   *origin,
+  const blam_real3d   *delta,
   blam_real            fraction);
 
 /**
@@ -229,6 +687,130 @@ bool collision_surface_test3d(
   const blam_real3d   *origin,
   const blam_real3d   *delta);  
 
+/**
+ * \brief Tests the tested vector against a plane.
+ *
+ * The results are memoized for the duration of the query if built with 
+ * `BLAM_MEMOIZE`.
+ *
+ * \param [in,out] ctx         The test context.
+ * \param [in]     plane_index The index of the plane.
+ * \param [out]    test_origin Receives the plane test of the vector origin.
+ * \param [out]    dot_delta   Receives the scalar product of the plane normal and 
+ *                             the vector delta.
+ */
+static inline
+void test_vector_context_test_plane(
+  struct test_vector_context *ctx,
+  blam_index_long             plane_index,
+  blam_real_highp            *test_origin,
+  blam_real_highp            *dot_delta);
+
+/**
+ * \brief Tests if the tested vector intersects a surface, without projection.
+ *
+ * The results are memoized for the duration of the query if built with 
+ * `BLAM_MEMOIZE`.
+ *
+ * \param [in,out] ctx           The test context.
+ * \param [in]     surface_index The index of the surface to test against.
+ *
+ * \return The result of #collision_surface_test3d for the tested vector.
+ */
+static inline
+bool test_vector_context_test_surface(
+  struct test_vector_context *ctx,
+  blam_index_long             surface_index);
+
+/**
+ * \brief Tests if surfaces found through a BSP2D reference are known to pass 
+ *        validation against the tested vector.
+ *
+ * The reference must be certified (see `struct blam_collision_bsp_certification`),
+ * and the tested vector must not be nearly parallel to its plane, `ctx->plane`.
+ *
+ * \param [in] ctx             The test context.
+ * \param [in] reference_index The index of the BSP2D reference, or `-1`.
+ */
+static inline
+bool test_vector_context_reference_certified(
+  const struct test_vector_context *ctx,
+  blam_index_long                   reference_index);
+
+/**
+ * \brief Tests if a subtree can be traversed as if it were a single exterior leaf.
+ *
+ * This is the case when the previous leaf was exterior (or there was none), and
+ * the tested vector only reaches BSP exterior within the subtree. Then no leaf 
+ * below would be recorded or have a surface tested, and the leaf type stays 
+ * exterior throughout.
+ *
+ * \param [in] ctx        The test context.
+ * \param [in] node_index The index of the subtree root.
+ * \param [in] fraction   The distance to the start of the subtree.
+ * \param [in] terminal   The maximum distance to traverse the subtree to.
+ */
+static inline
+bool test_vector_context_test_empty_node(
+  const struct test_vector_context *ctx,
+  blam_index_long                   node_index,
+  blam_real                         fraction,
+  blam_real                         terminal);
+
+/**
+ * \brief Tests if a plane is nearly coplanar with `ctx->plane`.
+ *
+ * Planes in different classes (see `struct blam_collision_bsp_plane_classes`) are
+ * rejected with an integer compare, without testing their equations.
+ *
+ * \param [in] ctx         The test context.
+ * \param [in] plane_index The index of the plane.
+ */
+static inline
+bool test_vector_context_test_nearly_coplanar(
+  const struct test_vector_context *ctx,
+  blam_index_long                   plane_index);
+
+/**
+ * \brief Charges the budget of a test for some work.
+ *
+ * \param [in,out] ctx   The test context.
+ * \param [in]     visit If \c true, a visit is charged, otherwise a leak 
+ *                       resolution.
+ *
+ * \return \c true if the work may be done, or \c false if the budget is spent.
+ */
+static inline
+bool test_vector_context_charge(
+  struct test_vector_context *ctx,
+  bool                        visit);
+
+/**
+ * \brief Searches a subtree for the leaf containing a point, charging each node
+ *        descended as a visit.
+ *
+ * \param [in,out] ctx        The test context.
+ * \param [in]     root       The index of the subtree root.
+ * \param [in]     point      The point.
+ * \param [out]    leaf_index Receives the result of #blam_collision_bsp_search.
+ *
+ * \return \c true on success, or \c false if the budget ran out before a leaf 
+ *         was reached.
+ */
+static
+bool test_vector_context_search(
+  struct test_vector_context *ctx,
+  blam_index_long             root,
+  const blam_real3d          *point,
+  blam_index_long            *leaf_index);
+
+/**
+ * \brief Charges the work of a test to the budget it was given, if any.
+ */
+static
+void test_vector_context_settle_budget(
+  const struct test_vector_context *ctx);
+
 /**
  * \brief Determines the resolution action to take in order to resolve phantom BSP.
  *
@@ -242,13 +824,16 @@ bool collision_surface_test3d(
  *                             surface intersection (if any).
  * \param [in] surface_index   The index of the current intersected surface.
  *                             If `-1`, there was no intersected surface.
+ * \param [in] certified       If \c true, the current surface is known to pass 
+ *                             validation, so the quick test is skipped.
  */ 
 static
 enum phantom_bsp_resolution_method get_phantom_bsp_resolution_method(
-  const struct test_vector_context *ctx,
+  struct test_vector_context *ctx,
   bool            splits_interior,
   bool            commit_result,
-  blam_index_long surface_index);
+  blam_index_long surface_index,
+  bool            certified);
 
 /**
  * \brief Attempts to resolve a BSP leak (if any).
@@ -267,7 +852,7 @@ enum phantom_bsp_resolution_method get_phantom_bsp_resolution_method(
  */
 static 
 blam_index_long try_resolve_bsp_leak(
-  const struct test_vector_context *ctx,
+  struct test_vector_context *ctx,
   blam_index_long leaf_index,
   blam_real       fraction,
   bool            splits_interior,
@@ -281,33 +866,100 @@ blam_index_long test_vector_context_ext_push_node(
   if (ctx->ext.nodes.count >= 0x100)
     return 0x100;
   
+  // If the path would run into the remainder of the path to the interior leaf,
+  // the interior leaf path is cut back to the part both paths share.
+  const blam_long leaf_base = 0x100 - ctx->ext.nodes.leaf_count;
+  if (BLAM_UNLIKELY(ctx->ext.nodes.count >= leaf_base + ctx->ext.nodes.shared_count))
+    ctx->ext.nodes.leaf_count = ctx->ext.nodes.shared_count;
+  
   const blam_index_long handle = ctx->ext.nodes.count;
   ctx->ext.nodes.stack[ctx->ext.nodes.count++] = node_index;
   return handle;
 }
 
 static
-void test_vector_context_ext_pop_node(
+void test_vector_context_ext_restore_node(
   struct test_vector_context *ctx,
   blam_index_long handle)
 {
-  ctx->ext.nodes.count = handle;
+  // The node at handle is left untouched while the subtree below it is 
+  // traversed, so restoring it only requires truncating the stack above it.
+  const blam_long count = handle < 0x100 ? handle + 1 : 0x100;
+  
+  // Nodes past count that are on the path to the interior leaf are about to be
+  // overwritten, so move them to the top of the stack first.
+  const blam_long shared_count = ctx->ext.nodes.shared_count;
+  if (count < shared_count)
+  {
+    blam_index_long *const leaf_stack = ctx->ext.nodes.stack + 0x100 - ctx->ext.nodes.leaf_count;
+    memmove(
+      leaf_stack + count, 
+      ctx->ext.nodes.stack + count,
+      (shared_count - count) * sizeof(ctx->ext.nodes.stack[0]));
+    ctx->ext.nodes.shared_count = count;
+  }
+  
+  ctx->ext.nodes.count = count;
 }
 
+/**
+ * \brief Marks the current path as the path to the current interior leaf.
+ */
 static
-void test_vector_context_ext_restore_node(
-  struct test_vector_context *ctx,
-  blam_index_long node_index,
-  blam_index_long handle)
+void test_vector_context_ext_mark_leaf(
+  struct test_vector_context *ctx)
+{
+  ctx->ext.nodes.leaf_count   = ctx->ext.nodes.count;
+  ctx->ext.nodes.shared_count = ctx->ext.nodes.count;
+}
+
+/**
+ * \brief Gets a node on the path to the current or previous interior leaf.
+ *
+ * \param [in] ctx   The test context.
+ * \param [in] depth The depth of the node, less than `ctx->ext.nodes.leaf_count`.
+ *
+ * \return The index of the node at \a depth.
+ */
+static inline
+blam_index_long test_vector_context_ext_leaf_node(
+  const struct test_vector_context *ctx,
+  blam_long depth)
 {
-  test_vector_context_ext_pop_node(ctx, handle);
-  const blam_index_long new_handle = test_vector_context_ext_push_node(ctx, node_index);
-  assert(handle == new_handle);
+  return depth < ctx->ext.nodes.shared_count
+    ? ctx->ext.nodes.stack[depth]
+    : ctx->ext.nodes.stack[0x100 - ctx->ext.nodes.leaf_count + depth];
 }
 
 // -----------------------------------------------------------------------------
 // EXPOSED API
 
+void blam_collision_bsp_budget_init(
+  struct blam_collision_bsp_budget *const budget,
+  const blam_long                         query_attempts,
+  const blam_long                         query_visits,
+  const blam_long                         tick_attempts,
+  const blam_long                         tick_visits)
+{
+  assert(budget);
+  
+  memset(budget, 0, sizeof(*budget));
+  budget->query_attempts = query_attempts;
+  budget->query_visits   = query_visits;
+  budget->tick_attempts  = tick_attempts;
+  budget->tick_visits    = tick_visits;
+  blam_collision_bsp_budget_begin_tick(budget);
+}
+
+void blam_collision_bsp_budget_begin_tick(struct blam_collision_bsp_budget *const budget)
+{
+  assert(budget);
+  
+  budget->tick_attempts_left = budget->tick_attempts;
+  budget->tick_visits_left   = budget->tick_visits;
+  ++budget->stats.tick_count;
+}
+
 blam_index_long blam_collision_bsp_search(
   const collision_bsp *const bsp,
   blam_index_long            root,
@@ -322,7 +974,7 @@ blam_index_long blam_collision_bsp_search(
     // if root < 0, it is a leaf index (or -1 if outside of the bsp)
     while (root >= 0) {
       const node_type *const node = &nodes[root];
-      const int fwd = blam_plane3d_test(planes + node->plane, point) >= 0.0f;
+      const int fwd = blam_plane3d_test_front(planes + node->plane, point);
       root = node->children[fwd];
     }
     
@@ -330,49 +982,292 @@ blam_index_long blam_collision_bsp_search(
     return leaf_index;
 }
 
+blam_index_long blam_collision_bsp_search_incremental(
+  const collision_bsp *const            bsp,
+  const blam_real3d *const              point,
+  struct blam_structure_location *const location)
+{
+  const struct blam_collision_bsp_accel *const accel = blam_collision_bsp_accel_find(bsp);
+  const blam_index_long leaf_index = location->leaf;
+  
+  // A leaf is only bounded if the splits on its path decide it exactly.
+  if (accel != NULL && leaf_index >= 0 && leaf_index < accel->leaf_bounds.leaf_count
+    && accel->leaf_bounds.ranges[leaf_index].count > 0)
+  {
+    const blam_plane3d *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+    const struct blam_collision_bsp_leaf_bound_range *const range = &accel->leaf_bounds.ranges[leaf_index];
+    const struct blam_collision_bsp_leaf_bound *const bounds = &accel->leaf_bounds.bounds[range->first];
+    
+    bool inside = true;
+    for (blam_long i = 0; i < range->count && inside; ++i)
+    {
+      const int fwd = blam_plane3d_test_front(planes + bounds[i].plane, point);
+      inside = fwd == bounds[i].side;
+    }
+    
+    if (BLAM_LIKELY(inside))
+      return leaf_index;
+  }
+  
+  location->leaf = blam_collision_bsp_search(bsp, 0, point);
+  return location->leaf;
+}
+
 blam_bool blam_collision_bsp_test_vector(
   const collision_bsp *const bsp,
   const bit_vector           breakable_surfaces,
   const blam_real3d *const   origin,
   const blam_real3d *const   delta,
-  blam_real                  max_scale,
+  const blam_real            max_scale,
   const blam_flags_long      flags, // enum blam_collision_test_flags
   test_vector_result *const  data)
 {
-  assert(bsp);
-  assert(data);
+  return blam_collision_bsp_test_vector_coherent(
+    bsp, 
+    breakable_surfaces, 
+    origin, 
+    delta, 
+    max_scale, 
+    flags, 
+    NULL, 
+    data);
+}
+
+blam_bool blam_collision_bsp_test_vector_configured(
+  const struct blam_collision_bsp_config *const config,
+  const collision_bsp *const                    bsp,
+  const bit_vector                              breakable_surfaces,
+  const blam_real3d *const                      origin,
+  const blam_real3d *const                      delta,
+  const blam_real                               max_scale,
+  const blam_flags_long                         flags, // enum blam_collision_test_flags
+  test_vector_result *const                     data)
+{
+  assert(config);
+  assert(bsp);
+  
+  return collision_bsp_test_vector_query(&(struct test_vector_query)
+  {
+    .bsp                = bsp,
+    .breakable_surfaces = breakable_surfaces,
+    .origin             = origin,
+    .delta              = delta,
+    .max_scale          = max_scale,
+    .flags              = flags,
+    .config             = config,
+    .data               = data
+  });
+}
+
+blam_bool blam_collision_bsp_test_vector_coherent(
+  const collision_bsp *const                 bsp,
+  const bit_vector                           breakable_surfaces,
+  const blam_real3d *const                   origin,
+  const blam_real3d *const                   delta,
+  const blam_real                            max_scale,
+  const blam_flags_long                      flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_coherence *const coherence,
+  test_vector_result *const                  data)
+{
+  assert(bsp);
+  assert(data);
+  
+  return collision_bsp_test_vector_query(&(struct test_vector_query)
+  {
+    .bsp                = bsp,
+    .breakable_surfaces = breakable_surfaces,
+    .origin             = origin,
+    .delta              = delta,
+    .max_scale          = max_scale,
+    .flags              = flags,
+    .coherence          = coherence,
+    .data               = data
+  });
+}
 
-  struct test_vector_context ctx =
+blam_bool blam_collision_bsp_test_vector_lite(
+  const collision_bsp *const                       bsp,
+  const bit_vector                                 breakable_surfaces,
+  const blam_real3d *const                         origin,
+  const blam_real3d *const                         delta,
+  const blam_real                                  max_scale,
+  const blam_flags_long                            flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_hit *const hit)
+{
+  assert(bsp);
+  assert(hit);
+  
+  return collision_bsp_test_vector_query(&(struct test_vector_query)
   {
+    .bsp                = bsp,
+    .breakable_surfaces = breakable_surfaces,
+    .origin             = origin,
+    .delta              = delta,
+    .max_scale          = max_scale,
     .flags              = flags,
+    .hit                = hit
+  });
+}
+
+blam_long blam_collision_bsp_test_vector_all(
+  const collision_bsp *const                       bsp,
+  const bit_vector                                 breakable_surfaces,
+  const blam_real3d *const                         origin,
+  const blam_real3d *const                         delta,
+  const blam_real                                  max_scale,
+  const blam_flags_long                            flags, // enum blam_collision_test_flags
+  struct blam_collision_bsp_test_vector_hit *const hits,
+  const blam_long                                  hit_capacity)
+{
+  assert(bsp);
+  assert(hits || hit_capacity <= 0);
+  
+  if (hit_capacity <= 0)
+    return 0;
+  
+  blam_long hit_count = 0;
+  collision_bsp_test_vector_query(&(struct test_vector_query)
+  {
     .bsp                = bsp,
     .breakable_surfaces = breakable_surfaces,
     .origin             = origin,
     .delta              = delta,
-    .data               = data,
-    .leaf               = -1,
-    .leaf_type          = k_bsp_leaf_type_none,
-    .plane              = -1,
-    .ext                = 
+    .max_scale          = max_scale,
+    .flags              = flags,
+    .hits               = hits,
+    .hit_capacity       = hit_capacity,
+    .hit_count          = &hit_count
+  });
+  return hit_count;
+}
+
+blam_flags_long blam_collision_bsp_test_vector_packet(
+  const collision_bsp *const      bsp,
+  const bit_vector                breakable_surfaces,
+  const blam_real3d *const        origins,
+  const blam_real3d *const        deltas,
+  const blam_long                 count,
+  const blam_real                 max_scale,
+  const blam_flags_long           flags, // enum blam_collision_test_flags
+  test_vector_result *const       data)
+{
+  assert(bsp);
+  assert(count <= BLAM_COLLISION_BSP_PACKET_SIZE);
+  assert((origins && deltas && data) || count <= 0);
+  
+  if (count <= 0)
+    return 0;
+  
+  struct test_vector_packet packet;
+  packet.bsp                = bsp;
+  packet.breakable_surfaces = breakable_surfaces;
+  packet.config             = NULL;
+  packet.origins            = origins;
+  packet.deltas             = deltas;
+  packet.count              = count;
+  packet.max_scale          = max_scale;
+  packet.flags              = flags;
+  packet.data               = data;
+  
+  packet.terminal = max_scale;
+  if (BLAM_UNLIKELY(packet.terminal < 0.0f))
+    packet.terminal = 0.0f;
+  else if (BLAM_UNLIKELY(packet.terminal > 1.0f))
+    packet.terminal = 1.0f;
+  
+  for (blam_long i = 0; i < BLAM_COLLISION_BSP_PACKET_SIZE; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
     {
-      .just_encountered_leak = false,
-      .has_pending_result    = false,
+      packet.lane_origins[j][i] = i < count ? origins[i].components[j] : 0.0f;
+      packet.lane_deltas[j][i]  = i < count ? deltas[i].components[j]  : 0.0f;
     }
-  };
-  data->fraction     = fmax(max_scale, 0.0f); // Halo doesnt fully clamp here
-  data->leaves.count = 0;
-
-  const blam_index_long root = 0;
-  const blam_real       start_fraction = 0.0f;
-  if (BLAM_UNLIKELY(max_scale < 0.0f))
-    max_scale = 0.0f;
-  else if (BLAM_UNLIKELY(max_scale > 1.0f))
-    max_scale = 1.0f;
+  }
+  
+  const blam_flags_long lanes = (blam_flags_long)((1UL << count) - 1);
+  return collision_bsp_test_vector_packet_node(&packet, 0, lanes, 0);
+}
 
-  if (collision_bsp_test_vector_node(&ctx, root, start_fraction, max_scale))
-    return true;
-  else
-    return test_vector_context_try_commit_pending_result(&ctx);
+blam_long blam_collision_bsp_test_vector_interleaved(
+  const struct blam_collision_bsp_config *const       config,
+  const collision_bsp *const                          bsp,
+  const bit_vector                                    breakable_surfaces,
+  const struct blam_collision_bsp_batch_query *const  queries,
+  const blam_long                                     count,
+  test_vector_result *const                           results,
+  blam_bool *const                                    hits)
+{
+  assert(bsp);
+  assert(queries || count <= 0);
+  
+  struct test_vector_lane lanes[BLAM_COLLISION_BSP_INTERLEAVE_WIDTH];
+  for (int i = 0; i < BLAM_COLLISION_BSP_INTERLEAVE_WIDTH; ++i)
+    lanes[i].query = -1;
+  
+  blam_long next      = 0;
+  blam_long active    = 0;
+  blam_long hit_count = 0;
+  do
+  {
+    for (int i = 0; i < BLAM_COLLISION_BSP_INTERLEAVE_WIDTH; ++i)
+    {
+      struct test_vector_lane *const lane = &lanes[i];
+      if (lane->query == -1)
+      {
+        if (next >= count)
+          continue;
+        
+        // Clamped as in collision_bsp_test_vector_query.
+        blam_real terminal = queries[next].max_scale;
+        if (BLAM_UNLIKELY(terminal < 0.0f))
+          terminal = 0.0f;
+        else if (BLAM_UNLIKELY(terminal > 1.0f))
+          terminal = 1.0f;
+        
+        lane->query    = next++;
+        lane->node     = 0;
+        lane->plane    = -1;
+        lane->terminal = terminal;
+        lane->depth    = 0;
+        ++active;
+      }
+      
+      const struct blam_collision_bsp_batch_query *const query = &queries[lane->query];
+      if (!collision_bsp_interleave_step(bsp, query, lane))
+        continue;
+      
+      // The rest of the test is run from where the vector was located, without
+      // interleaving. Most vectors are located in a leaf, which ends the test.
+      const struct test_vector_start start = 
+      {
+        .node  = lane->node,
+        .depth = lane->depth,
+        .path  = lane->path
+      };
+      
+      const blam_bool hit = collision_bsp_test_vector_query(&(struct test_vector_query)
+      {
+        .bsp                = bsp,
+        .breakable_surfaces = breakable_surfaces,
+        .origin             = &query->origin,
+        .delta              = &query->delta,
+        .max_scale          = query->max_scale,
+        .flags              = query->flags,
+        .config             = config,
+        .start              = &start,
+        .data               = results != NULL ? &results[lane->query] : NULL
+      });
+      
+      if (hits != NULL)
+        hits[lane->query] = hit;
+      hit_count += hit ? 1 : 0;
+      
+      lane->query = -1;
+      --active;
+    }
+  } while (active > 0 || next < count);
+  
+  return hit_count;
 }
 
 // -----------------------------------------------------------------------------
@@ -412,12 +1307,16 @@ blam_index_long collision_bsp_search_leaf(
   const bool                 splits_interior,
   const blam_real3d *const   origin,
   const blam_real3d *const   delta,
-  const blam_real            fraction)
+  const blam_real            fraction,
+  blam_index_long *const     reference_index)
 {
   assert(bsp);
   assert(origin);
   assert(delta);
 
+  if (reference_index)
+    *reference_index = -1;
+  
   const blam_real3d terminal = blam_real3d_from_implicit(origin, delta, fraction);
   
   typedef struct blam_bsp3d_leaf      leaf_type;
@@ -463,10 +1362,15 @@ blam_index_long collision_bsp_search_leaf(
     // Furthermore, if we validate against surface data in infinite precision, we 
     // punch holes into the BSP because phantom BSP can occur over surfaces in 
     // another leaf. 
-    if (!splits_interior)
+    const bool hit = !splits_interior
+      || collision_surface_test2d(bsp, breakable_surfaces, surface_index, projection_plane, is_forward_plane, &projection);
+    
+    if (hit)
+    {
+      if (reference_index && surface_index != -1)
+        *reference_index = leaf->first_reference + (blam_index_long)(ref - references);
       return surface_index;
-    else if (collision_surface_test2d(bsp, breakable_surfaces, surface_index, projection_plane, is_forward_plane, &projection))
-      return surface_index; 
+    }
   }
   
   // NOTE: If splits_interior is false, then the plane splits the BSP interior
@@ -475,6 +1379,32 @@ blam_index_long collision_bsp_search_leaf(
   return -1;
 }
 
+blam_index_long collision_bsp_search_reference(
+  const collision_bsp *const bsp,
+  const blam_index_long      reference_index,
+  const blam_index_long      plane_index,
+  const blam_real3d *const   origin,
+  const blam_real3d *const   delta,
+  const blam_real            fraction)
+{
+  assert(bsp);
+  assert(origin);
+  assert(delta);
+  
+  const blam_real3d terminal = blam_real3d_from_implicit(origin, delta, fraction);
+  
+  const struct blam_bsp2d_reference *const ref = BLAM_TAG_BLOCK_GET(&bsp->bsp2d, ref, references, reference_index);
+  
+  const blam_plane3d *const plane                   = BLAM_TAG_BLOCK_GET(bsp, plane, planes, plane_index);
+  const enum blam_projection_plane projection_plane = blam_real3d_projection_plane(&plane->normal);
+  const bool projection_inverted                    = plane->normal.components[projection_plane] <= 0.0f;
+  
+  const bool is_forward_plane = projection_inverted == (ref->plane < 0);
+  const blam_real2d projection = blam_real3d_projected_components(&terminal, projection_plane, is_forward_plane);
+  
+  return blam_bsp2d_search(&bsp->bsp2d, ref->root_node, &projection);
+}
+
 blam_index_long blam_bsp2d_search(
   const struct blam_bsp2d *bsp,
   blam_index_long          root,
@@ -486,7 +1416,7 @@ blam_index_long blam_bsp2d_search(
   while (root >= 0)
   {
     const struct blam_bsp2d_node *const node = BLAM_TAG_BLOCK_GET(bsp, node, nodes, root);
-    root = node->children[blam_plane2d_test(&node->plane, point) >= 0.0];
+    root = node->children[blam_plane2d_test_front(&node->plane, point)];
   }
   
   const blam_index_long surface_index = blam_sanitize_long_s(root);
@@ -543,9 +1473,9 @@ blam_bool collision_surface_test2d(
     const blam_real2d edge_delta  = blam_real2d_sub(&p1, &p0);
     
     // This is the way Halo performs this test, argument order preserved.
-    const blam_real_highp determinant = blam_real2d_det(&point_delta, &edge_delta);
-    
-    if (determinant > 0.0)
+    // (NON-VANILLA) The determinant is only computed in double precision when 
+    // its sign is in doubt.
+    if (blam_real2d_det_positive(&point_delta, &edge_delta))
         return false; // point is outside of surface
     
     next_edge = blam_collision_edge_inorder_edge(edge, surface_index);
@@ -606,10 +1536,11 @@ bool collision_surface_test3d(
 }
 
 enum phantom_bsp_resolution_method get_phantom_bsp_resolution_method(
-  const struct test_vector_context *ctx,
+  struct test_vector_context *ctx,
   bool            splits_interior,
   bool            commit_result,
-  blam_index_long surface_index)
+  blam_index_long surface_index,
+  bool            certified)
 {
   // Strategy: Observe that phantom BSP must be followed by a BSP leak.
   //           Therefore, if a surface is suspected to be phantom BSP, it can be 
@@ -635,19 +1566,14 @@ enum phantom_bsp_resolution_method get_phantom_bsp_resolution_method(
   {
     // User was not interested in this surface, so stop here.
     return k_resolution_method_reject_current;
-  } else if (!mitigate_phantom_bsp || !may_require_validation) 
+  } else if (!ctx->config->mitigate_phantom_bsp || !may_require_validation) 
   {
     // Phantom BSP mitigations are off or validation is not required for this 
     // surface, so stop here.
     return k_resolution_method_proceed;
   }
   
-  const bool validated = collision_surface_test3d(
-    ctx->bsp,
-    ctx->breakable_surfaces,
-    surface_index,
-    ctx->origin,
-    ctx->delta);
+  const bool validated = certified || test_vector_context_test_surface(ctx, surface_index);
   
   if (validated)
   {
@@ -674,7 +1600,7 @@ enum phantom_bsp_resolution_method get_phantom_bsp_resolution_method(
 }
 
 blam_index_long try_resolve_bsp_leak(
-  const struct test_vector_context *ctx,
+  struct test_vector_context *ctx,
   blam_index_long leaf_index,
   blam_real       fraction,
   bool            splits_interior,
@@ -683,54 +1609,89 @@ blam_index_long try_resolve_bsp_leak(
   assert(ctx);
   assert(leaf_index != -1);
   
-  if (!mitigate_bsp_leaks)
+  if (!ctx->config->mitigate_bsp_leaks)
     return surface_index; // not mitigating leaks
   else if (surface_index != -1)
     return surface_index; // the surface is already resolved
   else if (splits_interior)
     return surface_index; // no surface, but thats a valid result for interior split
+  
+  // (NON-VANILLA) Once the budget of the test is spent, the leak is allowed to 
+  // occur, as it would in Halo.
+  if (!test_vector_context_charge(ctx, false))
+    return surface_index;
  
-  const blam_index_long *stack = ctx->ext.leaf_nodes.stack;
-  blam_index_long stack_size   = ctx->ext.leaf_nodes.count;
-  assert(stack_size > 0); // includes the leaf
+  assert(ctx->ext.nodes.leaf_count > 0); // includes the leaf
   
   typedef struct blam_bsp3d_node node_type;
-  typedef struct blam_plane3d    plane_type;
-  const node_type  *const nodes  = BLAM_TAG_BLOCK_BASE(ctx->bsp, nodes,  bsp3d_nodes);
-  const plane_type *const planes = BLAM_TAG_BLOCK_BASE(ctx->bsp, planes, planes);
-  const plane_type *plane = &planes[ctx->plane];
+  const node_type *const nodes = BLAM_TAG_BLOCK_BASE(ctx->bsp, nodes, bsp3d_nodes);
   
   // FORM 1 BSP LEAK: There is a BSP2D reference in this leaf associated with the 
   //                  surface hit, but ctx->plane is incorrect. Typically, the 
   //                  correct plane is up the path to the BSP root, so simply look 
   //                  for a plane that is nearly coplanar with ctx->plane.
-  for (const blam_index_long *it = stack + stack_size - 1; it != stack; --it)
+  //
+  // If the leaf has a precomputed leak table entry and the path to the leaf is 
+  // the one it was computed against, then only its candidates need searching.
+  const blam_long       leaf_count = ctx->ext.nodes.leaf_count;
+  const blam_index_long leaf_node  = test_vector_context_ext_leaf_node(ctx, leaf_count - 1);
+  if (ctx->accel != NULL
+    && leaf_node < 0 && blam_sanitize_long_s(leaf_node) == leaf_index
+    && blam_collision_bsp_leak_table_covers(&ctx->accel->leak_table, leaf_index))
   {
-    const blam_index_long node_index = *it;
-    if (node_index < 0)
-      continue; // leaf
+    const struct blam_collision_bsp_leak_table *const table = &ctx->accel->leak_table;
+    const struct blam_collision_bsp_leak_entry *const entry = blam_collision_bsp_leak_table_find(table, leaf_index, ctx->plane);
     
-    const node_type *const root = &nodes[node_index];
-    if (root->plane == ctx->plane)
-      continue;
+    for (blam_long i = 0; entry != NULL && i < entry->candidate_count; ++i)
+    {
+      if (!test_vector_context_charge(ctx, true))
+        return surface_index;
+      
+      const struct blam_collision_bsp_leak_candidate *const candidate = &table->candidates[entry->first_candidate + i];
+      const blam_index_long candidate_surface_index = collision_bsp_search_reference(
+        ctx->bsp,
+        candidate->reference,
+        candidate->plane,
+        ctx->origin,
+        ctx->delta,
+        fraction);
+      
+      if (test_vector_context_test_surface(ctx, candidate_surface_index))
+        return candidate_surface_index;
+    }
+  } else
+  {
+    for (blam_long depth = leaf_count - 1; depth > 0; --depth)
+    {
+      if (!test_vector_context_charge(ctx, true))
+        return surface_index;
+      
+      const blam_index_long node_index = test_vector_context_ext_leaf_node(ctx, depth);
+      if (node_index < 0)
+        continue; // leaf
     
-    const plane_type *const root_plane = &planes[root->plane];
-    if (!blam_plane3d_test_nearly_coplanar(plane, root_plane))
-      continue;
+      const node_type *const root = &nodes[node_index];
+      if (root->plane == ctx->plane)
+        continue;
     
-    // try to search the leaf at leaf_index for root->plane instead
-    const blam_index_long candidate_surface_index = collision_bsp_search_leaf(
-      ctx->bsp,
-      ctx->breakable_surfaces,
-      leaf_index,
-      root->plane,
-      splits_interior,
-      ctx->origin,
-      ctx->delta,
-      fraction);
+      if (!test_vector_context_test_nearly_coplanar(ctx, root->plane))
+        continue;
     
-    if (collision_surface_test3d(ctx->bsp, ctx->breakable_surfaces, candidate_surface_index, ctx->origin, ctx->delta))
-      return candidate_surface_index;
+      // try to search the leaf at leaf_index for root->plane instead
+      const blam_index_long candidate_surface_index = collision_bsp_search_leaf(
+        ctx->bsp,
+        ctx->breakable_surfaces,
+        leaf_index,
+        root->plane,
+        splits_interior,
+        ctx->origin,
+        ctx->delta,
+        fraction,
+        NULL);
+    
+      if (test_vector_context_test_surface(ctx, candidate_surface_index))
+        return candidate_surface_index;
+    }
   }
   
   // FORM 2 BSP LEAK: The leaf we're looking for is down another part of the tree.
@@ -738,32 +1699,36 @@ blam_index_long try_resolve_bsp_leak(
   //                  The resolution involves locating a nearly-coplanar split 
   //                  as before, and then find out which leaf is on the other side 
   //                  of that split. 
-  stack      = ctx->ext.nodes.stack;
-  stack_size = ctx->ext.nodes.count;
+  const blam_index_long *const stack = ctx->ext.nodes.stack;
+  const blam_long stack_size = ctx->ext.nodes.count;
   assert(stack_size > 0); // includes the leaf
   
   const blam_real3d intersection = blam_real3d_from_implicit(ctx->origin, ctx->delta, fraction);
   for (const blam_index_long *it = stack + stack_size - 1; it != stack; --it)
   {
+    if (!test_vector_context_charge(ctx, true))
+      return surface_index;
+    
     const blam_index_long child_index = *it;
     const blam_index_long root_index = *(it - 1);
     
     const node_type *const root = &nodes[root_index];
-    const plane_type *const root_plane = &planes[root->plane];    
-    
-    if (!blam_plane3d_test_nearly_coplanar(plane, root_plane))
+    if (!test_vector_context_test_nearly_coplanar(ctx, root->plane))
        continue;
     
     const blam_index_long other_child_index = root->children[root->children[0] == child_index ? 1 : 0];
-    const blam_index_long candidate_leaf_index = blam_collision_bsp_search(
-      ctx->bsp,
-      other_child_index,
-      &intersection);
+    blam_index_long candidate_leaf_index;
+    if (!test_vector_context_search(ctx, other_child_index, &intersection, &candidate_leaf_index))
+      return surface_index;
     
     if (candidate_leaf_index == -1)
       break; // If we search from higher up the tree, we get the same leaf.
     
     // Search for a surface in this candidate leaf associated with root->plane.
+    // Each search of the leaf is charged as a visit.
+    if (!test_vector_context_charge(ctx, true))
+      return surface_index;
+    
     blam_index_long candidate_surface_index = collision_bsp_search_leaf(
       ctx->bsp,
       ctx->breakable_surfaces,
@@ -772,10 +1737,14 @@ blam_index_long try_resolve_bsp_leak(
       splits_interior,
       ctx->origin,
       ctx->delta,
-      fraction);
+      fraction,
+      NULL);
     if (candidate_surface_index == -1)
     {
       // Try again, but with ctx->plane instead.
+      if (!test_vector_context_charge(ctx, true))
+        return surface_index;
+      
       candidate_surface_index = collision_bsp_search_leaf(
         ctx->bsp,
         ctx->breakable_surfaces,
@@ -784,11 +1753,12 @@ blam_index_long try_resolve_bsp_leak(
         splits_interior,
         ctx->origin,
         ctx->delta,
-        fraction);
+        fraction,
+        NULL);
     }
     
     // Verify that we have good surface here.
-    if (collision_surface_test3d(ctx->bsp, ctx->breakable_surfaces, candidate_surface_index, ctx->origin, ctx->delta))
+    if (test_vector_context_test_surface(ctx, candidate_surface_index))
       return candidate_surface_index;
     else
       break; // If we search from higher up the tree, we get the same leaf.
@@ -797,6 +1767,516 @@ blam_index_long try_resolve_bsp_leak(
   return surface_index; // no candidate verified
 }
 
+blam_bool collision_bsp_test_vector_query(
+  const struct test_vector_query *const query)
+{
+  const collision_bsp *const                 bsp       = query->bsp;
+  const blam_real3d *const                   origin    = query->origin;
+  const blam_real3d *const                   delta     = query->delta;
+  const struct test_vector_start *const      start     = query->start;
+  struct blam_collision_bsp_coherence *const coherence = query->coherence;
+  test_vector_result *const                  data      = query->data;
+  blam_real                                  max_scale = query->max_scale;
+  
+  if (query->hit_count != NULL)
+    *query->hit_count = 0;
+  
+  const blam_real initial_fraction = fmax(max_scale, 0.0f); // Halo doesnt fully clamp here
+  if (data != NULL)
+  {
+    data->fraction     = initial_fraction;
+    data->leaves.count = 0;
+  }
+  if (query->hit != NULL)
+    query->hit->fraction = initial_fraction;
+
+  const blam_index_long root = 0;
+  const blam_real       start_fraction = 0.0f;
+  if (BLAM_UNLIKELY(max_scale < 0.0f))
+    max_scale = 0.0f;
+  else if (BLAM_UNLIKELY(max_scale > 1.0f))
+    max_scale = 1.0f;
+
+  // (NON-VANILLA) Descend until the vector is split, starting from where the 
+  // previous vector of the caller was located if this one is still there. The
+  // nodes descended through are pushed onto the node path as the traversal would.
+  struct test_vector_context ctx;
+  blam_long       depth  = 0;
+  blam_real_highp radius = INFINITY;
+  
+  blam_index_long located = root;
+  if (start != NULL)
+  {
+    memcpy(ctx.ext.nodes.stack, start->path, start->depth * sizeof(ctx.ext.nodes.stack[0]));
+    depth   = start->depth;
+    located = start->node;
+  } else if (coherence != NULL)
+    located = collision_bsp_coherence_resume(coherence, bsp, origin, delta, max_scale, ctx.ext.nodes.stack, &depth, &radius);
+  
+  located = collision_bsp_locate_vector(bsp, located, origin, delta, max_scale, ctx.ext.nodes.stack, &depth, &radius);
+  
+  if (coherence != NULL)
+    collision_bsp_coherence_update(coherence, bsp, origin, delta, max_scale, located, ctx.ext.nodes.stack, depth, radius);
+  
+  // (NON-VANILLA) A vector within a single leaf crosses no plane, so nothing is
+  // tested and only that leaf is recorded. There is no need to set up a context.
+  if (BLAM_LIKELY(located < 0))
+  {
+    const blam_index_long leaf = blam_sanitize_long_s(located);
+    if (leaf != -1 && data != NULL)
+      data->leaves.stack[data->leaves.count++] = leaf;
+    return false;
+  }
+
+  test_vector_context_init(&ctx, bsp, query->breakable_surfaces, origin, delta, query->flags, query->config, data, initial_fraction);
+  ctx.ext.nodes.count = depth;
+  ctx.hit             = query->hit;
+  ctx.hits            = query->hits;
+  ctx.hit_capacity    = query->hit_capacity;
+
+  const blam_bool result = collision_bsp_test_vector_node(&ctx, located, start_fraction, max_scale)
+    || test_vector_context_try_commit_pending_result(&ctx);
+  
+  test_vector_context_settle_budget(&ctx);
+  if (query->hit_count != NULL)
+    *query->hit_count = ctx.hit_count;
+  return result;
+}
+
+blam_flags_long collision_bsp_test_vector_packet_node(
+  struct test_vector_packet *const packet,
+  blam_index_long                  root,
+  blam_flags_long                  lanes,
+  blam_long                        depth)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(packet->bsp, nodes,  bsp3d_nodes);
+  const struct blam_plane3d    *const planes = BLAM_TAG_BLOCK_BASE(packet->bsp, planes, planes);
+  const blam_real fraction = 0.0f;
+  const blam_real terminal = packet->terminal;
+  
+  blam_flags_long result = 0;
+  while (root >= 0 && lanes != 0)
+  {
+    const struct blam_plane3d *const plane = &planes[nodes[root].plane];
+    const blam_real nx = plane->normal.components[0];
+    const blam_real ny = plane->normal.components[1];
+    const blam_real nz = plane->normal.components[2];
+    const blam_real d  = plane->d;
+    
+    // Every lane is tested, unused ones included, so that the loop can be 
+    // vectorized. The tests are filtered as in blam_plane3d_test_front; they are
+    // made in single precision, and only lanes whose sides are in doubt are 
+    // tested again as collision_bsp_locate_vector would.
+    int befores[BLAM_COLLISION_BSP_PACKET_SIZE];
+    int afters[BLAM_COLLISION_BSP_PACKET_SIZE];
+    int certains[BLAM_COLLISION_BSP_PACKET_SIZE];
+    for (int i = 0; i < BLAM_COLLISION_BSP_PACKET_SIZE; ++i)
+    {
+      const blam_real o0 = nx * packet->lane_origins[0][i];
+      const blam_real o1 = ny * packet->lane_origins[1][i];
+      const blam_real o2 = nz * packet->lane_origins[2][i];
+      const blam_real e0 = nx * packet->lane_deltas[0][i];
+      const blam_real e1 = ny * packet->lane_deltas[1][i];
+      const blam_real e2 = nz * packet->lane_deltas[2][i];
+      const blam_real test_origin   = o0 + o1 + o2 - d;
+      const blam_real dot_delta     = e0 + e1 + e2;
+      const blam_real point_test    = test_origin + fraction * dot_delta;
+      const blam_real terminal_test = test_origin + terminal * dot_delta;
+      
+      const blam_real origin_magnitude   = fabs(o0) + fabs(o1) + fabs(o2) + fabs(d);
+      const blam_real delta_magnitude    = fabs(e0) + fabs(e1) + fabs(e2);
+      const blam_real point_bound        = (origin_magnitude + fraction * delta_magnitude) 
+        * BLAM_REAL_FILTER_RELATIVE_ERROR + BLAM_REAL_FILTER_ABSOLUTE_ERROR;
+      const blam_real terminal_bound     = (origin_magnitude + terminal * delta_magnitude) 
+        * BLAM_REAL_FILTER_RELATIVE_ERROR + BLAM_REAL_FILTER_ABSOLUTE_ERROR;
+      
+      befores[i]  = (point_test < 0.0f)  | (terminal_test < 0.0f);
+      afters[i]   = (point_test >= 0.0f) | (terminal_test >= 0.0f);
+      certains[i] = (fabs(point_test) > point_bound) & (fabs(terminal_test) > terminal_bound);
+    }
+    
+    blam_flags_long any_before = 0;
+    blam_flags_long any_after  = 0;
+    blam_flags_long certain    = 0;
+    for (int i = 0; i < BLAM_COLLISION_BSP_PACKET_SIZE; ++i)
+    {
+      any_before |= (blam_flags_long)befores[i]  << i;
+      any_after  |= (blam_flags_long)afters[i]   << i;
+      certain    |= (blam_flags_long)certains[i] << i;
+    }
+    
+    const blam_flags_long doubtful = lanes & ~certain;
+    for (blam_long i = 0; doubtful != 0 && i < packet->count; ++i)
+    {
+      if ((doubtful & (1L << i)) == 0)
+        continue;
+      
+      const blam_real_highp test_origin   = blam_plane3d_test(plane, &packet->origins[i]);
+      const blam_real_highp dot_delta     = blam_real3d_dot(&plane->normal, &packet->deltas[i]);
+      const blam_real_highp point_test    = test_origin + fraction * dot_delta;
+      const blam_real_highp terminal_test = test_origin + terminal * dot_delta;
+      const blam_flags_long bit = 1L << i;
+      any_before = (point_test < 0.0)  || (terminal_test < 0.0)  ? any_before | bit : any_before & ~bit;
+      any_after  = (point_test >= 0.0) || (terminal_test >= 0.0) ? any_after  | bit : any_after  & ~bit;
+    }
+    
+    if ((lanes & any_before & any_after) != 0)
+      break;
+    
+    // The node path stops growing once full, as in collision_bsp_locate_vector.
+    if (depth < 0x100)
+      packet->path[depth++] = root;
+    
+    const blam_flags_long after  = lanes & any_after;
+    const blam_flags_long before = lanes & ~any_after;
+    if (after != 0 && before != 0)
+      result |= collision_bsp_test_vector_packet_node(packet, nodes[root].children[0], before, depth);
+    
+    root  = nodes[root].children[after != 0 ? 1 : 0];
+    lanes = after != 0 ? after : before;
+  }
+  
+  // Each remaining vector carries on alone from here.
+  const struct test_vector_start start = 
+  {
+    .node  = root,
+    .depth = depth,
+    .path  = packet->path
+  };
+  
+  for (blam_long i = 0; i < packet->count; ++i)
+  {
+    if ((lanes & (1L << i)) == 0)
+      continue;
+    
+    const blam_bool hit = collision_bsp_test_vector_query(&(struct test_vector_query)
+    {
+      .bsp                = packet->bsp,
+      .breakable_surfaces = packet->breakable_surfaces,
+      .origin             = &packet->origins[i],
+      .delta              = &packet->deltas[i],
+      .max_scale          = packet->max_scale,
+      .flags              = packet->flags,
+      .config             = packet->config,
+      .start              = &start,
+      .data               = &packet->data[i]
+    });
+    if (hit)
+      result |= 1L << i;
+  }
+  
+  return result;
+}
+
+bool collision_bsp_interleave_step(
+  const collision_bsp *const                         bsp,
+  const struct blam_collision_bsp_batch_query *const query,
+  struct test_vector_lane *const                     lane)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes,  bsp3d_nodes);
+  const struct blam_plane3d    *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  
+  if (lane->node < 0)
+    return true;
+  
+  const struct blam_bsp3d_node *const node = &nodes[lane->node];
+  if (lane->plane == -1)
+  {
+    lane->plane = node->plane;
+    BLAM_PREFETCH(&planes[lane->plane]);
+    return false;
+  }
+  
+  // Same tests as collision_bsp_locate_vector, which carries on from here.
+  const struct blam_plane3d *const plane = &planes[lane->plane];
+  const blam_real fraction = 0.0f;
+  const blam_real_highp test_origin   = blam_plane3d_test(plane, &query->origin);
+  const blam_real_highp dot_delta     = blam_real3d_dot(&plane->normal, &query->delta);
+  const blam_real_highp point_test    = test_origin + fraction * dot_delta;
+  const blam_real_highp terminal_test = test_origin + lane->terminal * dot_delta;
+  const bool any_before = (point_test < 0.0) || (terminal_test < 0.0);
+  const bool any_after  = (point_test >= 0.0) || (terminal_test >= 0.0);
+  
+  if (any_before && any_after)
+    return true;
+  
+  if (lane->depth < 0x100)
+    lane->path[lane->depth++] = lane->node;
+  
+  lane->node  = node->children[any_after ? 1 : 0];
+  lane->plane = -1;
+  if (lane->node < 0)
+    return true;
+  
+  BLAM_PREFETCH(&nodes[lane->node]);
+  return false;
+}
+
+void test_vector_context_init(
+  struct test_vector_context *const ctx,
+  const collision_bsp *const        bsp,
+  const bit_vector                  breakable_surfaces,
+  const blam_real3d *const          origin,
+  const blam_real3d *const          delta,
+  const blam_flags_long             flags,
+  const struct blam_collision_bsp_config *const config,
+  test_vector_result *const         data,
+  const blam_real                   fraction)
+{
+  ctx->flags              = flags;
+  ctx->bsp                = bsp;
+  ctx->breakable_surfaces = breakable_surfaces;
+  ctx->origin             = origin;
+  ctx->delta              = delta;
+  ctx->data               = data;
+  ctx->fraction           = fraction;
+  ctx->hit                = NULL;
+  ctx->hits               = NULL;
+  ctx->hit_count          = 0;
+  ctx->hit_capacity       = 0;
+  ctx->accel              = blam_collision_bsp_accel_find(bsp);
+  ctx->config             = config != NULL ? config : &blam_collision_bsp_default_config;
+  ctx->leaf               = -1;
+  ctx->leaf_type          = k_bsp_leaf_type_none;
+  ctx->plane              = -1;
+  
+  // (NON-VANILLA) Decode the flags and mitigations that decide which surfaces 
+  // are tested between leaves once, rather than on every leaf.
+  const bool mitigate_phantom_bsp = ctx->config->mitigate_phantom_bsp;
+  ctx->leaf_mode = 0;
+  if ((flags & k_collision_test_front_facing_surfaces) != 0 || mitigate_phantom_bsp)
+    ctx->leaf_mode |= k_leaf_mode_front_facing;
+  if ((flags & k_collision_test_back_facing_surfaces) != 0 || mitigate_phantom_bsp)
+    ctx->leaf_mode |= k_leaf_mode_back_facing;
+  if ((flags & k_collision_test_ignore_two_sided_surfaces) == 0)
+    ctx->leaf_mode |= k_leaf_mode_double_sided;
+  if (ctx->config->mitigate_bsp_leaks)
+    ctx->leaf_mode |= k_leaf_mode_leaks;
+  
+  // (NON-VANILLA) Run against the repaired copy of the BSP, if there is one.
+  if (ctx->accel != NULL)
+    ctx->bsp = blam_collision_bsp_accel_target(ctx->accel);
+  
+  // (NON-VANILLA) A test gets the budget left to the tick, up to its own.
+  struct blam_collision_bsp_budget *const budget = ctx->config->budget;
+  ctx->budget.source         = budget;
+  ctx->budget.attempts       = TEST_VECTOR_BUDGET_UNLIMITED;
+  ctx->budget.visits         = TEST_VECTOR_BUDGET_UNLIMITED;
+  ctx->budget.attempts_spent = 0;
+  ctx->budget.visits_spent   = 0;
+  ctx->budget.exhausted      = false;
+  if (budget != NULL)
+  {
+    if (budget->query_attempts >= 0)
+      ctx->budget.attempts = budget->query_attempts;
+    if (budget->tick_attempts >= 0 && budget->tick_attempts_left < ctx->budget.attempts)
+      ctx->budget.attempts = budget->tick_attempts_left;
+    if (budget->query_visits >= 0)
+      ctx->budget.visits = budget->query_visits;
+    if (budget->tick_visits >= 0 && budget->tick_visits_left < ctx->budget.visits)
+      ctx->budget.visits = budget->tick_visits_left;
+  }
+  
+  ctx->ext.just_encountered_leak = false;
+  ctx->ext.has_pending_result    = false;
+  ctx->ext.nodes.count           = 0;
+  ctx->ext.nodes.leaf_count      = 0;
+  ctx->ext.nodes.shared_count    = 0;
+  
+#ifdef BLAM_MEMOIZE
+  ctx->memo.valid_planes   = 0;
+  ctx->memo.valid_surfaces = 0;
+#endif // BLAM_MEMOIZE
+}
+
+void test_vector_context_test_plane(
+  struct test_vector_context *const ctx,
+  const blam_index_long             plane_index,
+  blam_real_highp *const            test_origin,
+  blam_real_highp *const            dot_delta)
+{
+#ifdef BLAM_MEMOIZE
+  const int slot = plane_index & (TEST_VECTOR_MEMO_PLANES - 1);
+  const uint64_t slot_bit = (uint64_t)1 << slot;
+  if ((ctx->memo.valid_planes & slot_bit) && ctx->memo.planes[slot].plane == plane_index)
+  {
+    *test_origin = ctx->memo.planes[slot].test_origin;
+    *dot_delta   = ctx->memo.planes[slot].dot_delta;
+    return;
+  }
+#endif // BLAM_MEMOIZE
+  
+  const struct blam_plane3d *const plane = BLAM_TAG_BLOCK_GET(ctx->bsp, plane, planes, plane_index);
+  *test_origin = blam_plane3d_test(plane, ctx->origin);
+  *dot_delta   = blam_real3d_dot(&plane->normal, ctx->delta);
+  
+#ifdef BLAM_MEMOIZE
+  ctx->memo.valid_planes |= slot_bit;
+  ctx->memo.planes[slot].plane       = plane_index;
+  ctx->memo.planes[slot].test_origin = *test_origin;
+  ctx->memo.planes[slot].dot_delta   = *dot_delta;
+#endif // BLAM_MEMOIZE
+}
+
+bool test_vector_context_test_surface(
+  struct test_vector_context *const ctx,
+  const blam_index_long             surface_index)
+{
+  if (surface_index == -1)
+    return false;
+  
+#ifdef BLAM_MEMOIZE
+  const int slot = surface_index & (TEST_VECTOR_MEMO_SURFACES - 1);
+  const uint32_t slot_bit = (uint32_t)1 << slot;
+  if ((ctx->memo.valid_surfaces & slot_bit) && ctx->memo.surfaces[slot] == surface_index)
+    return (ctx->memo.surface_results & slot_bit) != 0;
+#endif // BLAM_MEMOIZE
+  
+  const bool result = collision_surface_test3d(
+    ctx->bsp,
+    ctx->breakable_surfaces,
+    surface_index,
+    ctx->origin,
+    ctx->delta);
+  
+#ifdef BLAM_MEMOIZE
+  ctx->memo.valid_surfaces |= slot_bit;
+  ctx->memo.surfaces[slot]  = surface_index;
+  ctx->memo.surface_results = result 
+    ? ctx->memo.surface_results | slot_bit 
+    : ctx->memo.surface_results & ~slot_bit;
+#endif // BLAM_MEMOIZE
+  
+  return result;
+}
+
+bool test_vector_context_reference_certified(
+  const struct test_vector_context *const ctx,
+  const blam_index_long                   reference_index)
+{
+  if (ctx->accel == NULL || reference_index == -1)
+    return false;
+  
+  if (!blam_collision_bsp_certification_test(&ctx->accel->certification, reference_index))
+    return false;
+  
+  // Near grazing incidence, the sign of the quick test is decided by rounding.
+  const struct blam_plane3d *const plane = BLAM_TAG_BLOCK_GET(ctx->bsp, plane, planes, ctx->plane);
+  const blam_real_highp dot_delta = blam_real3d_dot(&plane->normal, ctx->delta);
+  const blam_real_highp length2   = blam_real3d_dot(ctx->delta, ctx->delta);
+  return dot_delta * dot_delta >= 1.0e-4 * length2;
+}
+
+bool test_vector_context_test_empty_node(
+  const struct test_vector_context *const ctx,
+  const blam_index_long                   node_index,
+  const blam_real                         fraction,
+  const blam_real                         terminal)
+{
+  if (BLAM_LIKELY(ctx->accel == NULL) || blam_bsp_leaf_type_interior(ctx->leaf_type))
+    return false;
+  
+  const struct blam_collision_bsp_box *const box = &ctx->accel->content_bounds.nodes[node_index];
+  if (box->lower.components[0] > box->upper.components[0])
+    return true;
+  
+  // Clip the traversed interval to the slabs of the box.
+  blam_real_highp lower = fmin(fraction, terminal);
+  blam_real_highp upper = fmax(fraction, terminal);
+  for (int i = 0; i < 3; ++i)
+  {
+    const blam_real_highp origin = ctx->origin->components[i];
+    const blam_real_highp delta  = ctx->delta->components[i];
+    if (delta == 0.0)
+    {
+      if (origin < box->lower.components[i] || origin > box->upper.components[i])
+        return true;
+      continue;
+    }
+    
+    const blam_real_highp a = (box->lower.components[i] - origin) / delta;
+    const blam_real_highp b = (box->upper.components[i] - origin) / delta;
+    lower = fmax(lower, fmin(a, b));
+    upper = fmin(upper, fmax(a, b));
+    if (lower > upper)
+      return true;
+  }
+  
+  return false;
+}
+
+bool test_vector_context_test_nearly_coplanar(
+  const struct test_vector_context *const ctx,
+  const blam_index_long                   plane_index)
+{
+  if (ctx->accel != NULL 
+    && !blam_collision_bsp_plane_classes_share(&ctx->accel->plane_classes, ctx->plane, plane_index))
+    return false;
+  
+  const struct blam_plane3d *const planes = BLAM_TAG_BLOCK_BASE(ctx->bsp, planes, planes);
+  return blam_plane3d_test_nearly_coplanar(&planes[ctx->plane], &planes[plane_index]);
+}
+
+bool test_vector_context_charge(
+  struct test_vector_context *const ctx,
+  const bool                        visit)
+{
+  blam_long *const spent = visit ? &ctx->budget.visits_spent : &ctx->budget.attempts_spent;
+  const blam_long  limit = visit ? ctx->budget.visits : ctx->budget.attempts;
+  
+  if (BLAM_UNLIKELY(*spent >= limit))
+  {
+    ctx->budget.exhausted = true;
+    return false;
+  }
+  
+  ++*spent;
+  return true;
+}
+
+bool test_vector_context_search(
+  struct test_vector_context *const ctx,
+  blam_index_long                   root,
+  const blam_real3d *const          point,
+  blam_index_long *const            leaf_index)
+{
+  typedef struct blam_bsp3d_node node_type;
+  
+  const node_type    *const nodes  = BLAM_TAG_BLOCK_BASE(ctx->bsp, nodes,  bsp3d_nodes);
+  const blam_plane3d *const planes = BLAM_TAG_BLOCK_BASE(ctx->bsp, planes, planes);
+  
+  // Matches blam_collision_bsp_search.
+  while (root >= 0)
+  {
+    if (!test_vector_context_charge(ctx, true))
+      return false;
+    
+    const node_type *const node = &nodes[root];
+    root = node->children[blam_plane3d_test_front(planes + node->plane, point)];
+  }
+  
+  *leaf_index = blam_sanitize_long_s(root);
+  return true;
+}
+
+void test_vector_context_settle_budget(
+  const struct test_vector_context *const ctx)
+{
+  struct blam_collision_bsp_budget *const budget = ctx->budget.source;
+  if (budget == NULL)
+    return;
+  
+  if (budget->tick_attempts >= 0)
+    budget->tick_attempts_left -= ctx->budget.attempts_spent;
+  if (budget->tick_visits >= 0)
+    budget->tick_visits_left -= ctx->budget.visits_spent;
+  
+  budget->stats.attempt_count += ctx->budget.attempts_spent;
+  budget->stats.visit_count   += ctx->budget.visits_spent;
+  if (ctx->budget.exhausted)
+    ++budget->stats.exhausted_count;
+}
+
 blam_bool test_vector_context_try_commit_result(
   struct test_vector_context *ctx,
   blam_real       fraction,
@@ -817,13 +2297,32 @@ blam_bool test_vector_context_try_commit_result(
     || ((surface->flags & 0x08) != 0 && !test_breakable_surfaces))
     return false;
   
-  ctx->data->fraction   = fraction;
-  ctx->data->last_split = BLAM_TAG_BLOCK_GET(ctx->bsp, struct blam_plane3d*, planes, plane_index);
-  ctx->data->surface.index             = surface_index;
-  ctx->data->surface.plane             = surface->plane;
-  ctx->data->surface.flags             = surface->flags;
-  ctx->data->surface.breakable_surface = surface->breakable_surface;
-  ctx->data->surface.material          = surface->material;
+  struct blam_collision_bsp_test_vector_hit hit;
+  hit.fraction                  = fraction;
+  hit.last_split                = BLAM_TAG_BLOCK_GET(ctx->bsp, struct blam_plane3d*, planes, plane_index);
+  hit.surface.index             = surface_index;
+  hit.surface.plane             = surface->plane;
+  hit.surface.flags             = surface->flags;
+  hit.surface.breakable_surface = surface->breakable_surface;
+  hit.surface.material          = surface->material;
+  
+  // (NON-VANILLA) When gathering every intersection, the intersection fraction 
+  // is left alone so the traversal carries on past this one.
+  if (ctx->hits != NULL)
+  {
+    ctx->hits[ctx->hit_count++] = hit;
+    return ctx->hit_count >= ctx->hit_capacity;
+  }
+  
+  ctx->fraction = fraction;
+  if (ctx->hit != NULL)
+    *ctx->hit = hit;
+  if (ctx->data == NULL)
+    return true;
+  
+  ctx->data->fraction   = hit.fraction;
+  ctx->data->last_split = hit.last_split;
+  ctx->data->surface    = hit.surface;
   
   return true;
 }
@@ -843,79 +2342,287 @@ blam_bool test_vector_context_try_commit_pending_result(
     ctx->ext.pending.surface);
 }
 
-blam_bool collision_bsp_test_vector_node(
-  struct test_vector_context *const ctx,
-  const blam_index_long             root,
-  const blam_real                   fraction,
-  const blam_real                   terminal)
+blam_index_long collision_bsp_locate_vector(
+  const collision_bsp *const   bsp,
+  blam_index_long              root,
+  const blam_real3d *const     origin,
+  const blam_real3d *const     delta,
+  const blam_real              terminal,
+  blam_index_long *const       path,
+  blam_long *const             depth,
+  blam_real_highp *const       radius)
 {
-  // NOTE: Although we should 'pop' before returning, we don't strictly need to.
-  //       Restoring to handle before a recursive call is sufficient.
-  const blam_index_long handle = test_vector_context_ext_push_node(ctx, root);
-  if (BLAM_UNLIKELY(root < 0))
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes,  bsp3d_nodes);
+  const struct blam_plane3d    *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  const blam_real fraction = 0.0f;
+  
+  while (root >= 0)
   {
-    const blam_index_long leaf = blam_sanitize_long_s(root);
-    return collision_bsp_test_vector_leaf(ctx, leaf, fraction);
+    // Same tests as collision_bsp_test_vector_node, so both agree on every side.
+    const struct blam_bsp3d_node *const node  = &nodes[root];
+    const struct blam_plane3d    *const plane = &planes[node->plane];
+    const blam_real_highp test_origin   = blam_plane3d_test(plane, origin);
+    const blam_real_highp dot_delta     = blam_real3d_dot(&plane->normal, delta);
+    const blam_real_highp point_test    = test_origin + fraction * dot_delta;
+    const blam_real_highp terminal_test = test_origin + terminal * dot_delta;
+    const bool any_before = (point_test < 0.0) || (terminal_test < 0.0);
+    const bool any_after  = (point_test >= 0.0) || (terminal_test >= 0.0);
+    
+    if (any_before && any_after)
+      return root;
+    
+    // The node path stops growing once full, as in test_vector_context_ext_push_node.
+    if (*depth < 0x100)
+      path[(*depth)++] = root;
+    
+    // Keeps NaN, so that a token is never left from a vector that has none.
+    if (!(fabs(terminal_test) >= *radius))
+      *radius = fabs(terminal_test);
+    
+    root = node->children[any_after ? 1 : 0];
   }
   
-  const struct blam_bsp3d_node *const node  = BLAM_TAG_BLOCK_GET(ctx->bsp, node, bsp3d_nodes, root);
-  const struct blam_plane3d *const    plane = BLAM_TAG_BLOCK_GET(ctx->bsp, plane, planes, node->plane);
-  
-  // We need to test the current point as well as the terminal point 
-  // against the plane given by node->plane.
-  // If both are on the same side of the plane, then we simply go down
-  // that part of the tree in one recursive call.
-  // If they land on different sides of the plane, then we may need to 
-  // recurse down both sides of the tree.
-  // Halo performs these tests in the following steps:
-  const blam_real_highp test_origin   = blam_plane3d_test(plane, ctx->origin);
-  const blam_real_highp dot_delta     = blam_real3d_dot(&plane->normal, ctx->delta);
-  const blam_real_highp point_test    = test_origin + fraction * dot_delta;
-  const blam_real_highp terminal_test = test_origin + terminal * dot_delta;
-  const bool any_before = (point_test < 0.0) || (terminal_test < 0.0);
-  const bool any_after  = (point_test >= 0.0) || (terminal_test >= 0.0);
+  return root;
+}
+
+blam_index_long collision_bsp_coherence_resume(
+  const struct blam_collision_bsp_coherence *const coherence,
+  const collision_bsp *const                       bsp,
+  const blam_real3d *const                         origin,
+  const blam_real3d *const                         delta,
+  const blam_real                                  terminal,
+  blam_index_long *const                           path,
+  blam_long *const                                 depth,
+  blam_real_highp *const                           radius)
+{
+  if (coherence->bsp != bsp || !(coherence->radius > 0.0f))
+    return 0;
   
-  if (!any_before || !any_after) {
-    // The origin and terminal points are on the same side of the tree.
-    // Just recurse down the subtree those points are on.
-    const blam_index_long new_root = node->children[any_after ? 1 : 0];
-    return collision_bsp_test_vector_node(ctx, new_root, fraction, terminal);
-  } else {
-    // The origin and terminal points are on opposite sides of the plane.
-    // <n, delta> < 0 if and only if the point given by fraction is in front
-    // of the plane (point_test >= 0).
-    // This comparison is retained as is from Halo.
-    const bool plane_faces_forward = !(dot_delta >= 0.0);
-    const blam_index_long first_child  = node->children[plane_faces_forward ? 1 : 0];
-    const blam_index_long second_child = node->children[plane_faces_forward ? 0 : 1];
-
-    // intersection is the scalar t such that:
-    //  <n, origin + t * delta> - w = 0,
-    //  i.e. t = -(<n, origin> - w)/<n, delta>
-    // where origin is the vector origin, delta is the vector delta,
-    // and (n,w) describes the plane
-    //
-    // The condition to get here is that the points given by fraction
-    // and terminal_fraction are on opposite sides of the plane.
-    // If we manage to get here, then <n, delta> != 0.
-    // We can therefore divide by <n, delta>.
-    const blam_real intersection = -(blam_real)(test_origin / dot_delta);
+  // Both ends of the vector must be well within the ball, so that rounding in 
+  // the plane tests cannot put either on the other side of a plane on the path.
+  const blam_real3d *const center = &coherence->center;
+  const blam_real_highp margin = 1.0e-3 + 0x1p-16 * (coherence->radius
+    + fabs(center->components[0]) + fabs(center->components[1]) + fabs(center->components[2]));
+  const blam_real_highp limit = coherence->radius - margin;
+  
+  blam_real_highp origin_distance2 = 0.0;
+  blam_real_highp end_distance2    = 0.0;
+  for (int i = 0; i < 3; ++i)
+  {
+    const blam_real_highp origin_offset = origin->components[i] - center->components[i];
+    const blam_real_highp end_offset    = origin_offset + (blam_real_highp)terminal * delta->components[i];
+    origin_distance2 += origin_offset * origin_offset;
+    end_distance2    += end_offset * end_offset;
+  }
+  
+  if (!(limit > 0.0 && origin_distance2 <= limit * limit && end_distance2 <= limit * limit))
+    return 0;
+  
+  memcpy(path, coherence->path, coherence->depth * sizeof(*path));
+  *depth  = coherence->depth;
+  *radius = coherence->radius - sqrt(end_distance2);
+  return coherence->node;
+}
+
+void collision_bsp_coherence_update(
+  struct blam_collision_bsp_coherence *const coherence,
+  const collision_bsp *const                 bsp,
+  const blam_real3d *const                   origin,
+  const blam_real3d *const                   delta,
+  const blam_real                            terminal,
+  const blam_index_long                      node,
+  const blam_index_long *const               path,
+  const blam_long                            depth,
+  blam_real_highp                            radius)
+{
+  // The distances to the planes were measured with rounding error, and the ball
+  // is centered on the end of the vector rounded to single precision. Planes are
+  // assumed to have unit normals, so that plane tests measure distance.
+  blam_real_highp magnitude = 0.0;
+  for (int i = 0; i < 3; ++i)
+  {
+    const blam_real_highp end = origin->components[i] + (blam_real_highp)terminal * delta->components[i];
+    coherence->center.components[i] = (blam_real)end;
+    magnitude += fabs(origin->components[i]) + fabs(end);
+  }
+  radius -= 1.0e-3 + 0x1p-16 * magnitude;
+  
+  coherence->bsp = bsp;
+  coherence->radius = -1.0f;
+  
+  // If the path overflowed the node path, the path is incomplete.
+  if (depth >= 0x100 || !(radius > 0.0) || !isfinite(magnitude))
+    return;
+  
+  coherence->radius = (blam_real)radius;
+  coherence->node   = node;
+  coherence->depth  = depth;
+  memcpy(coherence->path, path, depth * sizeof(*path));
+}
+
+/**
+ * \brief Internal; the body of #collision_bsp_test_vector_node.
+ *
+ * Instantiated with and without \a track_path, so that the node path is not 
+ * kept when there is no BSP leak to resolve along it.
+ *
+ * \param [in] track_path If \c true, the nodes are pushed onto the node path of 
+ *                        `ctx->ext`.
+ */
+static inline BLAM_ATTRIBUTE(always_inline)
+blam_bool collision_bsp_test_vector_node_body(
+  struct test_vector_context *const ctx,
+  blam_index_long                   root,
+  blam_real                         fraction,
+  blam_real                         terminal,
+  const bool                        track_path)
+{
+  struct test_vector_split splits[TEST_VECTOR_SPLIT_STACK_SIZE];
+  blam_long                split_count = 0;
+  
+  for (;;)
+  {
+    const blam_index_long handle = track_path ? test_vector_context_ext_push_node(ctx, root) : -1;
+    if (BLAM_UNLIKELY(root < 0))
+    {
+      const blam_index_long leaf = blam_sanitize_long_s(root);
+      if (collision_bsp_test_vector_leaf(ctx, leaf, fraction))
+        return true;
+    } else if (test_vector_context_test_empty_node(ctx, root, fraction, terminal))
+    {
+      // (NON-VANILLA) Skip the subtree; only exterior leaves would be visited,
+      // and visiting those after exterior changes nothing besides the leaf.
+      collision_bsp_test_vector_leaf(ctx, -1, fraction);
+    } else
+    {
+      const struct blam_bsp3d_node *const node  = BLAM_TAG_BLOCK_GET(ctx->bsp, node, bsp3d_nodes, root);
+      
+      // We need to test the current point as well as the terminal point 
+      // against the plane given by node->plane.
+      // If both are on the same side of the plane, then we simply go down
+      // that part of the tree.
+      // If they land on different sides of the plane, then we may need to 
+      // go down both sides of the tree.
+      // Halo performs these tests in the following steps:
+      blam_real_highp test_origin, dot_delta;
+      test_vector_context_test_plane(ctx, node->plane, &test_origin, &dot_delta);
+      const blam_real_highp point_test    = test_origin + fraction * dot_delta;
+      const blam_real_highp terminal_test = test_origin + terminal * dot_delta;
+      const bool any_before = (point_test < 0.0) || (terminal_test < 0.0);
+      const bool any_after  = (point_test >= 0.0) || (terminal_test >= 0.0);
+      
+      if (!any_before || !any_after) {
+        // The origin and terminal points are on the same side of the tree.
+        // Just go down the subtree those points are on.
+        root = node->children[any_after ? 1 : 0];
+        continue;
+      }
+      
+      // The origin and terminal points are on opposite sides of the plane.
+      // <n, delta> < 0 if and only if the point given by fraction is in front
+      // of the plane (point_test >= 0).
+      // This comparison is retained as is from Halo.
+      const bool plane_faces_forward = !(dot_delta >= 0.0);
+      const blam_index_long first_child  = node->children[plane_faces_forward ? 1 : 0];
+      const blam_index_long second_child = node->children[plane_faces_forward ? 0 : 1];
+      
+      // intersection is the scalar t such that:
+      //  <n, origin + t * delta> - w = 0,
+      //  i.e. t = -(<n, origin> - w)/<n, delta>
+      // where origin is the vector origin, delta is the vector delta,
+      // and (n,w) describes the plane
+      //
+      // The condition to get here is that the points given by fraction
+      // and terminal_fraction are on opposite sides of the plane.
+      // If we manage to get here, then <n, delta> != 0.
+      // We can therefore divide by <n, delta>.
+      const blam_real intersection = -(blam_real)(test_origin / dot_delta);
+      
+      if (BLAM_LIKELY(split_count < TEST_VECTOR_SPLIT_STACK_SIZE))
+      {
+        // Defer the second child subtree until the first has been tested.
+        splits[split_count++] = (struct test_vector_split)
+        {
+          .node     = second_child,
+          .plane    = node->plane,
+          .fraction = intersection,
+          .terminal = terminal,
+          .handle   = handle
+        };
+        
+        root     = first_child;
+        terminal = intersection;
+        continue;
+      }
+      
+      // Out of room for deferred splits; test the first child subtree in place, 
+      // then continue along the second unless an intersection occurred before the
+      // splitting plane.
+      if (collision_bsp_test_vector_node(ctx, first_child, fraction, intersection))
+        return true;
+      
+      if (BLAM_LIKELY(!(ctx->fraction <= intersection)))
+      {
+        ctx->plane = node->plane;
+        if (track_path)
+          test_vector_context_ext_restore_node(ctx, handle);
+        root     = second_child;
+        fraction = intersection;
+        continue;
+      }
+    }
     
-    if (collision_bsp_test_vector_node(ctx, first_child, fraction, intersection)) {
-      // Found an intersection in the first child subtree.
-      return true;
-    } else if (BLAM_UNLIKELY(ctx->data->fraction <= intersection)) {
-      // An intersection occurred before the splitting plane between children.
+    // No intersection in the last subtree; continue along the deferred splits,
+    // skipping those where an intersection occurred before the splitting plane.
+    while (split_count > 0 && BLAM_UNLIKELY(ctx->fraction <= splits[split_count - 1].fraction))
+      --split_count;
+    
+    if (split_count == 0)
       return false;
-    } else {
-      // Continue to test along the second child subtree.
-      ctx->plane = node->plane;
-      test_vector_context_ext_restore_node(ctx, root, handle);
-      return collision_bsp_test_vector_node(ctx, second_child, intersection, terminal);
-    }
+    
+    const struct test_vector_split *const split = &splits[--split_count];
+    ctx->plane = split->plane;
+    if (track_path)
+      test_vector_context_ext_restore_node(ctx, split->handle);
+    root     = split->node;
+    fraction = split->fraction;
+    terminal = split->terminal;
   }
 }
 
+static
+blam_bool collision_bsp_test_vector_node_tracked(
+  struct test_vector_context *const ctx,
+  const blam_index_long             root,
+  const blam_real                   fraction,
+  const blam_real                   terminal)
+{
+  return collision_bsp_test_vector_node_body(ctx, root, fraction, terminal, true);
+}
+
+static
+blam_bool collision_bsp_test_vector_node_untracked(
+  struct test_vector_context *const ctx,
+  const blam_index_long             root,
+  const blam_real                   fraction,
+  const blam_real                   terminal)
+{
+  return collision_bsp_test_vector_node_body(ctx, root, fraction, terminal, false);
+}
+
+blam_bool collision_bsp_test_vector_node(
+  struct test_vector_context *const ctx,
+  const blam_index_long             root,
+  const blam_real                   fraction,
+  const blam_real                   terminal)
+{
+  // (NON-VANILLA) The node path is only kept to resolve BSP leaks.
+  if ((ctx->leaf_mode & k_leaf_mode_leaks) != 0)
+    return collision_bsp_test_vector_node_tracked(ctx, root, fraction, terminal);
+  else
+    return collision_bsp_test_vector_node_untracked(ctx, root, fraction, terminal);
+}
+
 /**
  * \brief Internal; common subroutine used in #collision_bsp_test_vector_leaf.
  *
@@ -952,6 +2659,7 @@ bool collision_bsp_test_vector_leaf_visit_surface(
       return false;
   
   blam_index_long plane_index = ctx->plane;
+  blam_index_long reference_index;
   blam_index_long surface_index = collision_bsp_search_leaf(
     ctx->bsp,
     ctx->breakable_surfaces,
@@ -960,20 +2668,43 @@ bool collision_bsp_test_vector_leaf_visit_surface(
     splits_interior,
     ctx->origin,
     ctx->delta,
-    fraction);
+    fraction,
+    &reference_index);
   
   if (verify_surface && surface_index != -1)
   {
-    if (!collision_surface_test3d(ctx->bsp, ctx->breakable_surfaces, surface_index, ctx->origin, ctx->delta))
+    if (!test_vector_context_test_surface(ctx, surface_index))
       surface_index = -1;
   }
    
+  const blam_index_long searched_surface_index = surface_index;
   surface_index = try_resolve_bsp_leak(ctx, leaf_index, fraction, splits_interior, surface_index);
   
   if (!verify_surface)
   {
     const bool leak_encountered = !splits_interior && surface_index == -1;
-    switch (get_phantom_bsp_resolution_method(ctx, splits_interior, commit_result, surface_index))
+    const bool certified = surface_index != -1 && surface_index == searched_surface_index
+      && test_vector_context_reference_certified(ctx, reference_index);
+    enum phantom_bsp_resolution_method method = get_phantom_bsp_resolution_method(ctx, splits_interior, commit_result, surface_index, certified);
+    
+    // (NON-VANILLA) When gathering every intersection, the pending surface is an
+    // intersection of its own, and the current surface is then resolved as if 
+    // nothing were pending. If the pending surface is not committed, the current 
+    // one is dropped along with it, as it would be otherwise.
+    if (method == k_resolution_method_accept_pending && ctx->hits != NULL)
+    {
+      const blam_long hit_count = ctx->hit_count;
+      if (test_vector_context_try_commit_pending_result(ctx))
+        return true;
+      
+      if (ctx->hit_count != hit_count)
+      {
+        ctx->ext.has_pending_result = false;
+        method = get_phantom_bsp_resolution_method(ctx, splits_interior, commit_result, surface_index, certified);
+      }
+    }
+    
+    switch (method)
     {
     case k_resolution_method_reject_current:
       surface_index = -1;
@@ -1018,89 +2749,64 @@ blam_bool collision_bsp_test_vector_leaf(
   const bool test_frontfacing = (ctx->flags & k_collision_test_front_facing_surfaces) != 0;
   const bool test_backfacing  = (ctx->flags & k_collision_test_back_facing_surfaces) != 0;
   
-  if (leaf != -1)
-  {
-    const blam_index_long count = ctx->ext.nodes.count;
-    ctx->ext.leaf_nodes.count = count;
-    memcpy(ctx->ext.leaf_nodes.stack, ctx->ext.nodes.stack, count * sizeof(ctx->ext.leaf_nodes.stack[0]));
-  }
+  // (NON-VANILLA) The path to the interior leaf is only kept to resolve BSP leaks.
+  if (leaf != -1 && (ctx->leaf_mode & k_leaf_mode_leaks) != 0)
+    test_vector_context_ext_mark_leaf(ctx);
   
   // PHANTOM BSP MITIGATIONS:
   // If we are mitigating phantom BSP, then we need to test both front- and 
   // back-facing surfaces to observe BSP leaks. The result is only committed if its 
-  // a surface the user actually desires to test.
-  if ((test_frontfacing || mitigate_phantom_bsp)
-    && blam_bsp_leaf_type_interior(ctx->leaf_type)
-    && leaf_type == k_bsp_leaf_type_exterior)
+  // a surface the user actually desires to test. 
+  // (NON-VANILLA) The flags and mitigations are folded into ctx->leaf_mode, which
+  // selects the action for each pair of leaf types from a table.
+  const enum leaf_action action = leaf_actions[ctx->leaf_mode][ctx->leaf_type][leaf_type];
+  if (action != k_leaf_action_none)
   {
-    // Testing front-facing surfaces
-    // Plane splits BSP interior at ctx->leaf from BSP exterior at leaf.
-    const blam_index_long tested_leaf     = ctx->leaf;
-    const bool            splits_interior = false;
-    const bool            commit_result   = test_frontfacing;
-    const bool            verify_surface  = false;
+    blam_index_long tested_leaf;
+    bool            splits_interior;
+    bool            commit_result;
+    bool            verify_surface;
     
-    const bool result = collision_bsp_test_vector_leaf_visit_surface(
-      ctx, 
-      tested_leaf, 
-      fraction, 
-      splits_interior, 
-      commit_result,
-      verify_surface);
-    if (BLAM_LIKELY(result))
-      return true;
-  } else if ((test_backfacing || mitigate_phantom_bsp)
-    && ctx->leaf_type == k_bsp_leaf_type_exterior
-    && blam_bsp_leaf_type_interior(leaf_type))
-  {
-    // Testing back-facing surfaces
-    // Plane splits BSP exterior at ctx->leaf from BSP interior at leaf.
-    const blam_index_long tested_leaf     = leaf;
-    const bool            splits_interior = false;
-    const bool            commit_result   = test_backfacing;
-    const bool            verify_surface  = false;
+    switch (action)
+    {
+    case k_leaf_action_front_facing:
+      // Testing front-facing surfaces
+      // Plane splits BSP interior at ctx->leaf from BSP exterior at leaf.
+      tested_leaf     = ctx->leaf;
+      splits_interior = false;
+      commit_result   = test_frontfacing;
+      verify_surface  = false;
+      break;
     
-    const bool result = collision_bsp_test_vector_leaf_visit_surface(
-      ctx, 
-      tested_leaf, 
-      fraction, 
-      splits_interior, 
-      commit_result,
-      verify_surface);
-    if (BLAM_LIKELY(result))
-      return true;
-  } else if ((ctx->flags & k_collision_test_ignore_two_sided_surfaces) == 0
-    && ctx->leaf_type == k_bsp_leaf_type_double_sided
-    && leaf_type == k_bsp_leaf_type_double_sided)
-  {
-    // Testing double-sided surfaces
-    // Plane splits BSP interior leaves at ctx->leaf and leaf.
-    const blam_index_long tested_leaf     = test_frontfacing ? ctx->leaf : leaf;
-    const bool            splits_interior = true;
-    const bool            commit_result   = true;
-    const bool            verify_surface  = false;
-
-    const bool result = collision_bsp_test_vector_leaf_visit_surface(
-      ctx, 
-      tested_leaf, 
-      fraction, 
-      splits_interior, 
-      commit_result,
-      verify_surface);
-    if (result)
-      return true;
-    // NOTE: Not a sealed-world violation; double-sided surface may be breakable.
-  } else if (mitigate_bsp_leaks &&
-    ((ctx->leaf_type == k_bsp_leaf_type_interior     && leaf_type == k_bsp_leaf_type_double_sided) || 
-     (ctx->leaf_type == k_bsp_leaf_type_double_sided && leaf_type == k_bsp_leaf_type_interior)))
-  {
-    // We've possibly encountered Form 3 BSP leak.
-    // These leaks typically occur between non-double-sided interior leaves and 
-    // double-sided leaves. 
-    const blam_index_long tested_leaf     = test_frontfacing ? ctx->leaf : leaf;
-    const bool            splits_interior = false;
-    const bool            commit_result   = true;
-    const bool            verify_surface  = true;
+    case k_leaf_action_back_facing:
+      // Testing back-facing surfaces
+      // Plane splits BSP exterior at ctx->leaf from BSP interior at leaf.
+      tested_leaf     = leaf;
+      splits_interior = false;
+      commit_result   = test_backfacing;
+      verify_surface  = false;
+      break;
+    
+    case k_leaf_action_double_sided:
+      // Testing double-sided surfaces
+      // Plane splits BSP interior leaves at ctx->leaf and leaf.
+      // NOTE: Not a sealed-world violation; double-sided surface may be breakable.
+      tested_leaf     = test_frontfacing ? ctx->leaf : leaf;
+      splits_interior = true;
+      commit_result   = true;
+      verify_surface  = false;
+      break;
+    
+    default:
+      // We've possibly encountered Form 3 BSP leak.
+      // These leaks typically occur between non-double-sided interior leaves and 
+      // double-sided leaves. 
+      tested_leaf     = test_frontfacing ? ctx->leaf : leaf;
+      splits_interior = false;
+      commit_result   = true;
+      verify_surface  = true;
+      break;
+    }
     
     const bool result = collision_bsp_test_vector_leaf_visit_surface(
       ctx, 
@@ -1111,14 +2817,11 @@ blam_bool collision_bsp_test_vector_leaf(
       verify_surface);
     if (result)
       return true;
-  } else 
-  {
-    // DO NOTHING
   }
 
   // ------------------------------
   // Record the leaf into the query
-  if (leaf != -1)
+  if (leaf != -1 && ctx->data != NULL)
   {
     // NOTE: branchless code is a pessimization here.
     if (BLAM_LIKELY(ctx->data->leaves.count < 0x100))
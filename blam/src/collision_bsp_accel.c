@@ -0,0 +1,2245 @@
+#include "blam/collision_bsp_accel.h"
+#include "blam/collision_bsp_sidecar.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "blam/math.h"
+#include "blam/tag.h"
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+typedef struct blam_collision_bsp               collision_bsp;
+typedef struct blam_collision_bsp_accel         collision_bsp_accel;
+typedef struct blam_collision_bsp_plane_classes plane_classes;
+typedef struct blam_collision_bsp_leak_table    leak_table;
+typedef struct blam_collision_bsp_certification certification;
+typedef struct blam_collision_bsp_repair        repair;
+typedef struct blam_collision_bsp_box           box;
+typedef struct blam_collision_bsp_content_bounds content_bounds;
+typedef struct blam_collision_bsp_leaf_bounds   leaf_bounds;
+typedef struct blam_collision_bsp_breakables    breakables;
+
+/**
+ * \brief The maximum number of nodes on a path, including the leaf.
+ *
+ * This is the depth limit of the node path kept by BSP-vector intersection tests.
+ */
+#define ACCEL_MAX_PATH_LENGTH 0x100
+
+/**
+ * \brief The maximum number of vertices of a leaf face polygon.
+ */
+#define ACCEL_MAX_POLYGON_VERTICES 0x40
+
+/**
+ * \brief The maximum depth of a BSP2D to certify.
+ */
+#define ACCEL_MAX_BSP2D_DEPTH 0x40
+
+/**
+ * \brief The distance a leaf face may extend past the surfaces covering it, in 
+ *        units in the last place of the single-precision coordinates compared.
+ */
+#define ACCEL_COVER_ULPS 16.0
+
+/**
+ * \brief The maximum number of characters of the sidecar directory, with its
+ *        terminator.
+ */
+#define ACCEL_MAX_SIDECAR_DIRECTORY 0x104
+
+/**
+ * \brief The acceleration data registered for a collision BSP.
+ */
+struct accel_registry_entry
+{
+  const collision_bsp_accel *accel;           ///< The data.
+  collision_bsp_accel       *owned;           ///< The data, if the registry derived 
+                                              ///< it, otherwise `NULL`.
+  blam_long                  footprint;       ///< The bytes held by the data.
+  blam_long                  reference_count; ///< The number of acquisitions not
+                                              ///< yet released.
+  blam_long                  last_acquired;   ///< The time the data was last acquired.
+};
+
+/**
+ * \brief The acceleration data of every collision BSP that has any.
+ */
+struct accel_registry
+{
+  blam_long                    entry_count;
+  blam_long                    entry_capacity;
+  struct accel_registry_entry *entries;
+
+  blam_long        slot_count; ///< The number of #slots; a power of two, or `0`.
+  blam_index_long *slots;      ///< Open-addressed entry indices, or `-1`.
+
+  blam_long time; ///< The number of acquisitions, as a clock for eviction.
+
+  char sidecar_directory[ACCEL_MAX_SIDECAR_DIRECTORY]; ///< The directory of the
+                                                       ///< sidecar files, or empty.
+
+  struct blam_collision_bsp_accel_registry_stats stats;
+};
+
+static struct accel_registry registry = { .stats.memory_cap = -1 };
+
+static const box accel_box_empty = {
+  .lower = {{  INFINITY,  INFINITY,  INFINITY }},
+  .upper = {{ -INFINITY, -INFINITY, -INFINITY }}
+};
+
+static const box accel_box_unbounded = {
+  .lower = {{ -INFINITY, -INFINITY, -INFINITY }},
+  .upper = {{  INFINITY,  INFINITY,  INFINITY }}
+};
+
+/**
+ * \brief A convex polygon in the projected coordinates of a plane.
+ */
+struct accel_polygon
+{
+  int    count;
+  double points[ACCEL_MAX_POLYGON_VERTICES][2];
+};
+
+/**
+ * \brief The state shared by the passes deriving acceleration data.
+ */
+struct accel_build_state
+{
+  blam_long   capacities[2];       ///< The capacities of the leak table entries
+                                   ///< and candidates.
+  blam_ulong *rejected_references; ///< The references that failed certification
+                                   ///< in any leaf, as bits.
+  double      extent;              ///< The half-extent of the initial face polygon;
+                                   ///< beyond any vertex of the BSP.
+  double      tolerance;           ///< The precision of the coordinates of the 
+                                   ///< BSP, which leaf bounds allow for.
+  blam_ubyte *node_exterior;       ///< For each node, nonzero if BSP exterior is 
+                                   ///< below it. Only used for repair.
+  blam_long   reference_capacity;  ///< The capacity of the repaired references.
+  box        *leaf_boxes;          ///< The bounding box of each leaf.
+  double    (*vertices)[3];        ///< The vertices of the faces of the leaf being
+                                   ///< visited.
+  blam_long   vertex_count;        ///< The number of #vertices, or `-1` if the 
+                                   ///< leaf is unbounded or degenerate.
+  blam_long   vertex_capacity;     ///< The capacity of #vertices.
+  blam_long   bound_capacity;      ///< The capacity of the leaf bounds.
+};
+
+/**
+ * \brief Visits a leaf reachable along a single path from the root.
+ *
+ * \param [in]     bsp        The collision BSP.
+ * \param [in,out] accel      The acceleration data being derived.
+ * \param [in,out] state      The build state.
+ * \param [in]     leaf_index The index of the leaf.
+ * \param [in]     path       The nodes on the path to the leaf, from the root.
+ * \param [in]     sides      The child taken at each node in \a path.
+ * \param [in]     depth      The number of nodes in \a path.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+typedef bool (*accel_leaf_visitor)(
+  const collision_bsp      *bsp,
+  collision_bsp_accel      *accel,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief The number of bits in each word of a bit set.
+ */
+#define ACCEL_WORD_BITS ((blam_long)(CHAR_BIT * sizeof(blam_ulong)))
+
+/**
+ * \brief Adds an element to a bit set.
+ */
+static inline
+void accel_bits_set(blam_ulong *bits, blam_long index)
+{
+  bits[index / ACCEL_WORD_BITS] |= (blam_ulong)1 << (index % ACCEL_WORD_BITS);
+}
+
+/**
+ * \brief Tests if a bit set contains an element.
+ */
+static inline
+bool accel_bits_test(const blam_ulong *bits, blam_long index)
+{
+  return (bits[index / ACCEL_WORD_BITS] & ((blam_ulong)1 << (index % ACCEL_WORD_BITS))) != 0;
+}
+
+/**
+ * \brief Grows a dynamic array to hold at least one more element.
+ *
+ * \param [in,out] array    The array.
+ * \param [in,out] capacity The capacity of \a array, in elements.
+ * \param [in]     count    The number of elements in \a array.
+ * \param [in]     size     The size of an element.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool accel_array_reserve(
+  void      **array,
+  blam_long  *capacity,
+  blam_long   count,
+  size_t      size);
+
+/**
+ * \brief Shrinks a dynamic array to hold exactly its elements.
+ *
+ * The array is left as it is if it cannot be reallocated.
+ *
+ * \param [in,out] array The array.
+ * \param [in]     count The number of elements in \a array.
+ * \param [in]     size  The size of an element.
+ */
+static
+void accel_array_shrink(
+  void     **array,
+  blam_long  count,
+  size_t     size);
+
+/**
+ * \brief Hashes the identity of a collision BSP.
+ */
+static inline
+blam_ulong registry_hash(const collision_bsp *bsp);
+
+/**
+ * \brief Finds the registry entry of a collision BSP.
+ *
+ * \return The index of the entry, or `-1` if there is none.
+ */
+static
+blam_index_long registry_find(const collision_bsp *bsp);
+
+/**
+ * \brief Adds the acceleration data of a collision BSP to the registry.
+ *
+ * The BSP must not have an entry yet.
+ *
+ * \param [in] accel The data.
+ * \param [in] owned The data if the registry derived it, otherwise `NULL`.
+ *
+ * \return The entry, or `NULL` if memory could not be allocated.
+ */
+static
+struct accel_registry_entry *registry_insert(
+  const collision_bsp_accel *accel,
+  collision_bsp_accel       *owned);
+
+/**
+ * \brief Removes an entry from the registry, destroying the data if the registry
+ *        derived it.
+ */
+static
+void registry_remove(blam_index_long entry_index);
+
+/**
+ * \brief Fills the slots of the registry from its entries.
+ */
+static
+void registry_rehash(void);
+
+/**
+ * \brief Evicts the derived data least recently acquired that is not in use, until
+ *        the memory cap leaves room for more.
+ *
+ * \param [in] memory_size The number of bytes to make room for.
+ *
+ * \return `true` if there is room, otherwise `false`.
+ */
+static
+bool registry_trim(blam_long memory_size);
+
+/**
+ * \brief Gets the first BSP2D reference in a leaf for a plane.
+ *
+ * \return The index of the reference, or `-1` if the leaf has none for the plane.
+ */
+static
+blam_index_long collision_bsp_leaf_reference(
+  const collision_bsp *bsp,
+  blam_index_long      leaf_index,
+  blam_index_long      plane_index);
+
+/**
+ * \brief A plane keyed by the magnitude of its distance from the origin.
+ */
+struct plane_classes_key
+{
+  double          magnitude;
+  blam_index_long plane;
+};
+
+/**
+ * \brief Orders plane class keys by magnitude, for `qsort`.
+ */
+static
+int plane_classes_compare_keys(const void *a, const void *b);
+
+/**
+ * \brief Finds the lowest plane index in the class of a plane, while the classes
+ *        are being built.
+ */
+static
+blam_index_long plane_classes_find(blam_index_long *classes, blam_index_long plane_index);
+
+/**
+ * \brief Merges the classes of two planes if they are nearly coplanar.
+ */
+static
+void plane_classes_merge(
+  plane_classes      *classes,
+  const blam_plane3d *planes,
+  blam_index_long     plane_index,
+  blam_index_long     other_plane_index);
+
+/**
+ * \brief Partitions the planes of a collision BSP into classes.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool plane_classes_build(const collision_bsp *bsp, plane_classes *classes);
+
+/**
+ * \brief Lists the breakable surfaces of a collision BSP.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool breakables_build(const collision_bsp *bsp, breakables *breakables);
+
+/**
+ * \brief Tests if two planes are nearly coplanar, rejecting planes of different
+ *        classes up front.
+ */
+static inline
+bool accel_test_nearly_coplanar(
+  const plane_classes *classes,
+  const blam_plane3d  *planes,
+  blam_index_long      plane_index,
+  blam_index_long      other_plane_index);
+
+/**
+ * \brief Walks every leaf reachable along a single path from the root.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool accel_walk_leaves(
+  const collision_bsp      *bsp,
+  collision_bsp_accel      *accel,
+  struct accel_build_state *state,
+  accel_leaf_visitor        visitor);
+
+/**
+ * \brief Derives the leak table entries and certification for a covered leaf.
+ *
+ * See #accel_leaf_visitor.
+ */
+static
+bool accel_visit_leaf(
+  const collision_bsp      *bsp,
+  collision_bsp_accel      *accel,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief Hashes a (leaf, plane) pair into a leak table bucket.
+ */
+static inline
+blam_ulong leak_table_hash(
+  const leak_table *table,
+  blam_index_long   leaf_index,
+  blam_index_long   plane_index);
+
+/**
+ * \brief Adds the entries for a covered leaf to a leak table.
+ *
+ * \param [in]     bsp        The collision BSP.
+ * \param [in]     classes    The plane classes of the BSP.
+ * \param [in,out] table      The leak table.
+ * \param [in,out] state      The build state.
+ * \param [in]     leaf_index The index of the leaf.
+ * \param [in]     path       The nodes on the path to the leaf, from the root.
+ * \param [in]     depth      The number of nodes in \a path.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool leak_table_add_leaf(
+  const collision_bsp      *bsp,
+  const plane_classes      *classes,
+  leak_table               *table,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  blam_long                 depth);
+
+/**
+ * \brief Hashes the entries of a leak table into its buckets.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool leak_table_hash_entries(leak_table *table);
+
+/**
+ * \brief Clips a polygon to the half-plane `a * u + b * v + c >= 0`.
+ *
+ * \return `true` on success, otherwise `false` if the result has too many vertices.
+ */
+static
+bool accel_polygon_clip(
+  const struct accel_polygon *polygon,
+  double                      a,
+  double                      b,
+  double                      c,
+  struct accel_polygon       *result);
+
+/**
+ * \brief Builds the face of a leaf on a plane, in projected coordinates.
+ *
+ * \param [in]  bsp         The collision BSP.
+ * \param [in]  state       The build state.
+ * \param [in]  path        The nodes on the path to the leaf, from the root.
+ * \param [in]  sides       The child taken at each node in \a path.
+ * \param [in]  depth       The number of nodes in \a path.
+ * \param [in]  plane_index The index of the plane.
+ * \param [in]  projection  The projected component indices.
+ * \param [out] face        Receives the face; empty if the leaf is not on the plane.
+ *
+ * \return `true` on success, otherwise `false` if the face has too many vertices.
+ */
+static
+bool accel_leaf_face(
+  const collision_bsp            *bsp,
+  const struct accel_build_state *state,
+  const blam_index_long          *path,
+  const int                      *sides,
+  blam_long                       depth,
+  blam_index_long                 plane_index,
+  blam_pair_int                   projection,
+  struct accel_polygon           *face);
+
+/**
+ * \brief Tests if a polygon is within a surface projected onto a cardinal plane.
+ *
+ * The polygon may extend past the surface by #ACCEL_COVER_ULPS of the largest
+ * coordinate of either.
+ *
+ * \param [in] bsp           The collision BSP.
+ * \param [in] polygon       The polygon, in projected coordinates.
+ * \param [in] surface_index The index of the surface.
+ * \param [in] projection    The projected component indices.
+ */
+static
+bool accel_polygon_within_surface(
+  const collision_bsp        *bsp,
+  const struct accel_polygon *polygon,
+  blam_index_long             surface_index,
+  blam_pair_int               projection);
+
+/**
+ * \brief Tests if every surface a part of a leaf face resolves to covers that part.
+ *
+ * \param [in] bsp         The collision BSP.
+ * \param [in] plane_index The index of the face plane.
+ * \param [in] root        The index of the BSP2D subtree root.
+ * \param [in] polygon     The part of the face within the subtree.
+ * \param [in] projection  The projected component indices.
+ * \param [in] depth       The depth of \a root.
+ */
+static
+bool certification_test_bsp2d(
+  const collision_bsp        *bsp,
+  blam_index_long             plane_index,
+  blam_index_long             root,
+  const struct accel_polygon *polygon,
+  blam_pair_int               projection,
+  int                         depth);
+
+/**
+ * \brief Certifies the references of a covered leaf.
+ *
+ * \param [in]     bsp        The collision BSP.
+ * \param [in,out] cert       The certification.
+ * \param [in,out] state      The build state.
+ * \param [in]     leaf_index The index of the leaf.
+ * \param [in]     path       The nodes on the path to the leaf, from the root.
+ * \param [in]     sides      The child taken at each node in \a path.
+ * \param [in]     depth      The number of nodes in \a path.
+ */
+static
+void certification_add_leaf(
+  const collision_bsp      *bsp,
+  certification            *cert,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief Extends a box to contain another.
+ */
+static inline
+void accel_box_extend(box *target, const box *other);
+
+/**
+ * \brief Bounds a covered leaf by the vertices of its faces.
+ *
+ * The vertices are left in the build state for #leaf_bounds_add_leaf.
+ *
+ * \param [in]     bsp        The collision BSP.
+ * \param [in,out] state      The build state.
+ * \param [in]     leaf_index The index of the leaf.
+ * \param [in]     path       The nodes on the path to the leaf, from the root.
+ * \param [in]     sides      The child taken at each node in \a path.
+ * \param [in]     depth      The number of nodes in \a path.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool bounds_add_leaf(
+  const collision_bsp      *bsp,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief Bounds every node by the leaves below it.
+ *
+ * \param [in]  bsp    The collision BSP.
+ * \param [in]  state  The build state, with the bounds of every leaf.
+ * \param [out] bounds Receives the bounds of every node.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool bounds_build_nodes(
+  const collision_bsp            *bsp,
+  const struct accel_build_state *state,
+  content_bounds                 *bounds);
+
+/**
+ * \brief Adds the bounds of a covered leaf, from the vertices of its faces.
+ *
+ * \param [in]     bsp        The collision BSP.
+ * \param [in,out] bounds     The leaf bounds.
+ * \param [in,out] state      The build state.
+ * \param [in]     leaf_index The index of the leaf.
+ * \param [in]     path       The nodes on the path to the leaf, from the root.
+ * \param [in]     sides      The child taken at each node in \a path.
+ * \param [in]     depth      The number of nodes in \a path.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool leaf_bounds_add_leaf(
+  const collision_bsp      *bsp,
+  leaf_bounds              *bounds,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief Marks the nodes with BSP exterior below them.
+ *
+ * \param [in]  bsp      The collision BSP.
+ * \param [out] exterior Receives, for each node, nonzero if BSP exterior is below.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool repair_mark_exterior(
+  const collision_bsp *bsp,
+  blam_ubyte          *exterior);
+
+/**
+ * \brief Retargets a BSP2D reference to a nearly-coplanar plane.
+ *
+ * The retargeted reference searches its BSP2D with the same projection as \a ref,
+ * which requires both planes to project onto the same cardinal plane.
+ *
+ * \param [in]  planes      The planes of the collision BSP.
+ * \param [in]  ref         The reference to retarget.
+ * \param [in]  plane_index The index of the plane to retarget to.
+ * \param [out] result      Receives the retargeted reference.
+ *
+ * \return `true` on success, otherwise `false` if the projections differ.
+ */
+static
+bool repair_retarget_reference(
+  const blam_plane3d                *planes,
+  const struct blam_bsp2d_reference *ref,
+  blam_index_long                    plane_index,
+  struct blam_bsp2d_reference       *result);
+
+/**
+ * \brief Synthesizes the missing BSP2D references of a covered leaf.
+ *
+ * See #accel_leaf_visitor.
+ */
+static
+bool repair_visit_leaf(
+  const collision_bsp      *bsp,
+  collision_bsp_accel      *accel,
+  struct accel_build_state *state,
+  blam_index_long           leaf_index,
+  const blam_index_long    *path,
+  const int                *sides,
+  blam_long                 depth);
+
+/**
+ * \brief Builds the repaired copy of a collision BSP.
+ *
+ * \return `true` on success, otherwise `false` if memory could not be allocated.
+ */
+static
+bool repair_build(
+  const collision_bsp      *bsp,
+  collision_bsp_accel      *accel,
+  struct accel_build_state *state);
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+const struct blam_collision_bsp_leak_entry *blam_collision_bsp_leak_table_find(
+  const leak_table *const table,
+  const blam_index_long   leaf_index,
+  const blam_index_long   plane_index)
+{
+  assert(table);
+
+  if (table->bucket_count == 0)
+    return NULL;
+
+  const blam_ulong mask = (blam_ulong)table->bucket_count - 1;
+  for (blam_ulong bucket = leak_table_hash(table, leaf_index, plane_index)
+    ; table->buckets[bucket] != -1
+    ; bucket = (bucket + 1) & mask)
+  {
+    const struct blam_collision_bsp_leak_entry *const entry = &table->entries[table->buckets[bucket]];
+    if (entry->leaf == leaf_index && entry->plane == plane_index)
+      return entry;
+  }
+
+  return NULL;
+}
+
+blam_bool blam_collision_bsp_accel_build(
+  const collision_bsp *const bsp,
+  const blam_flags_long      flags,
+  collision_bsp_accel *const accel)
+{
+  assert(bsp);
+  assert(accel);
+
+  memset(accel, 0, sizeof(*accel));
+  accel->bsp   = bsp;
+  accel->flags = flags;
+
+  struct accel_build_state state = {
+    .capacities          = { 0, 0 },
+    .rejected_references = NULL,
+    .extent              = 0.0,
+    .tolerance           = 0.0,
+    .node_exterior       = NULL,
+    .reference_capacity  = 0,
+    .leaf_boxes          = NULL,
+    .vertices            = NULL,
+    .vertex_count        = 0,
+    .vertex_capacity     = 0,
+    .bound_capacity      = 0
+  };
+
+  // Leaf faces are clipped out of a square larger than the BSP, so that any part
+  // of a face left unbounded by the BSP can never be within a surface.
+  const struct blam_collision_vertex *const vertices = BLAM_TAG_BLOCK_BASE(bsp, vertices, vertices);
+  for (blam_long i = 0; i < bsp->vertices.count; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+      state.extent = fmax(state.extent, fabs(vertices[i].point.components[j]));
+  }
+  state.extent = 2.0 * state.extent + 16.0;
+  state.tolerance = 1.0e-3 + state.extent * 0x1p-16;
+
+  // Plane classes are shared with the repaired BSP, which has the same planes, 
+  // and so are the surfaces.
+  bool success = plane_classes_build(bsp, &accel->plane_classes)
+    && breakables_build(bsp, &accel->breakables);
+
+  // The remaining data is derived from the BSP queries actually run against.
+  success = success
+    && ((flags & k_collision_bsp_accel_repair_leaks) == 0 || repair_build(bsp, accel, &state));
+
+  const collision_bsp *const target = blam_collision_bsp_accel_target(accel);
+  const blam_long leaf_count      = target->leaves.count;
+  const blam_long reference_count = target->bsp2d.references.count;
+
+  accel->leak_table.leaf_count              = leaf_count;
+  accel->leak_table.covered_leaves          = calloc(leaf_count / ACCEL_WORD_BITS + 1, sizeof(blam_ulong));
+  accel->certification.reference_count      = reference_count;
+  accel->certification.certified_references = calloc(reference_count / ACCEL_WORD_BITS + 1, sizeof(blam_ulong));
+  state.rejected_references                 = calloc(reference_count / ACCEL_WORD_BITS + 1, sizeof(blam_ulong));
+  state.leaf_boxes                         = malloc((leaf_count + 1) * sizeof(*state.leaf_boxes));
+  accel->leaf_bounds.leaf_count             = leaf_count;
+  accel->leaf_bounds.ranges                 = calloc(leaf_count + 1, sizeof(*accel->leaf_bounds.ranges));
+
+  success = success
+    && accel->leak_table.covered_leaves != NULL
+    && accel->certification.certified_references != NULL
+    && state.rejected_references != NULL
+    && state.leaf_boxes != NULL
+    && accel->leaf_bounds.ranges != NULL;
+
+  // Leaves the walk does not reach keep unbounded boxes.
+  for (blam_long i = 0; success && i < leaf_count; ++i)
+    state.leaf_boxes[i] = accel_box_unbounded;
+
+  success = success
+    && accel_walk_leaves(target, accel, &state, accel_visit_leaf)
+    && leak_table_hash_entries(&accel->leak_table)
+    && bounds_build_nodes(target, &state, &accel->content_bounds);
+
+  if (success)
+  {
+    // References of leaves that were not walked cannot be certified, and neither
+    // can references shared with a leaf that failed certification.
+    const struct blam_bsp3d_leaf *const leaves = BLAM_TAG_BLOCK_BASE(target, leaves, leaves);
+    for (blam_long i = 0; i < leaf_count; ++i)
+    {
+      if (accel_bits_test(accel->leak_table.covered_leaves, i))
+        continue;
+
+      for (blam_long j = 0; j < leaves[i].reference_count; ++j)
+      {
+        const blam_index_long reference_index = leaves[i].first_reference + j;
+        if (0 <= reference_index && reference_index < reference_count)
+          accel_bits_set(state.rejected_references, reference_index);
+      }
+    }
+
+    for (blam_long i = 0; i < reference_count / ACCEL_WORD_BITS + 1; ++i)
+      accel->certification.certified_references[i] &= ~state.rejected_references[i];
+  }
+
+  free(state.rejected_references);
+  free(state.leaf_boxes);
+  free(state.vertices);
+
+  if (!success)
+  {
+    blam_collision_bsp_accel_destroy(accel);
+    return false;
+  }
+
+  // Arrays grown during the build give back the capacity they did not use.
+  accel_array_shrink((void **)&accel->leak_table.entries,    accel->leak_table.entry_count,     sizeof(*accel->leak_table.entries));
+  accel_array_shrink((void **)&accel->leak_table.candidates, accel->leak_table.candidate_count, sizeof(*accel->leak_table.candidates));
+  accel_array_shrink((void **)&accel->leaf_bounds.bounds,    accel->leaf_bounds.bound_count,    sizeof(*accel->leaf_bounds.bounds));
+  accel_array_shrink((void **)&accel->breakables.surfaces,   accel->breakables.surface_count + 1, sizeof(*accel->breakables.surfaces));
+  if (flags & k_collision_bsp_accel_repair_leaks)
+  {
+    struct blam_tag_block *const references = &accel->repair.bsp.bsp2d.references;
+    accel_array_shrink(&references->address, references->count, sizeof(struct blam_bsp2d_reference));
+  }
+
+  return true;
+}
+
+void blam_collision_bsp_accel_destroy(collision_bsp_accel *const accel)
+{
+  assert(accel);
+
+  // Mapped tables belong to the mapping.
+  if (accel->mapping != NULL)
+  {
+    blam_collision_bsp_sidecar_unmap(accel->mapping, accel->mapping_size);
+    memset(accel, 0, sizeof(*accel));
+    return;
+  }
+
+  free(accel->plane_classes.classes);
+  free(accel->leak_table.covered_leaves);
+  free(accel->leak_table.entries);
+  free(accel->leak_table.candidates);
+  free(accel->leak_table.buckets);
+  free(accel->certification.certified_references);
+  free(accel->content_bounds.nodes);
+  free(accel->leaf_bounds.ranges);
+  free(accel->leaf_bounds.bounds);
+  free(accel->breakables.surfaces);
+
+  if (accel->flags & k_collision_bsp_accel_repair_leaks)
+  {
+    free(accel->repair.bsp.leaves.address);
+    free(accel->repair.bsp.bsp2d.references.address);
+  }
+
+  memset(accel, 0, sizeof(*accel));
+}
+
+blam_long blam_collision_bsp_accel_footprint(const collision_bsp_accel *const accel)
+{
+  assert(accel);
+
+  // Each size matches the allocation of its table, including the spare element
+  // some are allocated with.
+  size_t size = 0;
+  if (accel->plane_classes.classes != NULL)
+    size += (accel->plane_classes.plane_count + 1) * sizeof(*accel->plane_classes.classes);
+  if (accel->leak_table.covered_leaves != NULL)
+    size += (accel->leak_table.leaf_count / ACCEL_WORD_BITS + 1) * sizeof(blam_ulong);
+  size += accel->leak_table.entry_count     * sizeof(*accel->leak_table.entries);
+  size += accel->leak_table.candidate_count * sizeof(*accel->leak_table.candidates);
+  size += accel->leak_table.bucket_count    * sizeof(*accel->leak_table.buckets);
+  if (accel->certification.certified_references != NULL)
+    size += (accel->certification.reference_count / ACCEL_WORD_BITS + 1) * sizeof(blam_ulong);
+  if (accel->content_bounds.nodes != NULL)
+    size += (accel->content_bounds.node_count + 1) * sizeof(*accel->content_bounds.nodes);
+  if (accel->leaf_bounds.ranges != NULL)
+    size += (accel->leaf_bounds.leaf_count + 1) * sizeof(*accel->leaf_bounds.ranges);
+  size += accel->leaf_bounds.bound_count * sizeof(*accel->leaf_bounds.bounds);
+  if (accel->breakables.surfaces != NULL)
+    size += (accel->breakables.surface_count + 1) * sizeof(*accel->breakables.surfaces);
+
+  if (accel->flags & k_collision_bsp_accel_repair_leaks)
+  {
+    size += (accel->repair.bsp.leaves.count + 1) * sizeof(struct blam_bsp3d_leaf);
+    size += accel->repair.bsp.bsp2d.references.count * sizeof(struct blam_bsp2d_reference);
+  }
+
+  return (blam_long)size;
+}
+
+blam_bool blam_collision_bsp_accel_attach(const collision_bsp_accel *const accel)
+{
+  assert(accel);
+  assert(accel->bsp);
+
+  const blam_index_long entry_index = registry_find(accel->bsp);
+  if (entry_index != -1)
+  {
+    const struct accel_registry_entry *const entry = &registry.entries[entry_index];
+    if (entry->owned != NULL && entry->reference_count > 0)
+      return false;
+
+    registry_remove(entry_index);
+  }
+
+  return registry_insert(accel, NULL) != NULL;
+}
+
+void blam_collision_bsp_accel_detach(const collision_bsp *const bsp)
+{
+  const blam_index_long entry_index = registry_find(bsp);
+  if (entry_index == -1)
+    return;
+
+  const struct accel_registry_entry *const entry = &registry.entries[entry_index];
+  if (entry->owned != NULL && entry->reference_count > 0)
+    return;
+
+  registry_remove(entry_index);
+}
+
+const collision_bsp_accel *blam_collision_bsp_accel_find(const collision_bsp *const bsp)
+{
+  const blam_index_long entry_index = registry_find(bsp);
+  return entry_index != -1 ? registry.entries[entry_index].accel : NULL;
+}
+
+const collision_bsp_accel *blam_collision_bsp_accel_acquire(
+  const collision_bsp *const bsp,
+  const blam_flags_long      flags)
+{
+  assert(bsp);
+
+  ++registry.stats.acquire_count;
+
+  const blam_index_long entry_index = registry_find(bsp);
+  if (entry_index != -1)
+  {
+    struct accel_registry_entry *const entry = &registry.entries[entry_index];
+    ++entry->reference_count;
+    entry->last_acquired = ++registry.time;
+
+    ++registry.stats.hit_count;
+    return entry->accel;
+  }
+
+  const char *const directory = registry.sidecar_directory[0] != '\0' ? registry.sidecar_directory : NULL;
+
+  collision_bsp_accel *const owned = malloc(sizeof(*owned));
+  if (owned == NULL || !blam_collision_bsp_accel_load(bsp, flags, directory, owned))
+  {
+    free(owned);
+    ++registry.stats.failure_count;
+    return NULL;
+  }
+
+  ++registry.stats.build_count;
+  if (owned->mapping != NULL)
+    ++registry.stats.map_count;
+
+  // The size of the data is only known once it is derived.
+  struct accel_registry_entry *const entry = registry_trim(blam_collision_bsp_accel_footprint(owned))
+    ? registry_insert(owned, owned)
+    : NULL;
+
+  if (entry == NULL)
+  {
+    blam_collision_bsp_accel_destroy(owned);
+    free(owned);
+    ++registry.stats.failure_count;
+    return NULL;
+  }
+
+  entry->reference_count = 1;
+  entry->last_acquired   = ++registry.time;
+  return owned;
+}
+
+void blam_collision_bsp_accel_release(const collision_bsp_accel *const accel)
+{
+  assert(accel);
+
+  // Data replaced by an attachment since it was acquired is no longer registered.
+  const blam_index_long entry_index = registry_find(accel->bsp);
+  if (entry_index == -1 || registry.entries[entry_index].accel != accel)
+    return;
+
+  struct accel_registry_entry *const entry = &registry.entries[entry_index];
+  assert(entry->reference_count > 0);
+  --entry->reference_count;
+
+  // A cap lowered while the data was in use applies now.
+  registry_trim(0);
+}
+
+void blam_collision_bsp_accel_set_memory_cap(const blam_long memory_cap)
+{
+  registry.stats.memory_cap = memory_cap >= 0 ? memory_cap : -1;
+  registry_trim(0);
+}
+
+blam_bool blam_collision_bsp_accel_set_sidecar_directory(const char *const directory)
+{
+  if (directory == NULL)
+  {
+    registry.sidecar_directory[0] = '\0';
+    return true;
+  }
+
+  const size_t length = strlen(directory);
+  if (length >= sizeof(registry.sidecar_directory))
+    return false;
+
+  memcpy(registry.sidecar_directory, directory, length + 1);
+  return true;
+}
+
+void blam_collision_bsp_accel_registry_stats(struct blam_collision_bsp_accel_registry_stats *const stats)
+{
+  assert(stats);
+
+  *stats = registry.stats;
+  stats->entry_count = registry.entry_count;
+}
+
+blam_long blam_collision_bsp_accel_registry_report(
+  struct blam_collision_bsp_accel_report *const reports,
+  const blam_long                               count)
+{
+  assert(reports || count == 0);
+
+  for (blam_long i = 0; i < count && i < registry.entry_count; ++i)
+  {
+    const struct accel_registry_entry *const entry = &registry.entries[i];
+    reports[i] = (struct blam_collision_bsp_accel_report) {
+      .bsp             = entry->accel->bsp,
+      .footprint       = entry->footprint,
+      .reference_count = entry->reference_count,
+      .owned           = entry->owned != NULL
+    };
+  }
+
+  return registry.entry_count;
+}
+
+blam_ulong blam_collision_bsp_breakable_generation_update(
+  struct blam_collision_bsp_breakable_generation *const tracker,
+  const struct blam_bit_vector                          breakable_surfaces)
+{
+  assert(tracker);
+
+  const blam_long count = breakable_surfaces.count < BLAM_COLLISION_BSP_BREAKABLE_STATE_BITS 
+    ? (breakable_surfaces.count > 0 ? breakable_surfaces.count : 0) 
+    : BLAM_COLLISION_BSP_BREAKABLE_STATE_BITS;
+  const blam_long word_count = (count + ACCEL_WORD_BITS - 1) / ACCEL_WORD_BITS;
+
+  // Bits past the count of the last word are not part of the state.
+  blam_ulong state[BLAM_COLLISION_BSP_BREAKABLE_STATE_BITS / ACCEL_WORD_BITS] = { 0 };
+  for (blam_long i = 0; i < word_count; ++i)
+    state[i] = breakable_surfaces.state[i];
+  if (count % ACCEL_WORD_BITS != 0)
+    state[word_count - 1] &= ((blam_ulong)1 << (count % ACCEL_WORD_BITS)) - 1;
+
+  if (tracker->generation != 0 
+    && tracker->count == breakable_surfaces.count
+    && memcmp(tracker->state, state, sizeof(state)) == 0)
+    return tracker->generation;
+
+  ++tracker->generation;
+  if (tracker->generation == 0)
+    tracker->generation = 1;
+  tracker->count = breakable_surfaces.count;
+  memcpy(tracker->state, state, sizeof(state));
+
+  return tracker->generation;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+bool accel_array_reserve(
+  void     **const array,
+  blam_long *const capacity,
+  const blam_long  count,
+  const size_t     size)
+{
+  if (count < *capacity)
+    return true;
+
+  const blam_long new_capacity = *capacity ? *capacity * 2 : 0x40;
+  void *const new_array = realloc(*array, new_capacity * size);
+  if (new_array == NULL)
+    return false;
+
+  *array    = new_array;
+  *capacity = new_capacity;
+  return true;
+}
+
+void accel_array_shrink(
+  void     **const array,
+  const blam_long  count,
+  const size_t     size)
+{
+  if (*array == NULL || count == 0)
+    return;
+
+  void *const new_array = realloc(*array, count * size);
+  if (new_array != NULL)
+    *array = new_array;
+}
+
+blam_ulong registry_hash(const collision_bsp *const bsp)
+{
+  const uint64_t address = (uintptr_t)bsp;
+  blam_ulong hash = (blam_ulong)(address ^ (address >> 32));
+  hash = (hash ^ (hash >> 15)) * UINT32_C(0x2C1B3C6D);
+  return hash ^ (hash >> 12);
+}
+
+blam_index_long registry_find(const collision_bsp *const bsp)
+{
+  if (registry.slot_count == 0)
+    return -1;
+
+  const blam_ulong mask = (blam_ulong)registry.slot_count - 1;
+  for (blam_ulong slot = registry_hash(bsp) & mask; ; slot = (slot + 1) & mask)
+  {
+    const blam_index_long entry_index = registry.slots[slot];
+    if (entry_index == -1 || registry.entries[entry_index].accel->bsp == bsp)
+      return entry_index;
+  }
+}
+
+struct accel_registry_entry *registry_insert(
+  const collision_bsp_accel *const accel,
+  collision_bsp_accel *const       owned)
+{
+  if (!accel_array_reserve((void **)&registry.entries, &registry.entry_capacity, registry.entry_count, sizeof(*registry.entries)))
+    return NULL;
+
+  // Keep the slots at most half full.
+  if (registry.slot_count < (registry.entry_count + 1) * 2)
+  {
+    const blam_long slot_count = registry.slot_count ? registry.slot_count * 2 : 0x40;
+    blam_index_long *const slots = malloc(slot_count * sizeof(*slots));
+    if (slots == NULL)
+      return NULL;
+
+    free(registry.slots);
+    registry.slots      = slots;
+    registry.slot_count = slot_count;
+  }
+
+  struct accel_registry_entry *const entry = &registry.entries[registry.entry_count++];
+  *entry = (struct accel_registry_entry) {
+    .accel           = accel,
+    .owned           = owned,
+    .footprint       = blam_collision_bsp_accel_footprint(accel),
+    .reference_count = 0,
+    .last_acquired   = 0
+  };
+
+  if (owned != NULL)
+    registry.stats.memory_size += entry->footprint;
+
+  registry_rehash();
+  return entry;
+}
+
+void registry_remove(const blam_index_long entry_index)
+{
+  struct accel_registry_entry *const entry = &registry.entries[entry_index];
+  if (entry->owned != NULL)
+  {
+    registry.stats.memory_size -= entry->footprint;
+    blam_collision_bsp_accel_destroy(entry->owned);
+    free(entry->owned);
+  }
+
+  *entry = registry.entries[--registry.entry_count];
+  registry_rehash();
+}
+
+void registry_rehash(void)
+{
+  if (registry.slot_count == 0)
+    return;
+
+  memset(registry.slots, 0xFF, registry.slot_count * sizeof(*registry.slots));
+
+  const blam_ulong mask = (blam_ulong)registry.slot_count - 1;
+  for (blam_index_long i = 0; i < registry.entry_count; ++i)
+  {
+    blam_ulong slot = registry_hash(registry.entries[i].accel->bsp) & mask;
+    while (registry.slots[slot] != -1)
+      slot = (slot + 1) & mask;
+
+    registry.slots[slot] = i;
+  }
+}
+
+bool registry_trim(const blam_long memory_size)
+{
+  const blam_long memory_cap = registry.stats.memory_cap;
+  if (memory_cap < 0)
+    return true;
+
+  while (registry.stats.memory_size > memory_cap - memory_size)
+  {
+    blam_index_long victim = -1;
+    for (blam_index_long i = 0; i < registry.entry_count; ++i)
+    {
+      const struct accel_registry_entry *const entry = &registry.entries[i];
+      if (entry->owned != NULL && entry->reference_count == 0
+        && (victim == -1 || entry->last_acquired < registry.entries[victim].last_acquired))
+        victim = i;
+    }
+
+    if (victim == -1)
+      return false;
+
+    registry_remove(victim);
+    ++registry.stats.eviction_count;
+  }
+
+  return true;
+}
+
+blam_index_long collision_bsp_leaf_reference(
+  const collision_bsp *const bsp,
+  const blam_index_long      leaf_index,
+  const blam_index_long      plane_index)
+{
+  const struct blam_bsp3d_leaf *const leaf = BLAM_TAG_BLOCK_GET(bsp, leaf, leaves, leaf_index);
+  const struct blam_bsp2d_reference *const references = BLAM_TAG_BLOCK_BASE(&bsp->bsp2d, references, references);
+
+  // Matches the reference selected by collision_bsp_search_leaf.
+  for (blam_long i = 0; i < leaf->reference_count; ++i)
+  {
+    const blam_index_long reference_index = leaf->first_reference + i;
+    if (blam_sanitize_long(references[reference_index].plane) == plane_index)
+      return reference_index;
+  }
+
+  return -1;
+}
+
+int plane_classes_compare_keys(const void *const a, const void *const b)
+{
+  const struct plane_classes_key *const x = a;
+  const struct plane_classes_key *const y = b;
+
+  if (x->magnitude != y->magnitude)
+    return x->magnitude < y->magnitude ? -1 : 1;
+  return x->plane < y->plane ? -1 : (x->plane > y->plane);
+}
+
+blam_index_long plane_classes_find(blam_index_long *const classes, blam_index_long plane_index)
+{
+  while (classes[plane_index] != plane_index)
+  {
+    classes[plane_index] = classes[classes[plane_index]];
+    plane_index = classes[plane_index];
+  }
+
+  return plane_index;
+}
+
+void plane_classes_merge(
+  plane_classes      *const classes,
+  const blam_plane3d *const planes,
+  const blam_index_long     plane_index,
+  const blam_index_long     other_plane_index)
+{
+  const blam_index_long root       = plane_classes_find(classes->classes, plane_index);
+  const blam_index_long other_root = plane_classes_find(classes->classes, other_plane_index);
+  if (root == other_root)
+    return;
+
+  if (!blam_plane3d_test_nearly_coplanar(&planes[plane_index], &planes[other_plane_index]))
+    return;
+
+  // Keep the lowest index as the root, so that class ids are canonical.
+  if (root < other_root)
+    classes->classes[other_root] = root;
+  else
+    classes->classes[root] = other_root;
+}
+
+bool plane_classes_build(const collision_bsp *const bsp, plane_classes *const classes)
+{
+  const blam_plane3d *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  const blam_long plane_count = bsp->planes.count;
+
+  classes->plane_count = plane_count;
+  classes->classes     = malloc((plane_count + 1) * sizeof(*classes->classes));
+
+  struct plane_classes_key *const keys = malloc((plane_count + 1) * sizeof(*keys));
+  if (classes->classes == NULL || keys == NULL)
+  {
+    free(keys);
+    return false;
+  }
+
+  // Nearly-coplanar planes have distances within 0.025 of each other up to sign,
+  // so their magnitudes are too, and only planes close in magnitude need testing.
+  // Planes with non-finite components escape that bound and are tested against 
+  // every plane.
+  for (blam_index_long i = 0; i < plane_count; ++i)
+    classes->classes[i] = i;
+
+  blam_long key_count = 0;
+  for (blam_index_long i = 0; i < plane_count; ++i)
+  {
+    const blam_plane3d *const plane = &planes[i];
+    if (isfinite(plane->d) 
+      && isfinite(plane->normal.components[0])
+      && isfinite(plane->normal.components[1])
+      && isfinite(plane->normal.components[2]))
+    {
+      keys[key_count++] = (struct plane_classes_key) { fabs((double)plane->d), i };
+    }
+    else
+    {
+      for (blam_index_long j = 0; j < plane_count; ++j)
+        plane_classes_merge(classes, planes, i, j);
+    }
+  }
+
+  qsort(keys, key_count, sizeof(*keys), plane_classes_compare_keys);
+
+  for (blam_long i = 0; i < key_count; ++i)
+  {
+    for (blam_long j = i + 1; j < key_count && keys[j].magnitude - keys[i].magnitude <= 0.025; ++j)
+      plane_classes_merge(classes, planes, keys[i].plane, keys[j].plane);
+  }
+
+  for (blam_index_long i = 0; i < plane_count; ++i)
+    classes->classes[i] = plane_classes_find(classes->classes, i);
+
+  free(keys);
+  return true;
+}
+
+bool breakables_build(const collision_bsp *const bsp, breakables *const breakables)
+{
+  const struct blam_collision_surface *const surfaces = BLAM_TAG_BLOCK_BASE(bsp, surfaces, surfaces);
+  const blam_long surface_count = bsp->surfaces.count;
+
+  breakables->surface_count = 0;
+  breakables->state_count   = 0;
+  breakables->surfaces      = malloc((surface_count + 1) * sizeof(*breakables->surfaces));
+  if (breakables->surfaces == NULL)
+    return false;
+
+  for (blam_long i = 0; i < surface_count; ++i)
+  {
+    if ((surfaces[i].flags & 0x08) == 0) // breakable flag
+      continue;
+
+    breakables->surfaces[breakables->surface_count++] = i;
+    if (surfaces[i].breakable_surface >= breakables->state_count)
+      breakables->state_count = surfaces[i].breakable_surface + 1;
+  }
+
+  return true;
+}
+
+bool accel_test_nearly_coplanar(
+  const plane_classes *const classes,
+  const blam_plane3d  *const planes,
+  const blam_index_long      plane_index,
+  const blam_index_long      other_plane_index)
+{
+  return blam_collision_bsp_plane_classes_share(classes, plane_index, other_plane_index)
+    && blam_plane3d_test_nearly_coplanar(&planes[plane_index], &planes[other_plane_index]);
+}
+
+bool accel_walk_leaves(
+  const collision_bsp      *const bsp,
+  collision_bsp_accel      *const accel,
+  struct accel_build_state *const state,
+  const accel_leaf_visitor        visitor)
+{
+  const struct blam_bsp3d_node *const nodes = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_long node_count = bsp->bsp3d_nodes.count;
+  const blam_long leaf_count = bsp->leaves.count;
+
+  if (node_count == 0)
+    return true;
+
+  // Count the parents of every node and leaf, saturating at 2. Only leaves with
+  // a single path from the root have a well-defined path to precompute against.
+  blam_ubyte *const node_parents = calloc(node_count, 1);
+  blam_ubyte *const leaf_parents = calloc(leaf_count + 1, 1);
+
+  bool success = node_parents != NULL && leaf_parents != NULL;
+  if (success)
+  {
+    for (blam_long i = 0; i < node_count; ++i)
+    {
+      for (int j = 0; j < 2; ++j)
+      {
+        const blam_index_long child = nodes[i].children[j];
+        if (child >= 0)
+        {
+          if (child < node_count && node_parents[child] < 2)
+            ++node_parents[child];
+        } else if (child != -1)
+        {
+          const blam_index_long leaf_index = blam_sanitize_long(child);
+          if (leaf_index < leaf_count && leaf_parents[leaf_index] < 2)
+            ++leaf_parents[leaf_index];
+        }
+      }
+    }
+  }
+
+  blam_index_long path[ACCEL_MAX_PATH_LENGTH];
+  int             sides[ACCEL_MAX_PATH_LENGTH];
+  blam_long       depth = 0;
+
+  if (success && node_parents[0] == 0)
+  {
+    path[0]  = 0;
+    sides[0] = -1;
+    depth    = 1;
+  }
+
+  while (success && depth > 0)
+  {
+    // sides[top] is the child last taken at the top node, -1 before the first.
+    const blam_long top = depth - 1;
+    if (sides[top] == 1)
+    {
+      --depth;
+      continue;
+    }
+
+    const blam_index_long child = nodes[path[top]].children[++sides[top]];
+    if (child >= 0)
+    {
+      // The path to any leaf below must fit in the node path, leaf included.
+      if (child < node_count && node_parents[child] == 1 && depth < ACCEL_MAX_PATH_LENGTH - 1)
+      {
+        path[depth]  = child;
+        sides[depth] = -1;
+        ++depth;
+      }
+    } else if (child != -1)
+    {
+      const blam_index_long leaf_index = blam_sanitize_long(child);
+      if (leaf_index < leaf_count && leaf_parents[leaf_index] == 1)
+        success = visitor(bsp, accel, state, leaf_index, path, sides, depth);
+    }
+  }
+
+  free(node_parents);
+  free(leaf_parents);
+
+  return success;
+}
+
+bool accel_visit_leaf(
+  const collision_bsp      *const bsp,
+  collision_bsp_accel      *const accel,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const int                *const sides,
+  const blam_long                 depth)
+{
+  accel_bits_set(accel->leak_table.covered_leaves, leaf_index);
+  certification_add_leaf(bsp, &accel->certification, state, leaf_index, path, sides, depth);
+  return bounds_add_leaf(bsp, state, leaf_index, path, sides, depth)
+    && leaf_bounds_add_leaf(bsp, &accel->leaf_bounds, state, leaf_index, path, sides, depth)
+    && leak_table_add_leaf(bsp, &accel->plane_classes, &accel->leak_table, state, leaf_index, path, depth);
+}
+
+blam_ulong leak_table_hash(
+  const leak_table *const table,
+  const blam_index_long   leaf_index,
+  const blam_index_long   plane_index)
+{
+  blam_ulong hash = ((blam_ulong)leaf_index * 0x9E3779B1uL + (blam_ulong)plane_index) * 0x85EBCA77uL;
+  hash ^= hash >> 15;
+  return hash & ((blam_ulong)table->bucket_count - 1);
+}
+
+bool leak_table_add_leaf(
+  const collision_bsp      *const bsp,
+  const plane_classes      *const classes,
+  leak_table               *const table,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const blam_long                 depth)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes,  bsp3d_nodes);
+  const blam_plane3d           *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+
+  for (blam_long i = 0; i < depth; ++i)
+  {
+    const blam_index_long plane_index = nodes[path[i]].plane;
+
+    bool seen = false;
+    for (blam_long j = 0; j < i && !seen; ++j)
+      seen = nodes[path[j]].plane == plane_index;
+    if (seen)
+      continue;
+
+    // Mirror the Form 1 search in try_resolve_bsp_leak: walk up the path from the
+    // leaf, excluding the root, for nearly-coplanar planes the leaf can search.
+    const blam_index_long first_candidate = table->candidate_count;
+    for (blam_long j = depth - 1; j > 0; --j)
+    {
+      const blam_index_long candidate_plane = nodes[path[j]].plane;
+      if (candidate_plane == plane_index)
+        continue;
+
+      if (!accel_test_nearly_coplanar(classes, planes, plane_index, candidate_plane))
+        continue;
+
+      // Searching the same plane again yields the same surface.
+      bool duplicate = false;
+      for (blam_long k = first_candidate; k < table->candidate_count && !duplicate; ++k)
+        duplicate = table->candidates[k].plane == candidate_plane;
+      if (duplicate)
+        continue;
+
+      const blam_index_long reference_index = collision_bsp_leaf_reference(bsp, leaf_index, candidate_plane);
+      if (reference_index == -1)
+        continue;
+
+      if (!accel_array_reserve((void **)&table->candidates, &state->capacities[1], table->candidate_count, sizeof(*table->candidates)))
+        return false;
+
+      table->candidates[table->candidate_count++] = (struct blam_collision_bsp_leak_candidate)
+      {
+        .plane     = candidate_plane,
+        .reference = reference_index
+      };
+    }
+
+    if (table->candidate_count == first_candidate)
+      continue;
+
+    if (!accel_array_reserve((void **)&table->entries, &state->capacities[0], table->entry_count, sizeof(*table->entries)))
+      return false;
+
+    table->entries[table->entry_count++] = (struct blam_collision_bsp_leak_entry)
+    {
+      .leaf            = leaf_index,
+      .plane           = plane_index,
+      .first_candidate = first_candidate,
+      .candidate_count = table->candidate_count - first_candidate
+    };
+  }
+
+  return true;
+}
+
+bool leak_table_hash_entries(leak_table *const table)
+{
+  if (table->entry_count == 0)
+    return true;
+
+  // Keep the buckets at most half full.
+  blam_long bucket_count = 1;
+  while (bucket_count < table->entry_count * 2)
+    bucket_count *= 2;
+
+  table->buckets = malloc(bucket_count * sizeof(*table->buckets));
+  if (table->buckets == NULL)
+    return false;
+
+  table->bucket_count = bucket_count;
+  memset(table->buckets, 0xFF, bucket_count * sizeof(*table->buckets));
+
+  for (blam_long i = 0; i < table->entry_count; ++i)
+  {
+    blam_ulong bucket = leak_table_hash(table, table->entries[i].leaf, table->entries[i].plane);
+    while (table->buckets[bucket] != -1)
+      bucket = (bucket + 1) & (blam_ulong)(bucket_count - 1);
+    table->buckets[bucket] = i;
+  }
+
+  return true;
+}
+
+bool accel_polygon_clip(
+  const struct accel_polygon *const polygon,
+  const double                      a,
+  const double                      b,
+  const double                      c,
+  struct accel_polygon       *const result)
+{
+  result->count = 0;
+
+  for (int i = 0; i < polygon->count; ++i)
+  {
+    const double *const p = polygon->points[i];
+    const double *const q = polygon->points[(i + 1) % polygon->count];
+    const double        pt = a * p[0] + b * p[1] + c;
+    const double        qt = a * q[0] + b * q[1] + c;
+
+    if (pt >= 0.0)
+    {
+      if (result->count == ACCEL_MAX_POLYGON_VERTICES)
+        return false;
+      result->points[result->count][0] = p[0];
+      result->points[result->count][1] = p[1];
+      ++result->count;
+    }
+
+    if ((pt >= 0.0) != (qt >= 0.0))
+    {
+      if (result->count == ACCEL_MAX_POLYGON_VERTICES)
+        return false;
+      const double t = pt / (pt - qt);
+      result->points[result->count][0] = p[0] + t * (q[0] - p[0]);
+      result->points[result->count][1] = p[1] + t * (q[1] - p[1]);
+      ++result->count;
+    }
+  }
+
+  return true;
+}
+
+bool accel_leaf_face(
+  const collision_bsp            *const bsp,
+  const struct accel_build_state *const state,
+  const blam_index_long          *const path,
+  const int                      *const sides,
+  const blam_long                       depth,
+  const blam_index_long                 plane_index,
+  const blam_pair_int                   projection,
+  struct accel_polygon           *const face)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_plane3d           *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  const blam_plane3d           *const plane  = &planes[plane_index];
+
+  // The face is the plane clipped to the leaf. In projected coordinates, the
+  // dropped component of a point on the plane is given by the other two.
+  const int    k  = 3 - projection.first - projection.second;
+  const double nu = plane->normal.components[projection.first]  / plane->normal.components[k];
+  const double nv = plane->normal.components[projection.second] / plane->normal.components[k];
+  const double nd = plane->d / plane->normal.components[k];
+
+  *face = (struct accel_polygon) {
+    .count  = 4,
+    .points = {
+      { -state->extent, -state->extent },
+      {  state->extent, -state->extent },
+      {  state->extent,  state->extent },
+      { -state->extent,  state->extent }
+    }
+  };
+
+  for (blam_long i = 0; i < depth && face->count > 0; ++i)
+  {
+    const struct blam_bsp3d_node *const node = &nodes[path[i]];
+    if (node->plane == plane_index)
+      continue;
+
+    const blam_plane3d *const split = &planes[node->plane];
+    const double sign = sides[i] == 1 ? 1.0 : -1.0;
+    const double a = sign * (split->normal.components[projection.first]  - split->normal.components[k] * nu);
+    const double b = sign * (split->normal.components[projection.second] - split->normal.components[k] * nv);
+    const double c = sign * (split->normal.components[k] * nd - split->d);
+
+    struct accel_polygon clipped;
+    if (!accel_polygon_clip(face, a, b, c, &clipped))
+      return false;
+    *face = clipped;
+  }
+
+  return true;
+}
+
+bool accel_polygon_within_surface(
+  const collision_bsp        *const bsp,
+  const struct accel_polygon *const polygon,
+  const blam_index_long             surface_index,
+  const blam_pair_int               projection)
+{
+  const struct blam_collision_surface *const surface = BLAM_TAG_BLOCK_GET(bsp, surface, surfaces, surface_index);
+  const struct blam_collision_vertex  *const vertices = BLAM_TAG_BLOCK_BASE(bsp, vertices, vertices);
+  const struct blam_collision_edge    *const edges    = BLAM_TAG_BLOCK_BASE(bsp, edges, edges);
+
+  // Gather the projected surface polygon, in order.
+  struct accel_polygon outline = { .count = 0 };
+  blam_index_long edge_index = surface->first_edge;
+  do
+  {
+    if (outline.count == ACCEL_MAX_POLYGON_VERTICES)
+      return false;
+
+    const struct blam_collision_edge *const edge = &edges[edge_index];
+    const blam_real3d *const point = &vertices[blam_collision_edge_inorder_vertex(edge, surface_index)].point;
+    outline.points[outline.count][0] = point->components[projection.first];
+    outline.points[outline.count][1] = point->components[projection.second];
+    ++outline.count;
+
+    edge_index = blam_collision_edge_inorder_edge(edge, surface_index);
+  } while (edge_index != surface->first_edge);
+
+  // Faces meeting their surfaces exactly at the edges are off by the rounding of
+  // the coordinates and planes involved, which is relative to those coordinates 
+  // rather than to the extent of the map.
+  double magnitude = 1.0;
+  for (int i = 0; i < outline.count; ++i)
+    magnitude = fmax(magnitude, fmax(fabs(outline.points[i][0]), fabs(outline.points[i][1])));
+  for (int i = 0; i < polygon->count; ++i)
+    magnitude = fmax(magnitude, fmax(fabs(polygon->points[i][0]), fabs(polygon->points[i][1])));
+  const double tolerance = ACCEL_COVER_ULPS * FLT_EPSILON * magnitude;
+
+  double area = 0.0;
+  for (int i = 0; i < outline.count; ++i)
+  {
+    const double *const p = outline.points[i];
+    const double *const q = outline.points[(i + 1) % outline.count];
+    area += p[0] * q[1] - p[1] * q[0];
+  }
+
+  if (fabs(area) <= tolerance * tolerance)
+    return false; // degenerate
+
+  const double orientation = area > 0.0 ? 1.0 : -1.0;
+  for (int i = 0; i < outline.count; ++i)
+  {
+    const double *const p = outline.points[i];
+    const double *const q = outline.points[(i + 1) % outline.count];
+    const double du = q[0] - p[0];
+    const double dv = q[1] - p[1];
+    const double length = sqrt(du * du + dv * dv);
+    if (length == 0.0)
+      continue;
+
+    for (int j = 0; j < polygon->count; ++j)
+    {
+      const double *const point = polygon->points[j];
+      const double distance = orientation * (du * (point[1] - p[1]) - dv * (point[0] - p[0])) / length;
+      if (distance < -tolerance)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool certification_test_bsp2d(
+  const collision_bsp        *const bsp,
+  const blam_index_long             plane_index,
+  const blam_index_long             root,
+  const struct accel_polygon *const polygon,
+  const blam_pair_int               projection,
+  const int                         depth)
+{
+  if (polygon->count == 0)
+    return true; // this part of the BSP2D is unreachable from the face
+
+  if (root < 0)
+  {
+    const blam_index_long surface_index = blam_sanitize_long_s(root);
+    if (surface_index == -1)
+      return true; // no surface to validate
+
+    // The surface must lie on the face plane for the tested vector to cross it
+    // where it crosses the face, and breakable surfaces may be broken.
+    const struct blam_collision_surface *const surface = BLAM_TAG_BLOCK_GET(bsp, surface, surfaces, surface_index);
+    if (blam_sanitize_long(surface->plane) != plane_index || (surface->flags & 0x08) != 0)
+      return false;
+
+    return accel_polygon_within_surface(bsp, polygon, surface_index, projection);
+  }
+
+  if (depth >= ACCEL_MAX_BSP2D_DEPTH)
+    return false;
+
+  const struct blam_bsp2d_node *const node = BLAM_TAG_BLOCK_GET(&bsp->bsp2d, node, nodes, root);
+  const double a = node->plane.normal.components[0];
+  const double b = node->plane.normal.components[1];
+  const double c = -node->plane.d;
+
+  struct accel_polygon part;
+  return accel_polygon_clip(polygon, a, b, c, &part)
+    && certification_test_bsp2d(bsp, plane_index, node->children[1], &part, projection, depth + 1)
+    && accel_polygon_clip(polygon, -a, -b, -c, &part)
+    && certification_test_bsp2d(bsp, plane_index, node->children[0], &part, projection, depth + 1);
+}
+
+void certification_add_leaf(
+  const collision_bsp      *const bsp,
+  certification            *const cert,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const int                *const sides,
+  const blam_long                 depth)
+{
+  const blam_plane3d                *const planes     = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  const struct blam_bsp3d_leaf      *const leaf       = BLAM_TAG_BLOCK_GET(bsp, leaf, leaves, leaf_index);
+  const struct blam_bsp2d_reference *const references = BLAM_TAG_BLOCK_BASE(&bsp->bsp2d, references, references);
+
+  for (blam_long i = 0; i < leaf->reference_count; ++i)
+  {
+    const blam_index_long reference_index = leaf->first_reference + i;
+    if (reference_index < 0 || reference_index >= cert->reference_count)
+      continue;
+
+    const struct blam_bsp2d_reference *const ref = &references[reference_index];
+    const blam_index_long     plane_index = blam_sanitize_long(ref->plane);
+    const blam_plane3d *const plane       = &planes[plane_index];
+
+    // Use the projection collision_bsp_search_leaf searches the BSP2D with.
+    const enum blam_projection_plane projection_plane = blam_real3d_projection_plane(&plane->normal);
+    const bool projection_inverted = plane->normal.components[projection_plane] <= 0.0f;
+    const bool is_forward_plane    = projection_inverted == (ref->plane < 0);
+    const blam_pair_int projection = blam_projection_plane_indices(projection_plane, is_forward_plane);
+
+    struct accel_polygon face;
+    const bool certified = accel_leaf_face(bsp, state, path, sides, depth, plane_index, projection, &face)
+      && certification_test_bsp2d(bsp, plane_index, ref->root_node, &face, projection, 0);
+
+    if (certified)
+      accel_bits_set(cert->certified_references, reference_index);
+    else
+      accel_bits_set(state->rejected_references, reference_index);
+  }
+}
+
+void accel_box_extend(box *const target, const box *const other)
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    target->lower.components[i] = fminf(target->lower.components[i], other->lower.components[i]);
+    target->upper.components[i] = fmaxf(target->upper.components[i], other->upper.components[i]);
+  }
+}
+
+bool bounds_add_leaf(
+  const collision_bsp      *const bsp,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const int                *const sides,
+  const blam_long                 depth)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_plane3d           *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+
+  // A bounded leaf is the convex hull of the vertices of its faces, all of which
+  // lie on planes up its path. If the leaf is unbounded, some face is too, and 
+  // reaches the edge of the polygon the faces are clipped out of.
+  const double limit = state->extent - state->tolerance;
+  state->vertex_count = 0;
+  for (blam_long i = 0; i < depth && state->vertex_count != -1; ++i)
+  {
+    const blam_index_long plane_index = nodes[path[i]].plane;
+
+    bool seen = false;
+    for (blam_long j = 0; j < i && !seen; ++j)
+      seen = nodes[path[j]].plane == plane_index;
+    if (seen)
+      continue;
+
+    const blam_plane3d *const plane = &planes[plane_index];
+    const enum blam_projection_plane projection_plane = blam_real3d_projection_plane(&plane->normal);
+    const blam_pair_int projection = blam_projection_plane_indices(projection_plane, true);
+    const int k = 3 - projection.first - projection.second;
+
+    struct accel_polygon face;
+    if (!accel_leaf_face(bsp, state, path, sides, depth, plane_index, projection, &face))
+    {
+      state->vertex_count = -1;
+      break;
+    }
+
+    for (int j = 0; j < face.count; ++j)
+    {
+      const double u = face.points[j][0];
+      const double v = face.points[j][1];
+      if (fabs(u) >= limit || fabs(v) >= limit)
+      {
+        state->vertex_count = -1;
+        break;
+      }
+
+      if (!accel_array_reserve((void **)&state->vertices, &state->vertex_capacity, state->vertex_count, sizeof(*state->vertices)))
+        return false;
+
+      double *const vertex = state->vertices[state->vertex_count++];
+      vertex[projection.first]  = u;
+      vertex[projection.second] = v;
+      vertex[k] = (plane->d
+        - plane->normal.components[projection.first]  * u
+        - plane->normal.components[projection.second] * v) / plane->normal.components[k];
+    }
+  }
+
+  // A leaf without faces is too thin to bound reliably.
+  if (state->vertex_count == 0)
+    state->vertex_count = -1;
+
+  if (state->vertex_count == -1)
+    return true;
+
+  double lower[3] = {  INFINITY,  INFINITY,  INFINITY };
+  double upper[3] = { -INFINITY, -INFINITY, -INFINITY };
+  for (blam_long i = 0; i < state->vertex_count; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      lower[j] = fmin(lower[j], state->vertices[i][j]);
+      upper[j] = fmax(upper[j], state->vertices[i][j]);
+    }
+  }
+
+  box *const bounds = &state->leaf_boxes[leaf_index];
+  for (int i = 0; i < 3; ++i)
+  {
+    bounds->lower.components[i] = (blam_real)(lower[i] - state->tolerance);
+    bounds->upper.components[i] = (blam_real)(upper[i] + state->tolerance);
+  }
+
+  return true;
+}
+
+bool bounds_build_nodes(
+  const collision_bsp            *const bsp,
+  const struct accel_build_state *const state,
+  content_bounds                 *const bounds)
+{
+  enum { k_unvisited, k_visiting, k_resolved };
+
+  const struct blam_bsp3d_node *const nodes = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_long node_count = bsp->bsp3d_nodes.count;
+  const blam_long leaf_count = bsp->leaves.count;
+
+  bounds->node_count = node_count;
+  bounds->nodes      = malloc((node_count + 1) * sizeof(*bounds->nodes));
+
+  blam_ubyte      *const marks = calloc(node_count + 1, 1);
+  blam_index_long *const stack = malloc((node_count + 1) * sizeof(*stack));
+  const bool success = bounds->nodes != NULL && marks != NULL && stack != NULL;
+
+  if (success && node_count > 0)
+  {
+    // Nodes the traversal cannot reach keep unbounded boxes.
+    for (blam_long i = 0; i < node_count; ++i)
+      bounds->nodes[i] = accel_box_unbounded;
+
+    blam_long count = 0;
+    stack[count++] = 0;
+    marks[0] = k_visiting;
+
+    // Post-order traversal; a node is resolved once both of its children are.
+    while (count > 0)
+    {
+      const blam_index_long node_index = stack[count - 1];
+      bool resolved = true;
+
+      for (int i = 0; i < 2; ++i)
+      {
+        const blam_index_long child = nodes[node_index].children[i];
+        if (child >= 0 && child < node_count && marks[child] == k_unvisited)
+        {
+          marks[child] = k_visiting;
+          stack[count++] = child;
+          resolved = false;
+        }
+      }
+
+      if (!resolved)
+        continue;
+
+      box result = accel_box_empty;
+      for (int i = 0; i < 2; ++i)
+      {
+        const blam_index_long child = nodes[node_index].children[i];
+        if (child == -1)
+          continue;
+
+        const blam_index_long leaf_index = blam_sanitize_long_s(child);
+        if (child < 0 && leaf_index < leaf_count)
+          accel_box_extend(&result, &state->leaf_boxes[leaf_index]);
+        else if (child >= 0 && child < node_count && marks[child] == k_resolved)
+          accel_box_extend(&result, &bounds->nodes[child]);
+        else
+          result = accel_box_unbounded; // a cycle or an invalid child
+      }
+
+      bounds->nodes[node_index] = result;
+      marks[node_index] = k_resolved;
+      --count;
+    }
+  }
+
+  free(marks);
+  free(stack);
+  return success;
+}
+
+bool leaf_bounds_add_leaf(
+  const collision_bsp      *const bsp,
+  leaf_bounds              *const bounds,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const int                *const sides,
+  const blam_long                 depth)
+{
+  const struct blam_bsp3d_node *const nodes  = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_plane3d           *const planes = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+
+  struct blam_collision_bsp_leaf_bound_range *const range = &bounds->ranges[leaf_index];
+  range->first = bounds->bound_count;
+  range->count = 0;
+
+  // Deeper splits come first, as they are the likeliest to be crossed by a point
+  // that moved only slightly.
+  for (blam_long i = depth - 1; i >= 0; --i)
+  {
+    const blam_index_long plane_index = nodes[path[i]].plane;
+
+    bool seen = false;
+    for (blam_long j = range->first; j < bounds->bound_count && !seen; ++j)
+      seen = bounds->bounds[j].plane == plane_index && bounds->bounds[j].side == sides[i];
+    if (seen)
+      continue;
+
+    // Plane tests are exact up to double rounding, so a point found on the leaf's
+    // side of every bound is within far less than the tolerance of the leaf. Any
+    // split the whole leaf clears by the tolerance is then decided the same way.
+    if (state->vertex_count != -1)
+    {
+      const double sign = sides[i] == 1 ? 1.0 : -1.0;
+      bool clear = true;
+      for (blam_long j = 0; j < state->vertex_count && clear; ++j)
+      {
+        const double *const vertex = state->vertices[j];
+        const blam_plane3d *const plane = &planes[plane_index];
+        const double distance = plane->normal.components[0] * vertex[0]
+          + plane->normal.components[1] * vertex[1]
+          + plane->normal.components[2] * vertex[2]
+          - plane->d;
+        clear = sign * distance >= state->tolerance;
+      }
+
+      if (clear)
+        continue;
+    }
+
+    if (!accel_array_reserve((void **)&bounds->bounds, &state->bound_capacity, bounds->bound_count, sizeof(*bounds->bounds)))
+      return false;
+
+    bounds->bounds[bounds->bound_count++] = (struct blam_collision_bsp_leaf_bound)
+    {
+      .plane = plane_index,
+      .side  = sides[i]
+    };
+    ++range->count;
+  }
+
+  return true;
+}
+
+bool repair_mark_exterior(
+  const collision_bsp *const bsp,
+  blam_ubyte          *const exterior)
+{
+  enum { k_unvisited, k_visiting, k_interior, k_exterior };
+
+  const struct blam_bsp3d_node *const nodes = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_long node_count = bsp->bsp3d_nodes.count;
+
+  blam_index_long *const stack = malloc(node_count * sizeof(*stack));
+  if (stack == NULL)
+    return false;
+
+  memset(exterior, k_unvisited, node_count);
+
+  blam_long count = 0;
+  stack[count++] = 0;
+  exterior[0] = k_visiting;
+
+  // Post-order traversal; a node is resolved once both of its children are.
+  while (count > 0)
+  {
+    const blam_index_long node_index = stack[count - 1];
+    bool resolved = true;
+    bool below    = false;
+
+    for (int i = 0; i < 2 && resolved; ++i)
+    {
+      const blam_index_long child = nodes[node_index].children[i];
+      if (child == -1)
+        below = true;
+      else if (child >= 0 && child < node_count)
+      {
+        if (exterior[child] == k_unvisited)
+        {
+          exterior[child] = k_visiting;
+          stack[count++] = child;
+          resolved = false;
+        } else
+          below |= exterior[child] == k_exterior;
+      }
+    }
+
+    if (resolved)
+    {
+      exterior[node_index] = below ? k_exterior : k_interior;
+      --count;
+    }
+  }
+
+  for (blam_long i = 0; i < node_count; ++i)
+    exterior[i] = exterior[i] == k_exterior;
+
+  free(stack);
+  return true;
+}
+
+bool repair_retarget_reference(
+  const blam_plane3d                *const planes,
+  const struct blam_bsp2d_reference *const ref,
+  const blam_index_long                    plane_index,
+  struct blam_bsp2d_reference       *const result)
+{
+  const blam_plane3d *const source = &planes[blam_sanitize_long(ref->plane)];
+  const blam_plane3d *const target = &planes[plane_index];
+
+  const enum blam_projection_plane projection_plane = blam_real3d_projection_plane(&source->normal);
+  if (blam_real3d_projection_plane(&target->normal) != projection_plane)
+    return false;
+
+  // Choose the inversion bit that keeps the winding collision_bsp_search_leaf
+  // projects the source reference with.
+  const bool source_inverted  = source->normal.components[projection_plane] <= 0.0f;
+  const bool target_inverted  = target->normal.components[projection_plane] <= 0.0f;
+  const bool is_forward_plane = source_inverted == (ref->plane < 0);
+  const bool inverted         = is_forward_plane ? target_inverted : !target_inverted;
+
+  result->plane     = inverted ? (blam_index_long)((blam_ulong)plane_index | 0x80000000uL) : plane_index;
+  result->root_node = ref->root_node;
+  return true;
+}
+
+bool repair_visit_leaf(
+  const collision_bsp      *const bsp,
+  collision_bsp_accel      *const accel,
+  struct accel_build_state *const state,
+  const blam_index_long           leaf_index,
+  const blam_index_long    *const path,
+  const int                *const sides,
+  const blam_long                 depth)
+{
+  const struct blam_bsp3d_node      *const nodes      = BLAM_TAG_BLOCK_BASE(bsp, nodes, bsp3d_nodes);
+  const blam_plane3d                *const planes     = BLAM_TAG_BLOCK_BASE(bsp, planes, planes);
+  const struct blam_bsp2d_reference *const references = BLAM_TAG_BLOCK_BASE(&bsp->bsp2d, references, references);
+  const struct blam_bsp3d_leaf      *const leaf       = BLAM_TAG_BLOCK_GET(bsp, leaf, leaves, leaf_index);
+
+  repair *const fix = &accel->repair;
+  struct blam_bsp3d_leaf *const repaired_leaf = BLAM_TAG_BLOCK_GET(&fix->bsp, repaired_leaf, leaves, leaf_index);
+  struct blam_tag_block  *const repaired_references = &fix->bsp.bsp2d.references;
+
+  for (blam_long i = depth - 1; i >= 0; --i)
+  {
+    const blam_index_long plane_index = nodes[path[i]].plane;
+
+    // Only the deepest split on each plane is considered. The face must have BSP 
+    // exterior on its other side, and be missing a reference.
+    bool deeper = false;
+    for (blam_long j = i + 1; j < depth && !deeper; ++j)
+      deeper = nodes[path[j]].plane == plane_index;
+    if (deeper)
+      continue;
+
+    const blam_index_long other_child = nodes[path[i]].children[1 - sides[i]];
+    const bool exterior = other_child == -1
+      || (other_child >= 0 && other_child < bsp->bsp3d_nodes.count && state->node_exterior[other_child]);
+    if (!exterior || collision_bsp_leaf_reference(bsp, leaf_index, plane_index) != -1)
+      continue;
+
+    // Skip planes the leaf does not actually border.
+    const enum blam_projection_plane projection_plane = blam_real3d_projection_plane(&planes[plane_index].normal);
+    struct accel_polygon face;
+    if (!accel_leaf_face(bsp, state, path, sides, depth, plane_index, blam_projection_plane_indices(projection_plane, true), &face)
+      || face.count == 0)
+      continue;
+
+    struct blam_bsp2d_reference synthesized;
+    bool found = false;
+
+    // Form 1: the leaf's own reference for a nearly-coplanar plane up its path.
+    for (blam_long j = depth - 1; j > 0 && !found; --j)
+    {
+      const blam_index_long candidate_plane = nodes[path[j]].plane;
+      if (candidate_plane == plane_index
+        || !accel_test_nearly_coplanar(&accel->plane_classes, planes, plane_index, candidate_plane))
+        continue;
+
+      const blam_index_long reference_index = collision_bsp_leaf_reference(bsp, leaf_index, candidate_plane);
+      found = reference_index != -1
+        && repair_retarget_reference(planes, &references[reference_index], plane_index, &synthesized);
+    }
+
+    // Form 2: the reference of the leaf across the nearest nearly-coplanar split.
+    for (blam_long j = depth - 1; j >= 0 && !found; --j)
+    {
+      const struct blam_bsp3d_node *const node = &nodes[path[j]];
+      if (!accel_test_nearly_coplanar(&accel->plane_classes, planes, plane_index, node->plane))
+        continue;
+
+      const blam_index_long neighbour = node->children[1 - sides[j]];
+      if (neighbour < 0 && neighbour != -1)
+      {
+        const blam_index_long neighbour_index = blam_sanitize_long(neighbour);
+        blam_index_long reference_index = collision_bsp_leaf_reference(bsp, neighbour_index, node->plane);
+        if (reference_index == -1)
+          reference_index = collision_bsp_leaf_reference(bsp, neighbour_index, plane_index);
+
+        found = reference_index != -1
+          && repair_retarget_reference(planes, &references[reference_index], plane_index, &synthesized);
+      }
+      break;
+    }
+
+    if (!found || repaired_leaf->reference_count == INT16_MAX)
+      continue;
+
+    // Move the leaf's references to the end, where it can grow.
+    if (repaired_leaf->first_reference + repaired_leaf->reference_count != repaired_references->count)
+    {
+      repaired_leaf->first_reference = repaired_references->count;
+      for (blam_long j = 0; j < leaf->reference_count; ++j)
+      {
+        if (!accel_array_reserve(&repaired_references->address, &state->reference_capacity, repaired_references->count, sizeof(synthesized)))
+          return false;
+        ((struct blam_bsp2d_reference *)repaired_references->address)[repaired_references->count++] = references[leaf->first_reference + j];
+      }
+    }
+
+    if (!accel_array_reserve(&repaired_references->address, &state->reference_capacity, repaired_references->count, sizeof(synthesized)))
+      return false;
+    ((struct blam_bsp2d_reference *)repaired_references->address)[repaired_references->count++] = synthesized;
+    ++repaired_leaf->reference_count;
+    ++fix->synthesized_count;
+  }
+
+  return true;
+}
+
+bool repair_build(
+  const collision_bsp      *const bsp,
+  collision_bsp_accel      *const accel,
+  struct accel_build_state *const state)
+{
+  repair *const fix = &accel->repair;
+
+  fix->bsp = *bsp;
+  fix->bsp.leaves.address            = NULL;
+  fix->bsp.bsp2d.references.address  = NULL;
+  fix->synthesized_count             = 0;
+
+  const blam_long leaf_count      = bsp->leaves.count;
+  const blam_long reference_count = bsp->bsp2d.references.count;
+  const blam_long node_count      = bsp->bsp3d_nodes.count;
+
+  fix->bsp.leaves.address           = malloc((leaf_count + 1) * sizeof(struct blam_bsp3d_leaf));
+  fix->bsp.bsp2d.references.address = malloc((reference_count + 1) * sizeof(struct blam_bsp2d_reference));
+  state->reference_capacity         = reference_count + 1;
+  state->node_exterior              = malloc(node_count + 1);
+
+  bool success = fix->bsp.leaves.address != NULL
+    && fix->bsp.bsp2d.references.address != NULL
+    && state->node_exterior != NULL;
+
+  if (success)
+  {
+    memcpy(fix->bsp.leaves.address, bsp->leaves.address, leaf_count * sizeof(struct blam_bsp3d_leaf));
+    memcpy(fix->bsp.bsp2d.references.address, bsp->bsp2d.references.address, reference_count * sizeof(struct blam_bsp2d_reference));
+
+    success = (node_count == 0 || repair_mark_exterior(bsp, state->node_exterior))
+      && accel_walk_leaves(bsp, accel, state, repair_visit_leaf);
+  }
+
+  free(state->node_exterior);
+  state->node_exterior = NULL;
+
+  return success;
+}
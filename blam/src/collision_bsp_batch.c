@@ -0,0 +1,375 @@
+#include "blam/collision_bsp_batch.h"
+
+#include <stdbool.h>
+
+#include <stdlib.h>
+#include <assert.h>
+
+#ifdef BLAM_THREADS
+# include <pthread.h>
+# include <stdatomic.h>
+#endif // BLAM_THREADS
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+/**
+ * \brief The number of queries a thread takes from a share at a time.
+ */
+#define BATCH_BLOCK_SIZE 0x40
+
+#ifdef BLAM_THREADS
+typedef _Atomic blam_long batch_cursor;
+#else
+typedef blam_long batch_cursor;
+#endif // BLAM_THREADS
+
+/**
+ * \brief A contiguous range of the queries of a batch.
+ *
+ * Every thread takes queries from the front of a share, its own first.
+ */
+struct batch_share
+{
+  _Alignas(64) batch_cursor next; ///< The index of the next query to take.
+  blam_long                 end;  ///< One past the index of the last query.
+};
+
+/**
+ * \brief Manages the state shared by the threads running a batch.
+ */
+struct batch
+{
+  const struct blam_collision_bsp_config       *config;
+  const struct blam_collision_bsp              *bsp;
+  struct blam_bit_vector                        breakable_surfaces;
+  const struct blam_collision_bsp_batch_query  *queries;
+  struct blam_collision_bsp_test_vector_result *results;
+  blam_bool                                    *hits;
+  
+  blam_long          share_count;                                 ///< The number of #shares.
+  struct batch_share shares[BLAM_COLLISION_BSP_BATCH_MAX_THREADS]; ///< The share of each thread.
+};
+
+/**
+ * \brief A thread running batches.
+ */
+struct batch_worker
+{
+  struct blam_collision_bsp_batch_pool *pool;      ///< The pool of the thread.
+  blam_long                             index;     ///< The index of the share the
+                                                   ///< thread starts with.
+  blam_long                             hit_count; ///< The number of queries of the
+                                                   ///< current batch run that 
+                                                   ///< intersected a surface.
+#ifdef BLAM_THREADS
+  pthread_t                             thread;    ///< The thread.
+#endif // BLAM_THREADS
+};
+
+/**
+ * \brief The worker threads batches run on.
+ *
+ * Worker 0 is the thread submitting a batch; the others are started with the pool.
+ */
+struct blam_collision_bsp_batch_pool
+{
+  blam_long     thread_count; ///< The number of #workers.
+  struct batch *batch;        ///< The batch being run, or `NULL`.
+  
+#ifdef BLAM_THREADS
+  pthread_mutex_t mutex;        ///< Guards the members below.
+  pthread_cond_t  submitted;    ///< Signaled when a batch is submitted, or the 
+                                ///< pool is stopping.
+  pthread_cond_t  finished;     ///< Signaled when the last worker finishes a batch.
+  blam_long       generation;   ///< The number of batches submitted.
+  blam_long       active_count; ///< The number of workers still running the batch.
+  bool            stopping;     ///< `true` if the workers are to exit.
+#endif // BLAM_THREADS
+  
+  struct batch_worker workers[BLAM_COLLISION_BSP_BATCH_MAX_THREADS];
+};
+
+/**
+ * \brief Takes queries from a share.
+ *
+ * \param [in,out] cursor The cursor of the share.
+ * \param [in]     count  The number of queries to take.
+ *
+ * \return The index of the first query taken.
+ */
+static inline
+blam_long batch_cursor_take(
+  batch_cursor *cursor,
+  blam_long     count);
+
+/**
+ * \brief Runs queries of a batch until there are none left, starting with a share.
+ *
+ * \param [in]     batch  The batch.
+ * \param [in,out] worker The worker, which receives the number of queries that 
+ *                        intersected a surface.
+ */
+static
+void batch_run(
+  struct batch        *batch,
+  struct batch_worker *worker);
+
+#ifdef BLAM_THREADS
+/**
+ * \brief The entry point of a worker thread, which runs batches until its pool 
+ *        stops.
+ *
+ * \param [in,out] worker The `struct batch_worker` of the thread.
+ */
+static
+void *batch_thread(
+  void *worker);
+#endif // BLAM_THREADS
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+struct blam_collision_bsp_batch_pool *blam_collision_bsp_batch_pool_create(blam_long thread_count)
+{
+  struct blam_collision_bsp_batch_pool *const pool = calloc(1, sizeof(*pool));
+  if (pool == NULL)
+    return NULL;
+  
+#ifdef BLAM_THREADS
+  if (thread_count > BLAM_COLLISION_BSP_BATCH_MAX_THREADS)
+    thread_count = BLAM_COLLISION_BSP_BATCH_MAX_THREADS;
+  if (thread_count < 1)
+    thread_count = 1;
+  
+  if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+  {
+    free(pool);
+    return NULL;
+  }
+  
+  if (pthread_cond_init(&pool->submitted, NULL) != 0)
+  {
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    return NULL;
+  }
+  
+  if (pthread_cond_init(&pool->finished, NULL) != 0)
+  {
+    pthread_cond_destroy(&pool->submitted);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    return NULL;
+  }
+#else
+  (void)thread_count;
+#endif // BLAM_THREADS
+  
+  pool->workers[0].pool  = pool;
+  pool->workers[0].index = 0;
+  pool->thread_count     = 1;
+  
+#ifdef BLAM_THREADS
+  // Workers are numbered in the order they start, so that the pool runs on those
+  // that did if some cannot be.
+  for (blam_long i = 1; i < thread_count; ++i)
+  {
+    struct batch_worker *const worker = &pool->workers[pool->thread_count];
+    worker->pool  = pool;
+    worker->index = pool->thread_count;
+    
+    if (pthread_create(&worker->thread, NULL, batch_thread, worker) != 0)
+      break;
+    
+    ++pool->thread_count;
+  }
+#endif // BLAM_THREADS
+  
+  return pool;
+}
+
+void blam_collision_bsp_batch_pool_destroy(struct blam_collision_bsp_batch_pool *const pool)
+{
+  if (pool == NULL)
+    return;
+  
+#ifdef BLAM_THREADS
+  pthread_mutex_lock(&pool->mutex);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->submitted);
+  pthread_mutex_unlock(&pool->mutex);
+  
+  for (blam_long i = 1; i < pool->thread_count; ++i)
+    pthread_join(pool->workers[i].thread, NULL);
+  
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->submitted);
+  pthread_mutex_destroy(&pool->mutex);
+#endif // BLAM_THREADS
+  
+  free(pool);
+}
+
+blam_long blam_collision_bsp_batch_pool_thread_count(const struct blam_collision_bsp_batch_pool *const pool)
+{
+  assert(pool);
+  
+  return pool->thread_count;
+}
+
+blam_long blam_collision_bsp_test_vector_batch(
+  struct blam_collision_bsp_batch_pool *const         pool,
+  const struct blam_collision_bsp_config *const       config,
+  const struct blam_collision_bsp *const              bsp,
+  const struct blam_bit_vector                        breakable_surfaces,
+  const struct blam_collision_bsp_batch_query *const  queries,
+  const blam_long                                     count,
+  struct blam_collision_bsp_test_vector_result *const results,
+  blam_bool *const                                    hits)
+{
+  assert(pool == NULL || config == NULL || config->budget == NULL);
+  assert(bsp);
+  assert(queries || count <= 0);
+  
+  if (count <= 0)
+    return 0;
+  
+  // A share is not worth making for less than a block of queries. Workers without
+  // a share of their own still take from the others.
+  const blam_long block_count  = (count + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+  const blam_long thread_count = pool != NULL ? pool->thread_count : 1;
+  const blam_long share_count  = thread_count < block_count ? thread_count : block_count;
+  
+  struct batch batch;
+  batch.config             = config;
+  batch.bsp                = bsp;
+  batch.breakable_surfaces = breakable_surfaces;
+  batch.queries            = queries;
+  batch.results            = results;
+  batch.hits               = hits;
+  batch.share_count        = share_count;
+  
+  for (blam_long i = 0; i < share_count; ++i)
+  {
+    batch.shares[i].next = (blam_long)((int64_t)count * i / share_count);
+    batch.shares[i].end  = (blam_long)((int64_t)count * (i + 1) / share_count);
+  }
+  
+  if (pool == NULL)
+  {
+    struct batch_worker worker = { .pool = NULL, .index = 0, .hit_count = 0 };
+    batch_run(&batch, &worker);
+    return worker.hit_count;
+  }
+  
+  for (blam_long i = 0; i < thread_count; ++i)
+    pool->workers[i].hit_count = 0;
+  
+#ifdef BLAM_THREADS
+  if (thread_count > 1)
+  {
+    pthread_mutex_lock(&pool->mutex);
+    pool->batch        = &batch;
+    pool->active_count = thread_count - 1;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->submitted);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+#endif // BLAM_THREADS
+  
+  batch_run(&batch, &pool->workers[0]);
+  
+#ifdef BLAM_THREADS
+  if (thread_count > 1)
+  {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->active_count > 0)
+      pthread_cond_wait(&pool->finished, &pool->mutex);
+    pool->batch = NULL;
+    pthread_mutex_unlock(&pool->mutex);
+  }
+#endif // BLAM_THREADS
+  
+  blam_long hit_count = 0;
+  for (blam_long i = 0; i < thread_count; ++i)
+    hit_count += pool->workers[i].hit_count;
+  
+  return hit_count;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+blam_long batch_cursor_take(
+  batch_cursor *const cursor,
+  const blam_long     count)
+{
+#ifdef BLAM_THREADS
+  return atomic_fetch_add_explicit(cursor, count, memory_order_relaxed);
+#else
+  const blam_long next = *cursor;
+  *cursor += count;
+  return next;
+#endif // BLAM_THREADS
+}
+
+void batch_run(
+  struct batch *const        batch,
+  struct batch_worker *const worker)
+{
+  for (blam_long i = 0; i < batch->share_count; ++i)
+  {
+    struct batch_share *const share = &batch->shares[(worker->index + i) % batch->share_count];
+    for (;;)
+    {
+      const blam_long first = batch_cursor_take(&share->next, BATCH_BLOCK_SIZE);
+      if (first >= share->end)
+        break;
+      
+      const blam_long last = share->end - first < BATCH_BLOCK_SIZE ? share->end : first + BATCH_BLOCK_SIZE;
+      worker->hit_count += blam_collision_bsp_test_vector_interleaved(
+        batch->config,
+        batch->bsp,
+        batch->breakable_surfaces,
+        &batch->queries[first],
+        last - first,
+        batch->results != NULL ? &batch->results[first] : NULL,
+        batch->hits != NULL ? &batch->hits[first] : NULL);
+    }
+  }
+}
+
+#ifdef BLAM_THREADS
+void *batch_thread(
+  void *const argument)
+{
+  struct batch_worker *const worker = argument;
+  struct blam_collision_bsp_batch_pool *const pool = worker->pool;
+  
+  // No batch is submitted before the pool is created, so a worker that starts 
+  // late still runs the first one.
+  pthread_mutex_lock(&pool->mutex);
+  for (blam_long generation = 0; ; )
+  {
+    while (!pool->stopping && pool->generation == generation)
+      pthread_cond_wait(&pool->submitted, &pool->mutex);
+    
+    if (pool->stopping)
+      break;
+    
+    generation = pool->generation;
+    struct batch *const batch = pool->batch;
+    pthread_mutex_unlock(&pool->mutex);
+    
+    batch_run(batch, worker);
+    
+    pthread_mutex_lock(&pool->mutex);
+    if (--pool->active_count == 0)
+      pthread_cond_signal(&pool->finished);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  
+  return NULL;
+}
+#endif // BLAM_THREADS
@@ -0,0 +1,196 @@
+#include "blam/collision_bsp_cache.h"
+#include "blam/collision_bsp_accel.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+typedef struct blam_collision_bsp_cache       collision_bsp_cache;
+typedef struct blam_collision_bsp_cache_entry collision_bsp_cache_entry;
+typedef struct blam_collision_bsp_test_vector_result test_vector_result;
+
+/**
+ * \brief Fills the key of a test.
+ *
+ * Components are keyed by their bits, so that only bit-identical tests share a
+ * key. Only the flags that affect BSP tests are keyed.
+ */
+static
+void cache_key_make(
+  blam_ulong         key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE],
+  blam_ulong         breakable_generation,
+  const blam_real3d *origin,
+  const blam_real3d *delta,
+  blam_real          max_scale,
+  blam_flags_long    flags);
+
+/**
+ * \brief Returns the slot of the entry for a test.
+ */
+static
+blam_long cache_key_slot(
+  const collision_bsp_cache       *cache,
+  const struct blam_collision_bsp *bsp,
+  const blam_ulong                 key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE]);
+
+/**
+ * \brief Copies the part of a result written by a test.
+ *
+ * The plane and surface are only written by tests that intersected a surface, and
+ * only the leaves visited are copied.
+ */
+static
+void cache_result_copy(
+  test_vector_result       *destination,
+  const test_vector_result *source,
+  blam_bool                 hit);
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+bool blam_collision_bsp_cache_create(
+  collision_bsp_cache *const cache,
+  const blam_long            memory_size)
+{
+  assert(cache);
+
+  memset(cache, 0, sizeof(*cache));
+
+  const blam_long entry_size = (blam_long)sizeof(collision_bsp_cache_entry);
+  if (memory_size < entry_size)
+    return false;
+
+  blam_long capacity = 1;
+  while (capacity <= memory_size / entry_size / 2)
+    capacity *= 2;
+
+  cache->entries = calloc(capacity, sizeof(*cache->entries));
+  if (cache->entries == NULL)
+    return false;
+
+  cache->capacity          = capacity;
+  cache->stats.capacity    = capacity;
+  cache->stats.memory_size = capacity * entry_size;
+  return true;
+}
+
+void blam_collision_bsp_cache_destroy(collision_bsp_cache *const cache)
+{
+  assert(cache);
+
+  free(cache->entries);
+  memset(cache, 0, sizeof(*cache));
+}
+
+void blam_collision_bsp_cache_begin_tick(collision_bsp_cache *const cache)
+{
+  assert(cache);
+
+  // Entries of earlier ticks are left in place, and never match again.
+  ++cache->tick;
+  ++cache->stats.tick_count;
+}
+
+blam_bool blam_collision_bsp_test_vector_cached(
+  collision_bsp_cache *const             cache,
+  const struct blam_collision_bsp *const bsp,
+  const struct blam_bit_vector           breakable_surfaces,
+  const blam_ulong                       breakable_generation,
+  const blam_real3d *const               origin,
+  const blam_real3d *const               delta,
+  const blam_real                        max_scale,
+  const blam_flags_long                  flags, // enum blam_collision_test_flags
+  test_vector_result *const              data)
+{
+  assert(cache);
+  assert(cache->entries);
+  assert(bsp);
+  assert(origin);
+  assert(delta);
+  assert(data);
+
+  // Tests against a BSP without breakable surfaces do not depend on their state.
+  const struct blam_collision_bsp_accel *const accel = blam_collision_bsp_accel_find(bsp);
+  const bool has_breakables = accel == NULL || accel->breakables.surface_count > 0;
+  
+  blam_ulong key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE];
+  cache_key_make(key, has_breakables ? breakable_generation : 0, origin, delta, max_scale, flags);
+
+  collision_bsp_cache_entry *const entry = &cache->entries[cache_key_slot(cache, bsp, key)];
+  const bool current = entry->bsp != NULL && entry->tick == cache->tick;
+
+  ++cache->stats.lookup_count;
+  if (current && entry->bsp == bsp && memcmp(entry->key, key, sizeof(key)) == 0)
+  {
+    ++cache->stats.hit_count;
+    cache_result_copy(data, &entry->result, entry->hit);
+    return entry->hit;
+  }
+
+  const blam_bool hit = blam_collision_bsp_test_vector(bsp, breakable_surfaces, origin, delta, max_scale, flags, data);
+
+  if (current)
+    ++cache->stats.eviction_count;
+
+  entry->bsp  = bsp;
+  entry->tick = cache->tick;
+  entry->hit  = hit;
+  memcpy(entry->key, key, sizeof(key));
+  cache_result_copy(&entry->result, data, hit);
+
+  return hit;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+void cache_key_make(
+  blam_ulong               key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE],
+  const blam_ulong         breakable_generation,
+  const blam_real3d *const origin,
+  const blam_real3d *const delta,
+  const blam_real          max_scale,
+  const blam_flags_long    flags)
+{
+  memcpy(&key[0], origin->components, sizeof(origin->components));
+  memcpy(&key[3], delta->components,  sizeof(delta->components));
+  memcpy(&key[6], &max_scale,         sizeof(max_scale));
+  key[7] = flags & k_collision_test_bsp_bits;
+  key[8] = breakable_generation;
+}
+
+blam_long cache_key_slot(
+  const collision_bsp_cache *const       cache,
+  const struct blam_collision_bsp *const bsp,
+  const blam_ulong                       key[BLAM_COLLISION_BSP_CACHE_KEY_SIZE])
+{
+  uint32_t hash = (uint32_t)(uintptr_t)bsp;
+  for (int i = 0; i < BLAM_COLLISION_BSP_CACHE_KEY_SIZE; ++i)
+    hash = (hash ^ key[i]) * UINT32_C(0x9E3779B1);
+  hash ^= hash >> 16;
+
+  return (blam_long)(hash & (uint32_t)(cache->capacity - 1));
+}
+
+void cache_result_copy(
+  test_vector_result *const       destination,
+  const test_vector_result *const source,
+  const blam_bool                 hit)
+{
+  destination->fraction = source->fraction;
+  if (hit)
+  {
+    destination->last_split = source->last_split;
+    destination->surface    = source->surface;
+  }
+
+  const blam_long count = source->leaves.count < 0x100 ? source->leaves.count : 0x100;
+  destination->leaves.count = source->leaves.count;
+  memcpy(destination->leaves.stack, source->leaves.stack, count * sizeof(source->leaves.stack[0]));
+}
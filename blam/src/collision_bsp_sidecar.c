@@ -0,0 +1,727 @@
+#include "blam/collision_bsp_sidecar.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif // _WIN32
+
+#include "blam/tag.h"
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+typedef struct blam_collision_bsp              collision_bsp;
+typedef struct blam_collision_bsp_accel        collision_bsp_accel;
+typedef struct blam_collision_bsp_leak_table   leak_table;
+typedef struct blam_collision_bsp_leaf_bounds  leaf_bounds;
+typedef struct blam_collision_bsp_content_hash content_hash;
+
+/**
+ * \brief The first word of a sidecar file; `bsc1` read in little-endian order.
+ */
+#define SIDECAR_MAGIC 0x31637362
+
+/**
+ * \brief A word written in native byte order, to reject sidecars of another.
+ */
+#define SIDECAR_BYTE_ORDER 0x01020304
+
+/**
+ * \brief The alignment of each table in a sidecar file.
+ */
+#define SIDECAR_ALIGNMENT 0x10
+
+/**
+ * \brief The maximum number of characters of a sidecar path, with its terminator.
+ */
+#define SIDECAR_MAX_PATH 0x200
+
+/**
+ * \brief The number of bits in each word of a bit set.
+ */
+#define SIDECAR_WORD_BITS ((blam_long)(CHAR_BIT * sizeof(blam_ulong)))
+
+#define SIDECAR_HASH_PRIME_1 UINT64_C(0x9E3779B185EBCA87)
+#define SIDECAR_HASH_PRIME_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define SIDECAR_HASH_PRIME_3 UINT64_C(0x165667B19E3779F9)
+
+/**
+ * \brief The tables of acceleration data, in the order they are stored.
+ */
+enum sidecar_table
+{
+  k_sidecar_table_plane_classes,
+  k_sidecar_table_covered_leaves,
+  k_sidecar_table_leak_entries,
+  k_sidecar_table_leak_candidates,
+  k_sidecar_table_leak_buckets,
+  k_sidecar_table_certified_references,
+  k_sidecar_table_content_bounds,
+  k_sidecar_table_leaf_bound_ranges,
+  k_sidecar_table_leaf_bounds,
+  k_sidecar_table_breakable_surfaces,
+  k_sidecar_table_repair_leaves,
+  k_sidecar_table_repair_references,
+
+  k_sidecar_table_count
+};
+
+/**
+ * \brief The header of a sidecar file.
+ *
+ * The counts are those of the tables of `struct blam_collision_bsp_accel`.
+ */
+struct sidecar_header
+{
+  blam_ulong      magic;      ///< #SIDECAR_MAGIC.
+  blam_ulong      version;    ///< #BLAM_COLLISION_BSP_SIDECAR_VERSION.
+  blam_ulong      byte_order; ///< #SIDECAR_BYTE_ORDER.
+  blam_ulong      size;       ///< The size of the file, in bytes.
+  content_hash    hash;       ///< The content hash of the BSP.
+  blam_flags_long flags;      ///< See `enum blam_collision_bsp_accel_flags`.
+
+  blam_long plane_count;
+  blam_long leaf_count;
+  blam_long entry_count;
+  blam_long candidate_count;
+  blam_long bucket_count;
+  blam_long reference_count;
+  blam_long node_count;
+  blam_long bound_count;
+  blam_long breakable_count;
+  blam_long breakable_state_count;
+  blam_long repair_leaf_count;
+  blam_long repair_reference_count;
+  blam_long synthesized_count;
+
+  struct
+  {
+    blam_ulong offset; ///< The offset of the table from the start of the file.
+    blam_ulong size;   ///< The size of the table, in bytes.
+  } tables[k_sidecar_table_count];
+}; BLAM_ASSERT_SIZE(struct sidecar_header, 0xB0);
+
+/**
+ * \brief Hashes bytes.
+ *
+ * Four lanes of 8 bytes are mixed independently, so that consecutive multiplies
+ * do not wait on each other.
+ */
+static
+uint64_t sidecar_hash_bytes(const void *data, size_t size, uint64_t seed);
+
+/**
+ * \brief Mixes a word into a hash lane.
+ */
+static inline
+uint64_t sidecar_hash_round(uint64_t lane, uint64_t word);
+
+/**
+ * \brief Gets the table addresses of acceleration data, and their sizes from its
+ *        counts.
+ *
+ * \param [in]  accel     The acceleration data; only its counts need to be set.
+ * \param [out] addresses Receives the address of each table pointer.
+ * \param [out] sizes     Receives the size of each table, in bytes.
+ */
+static
+void sidecar_tables(
+  collision_bsp_accel *accel,
+  void               **addresses[k_sidecar_table_count],
+  uint64_t             sizes[k_sidecar_table_count]);
+
+/**
+ * \brief Tests if every index within mapped acceleration data is valid for its BSP.
+ *
+ * Queries trust the indices within acceleration data, so that they are not tested
+ * on every access, and the content hash does not cover the sidecar itself. A 
+ * damaged sidecar must then be rejected here, rather than be read out of bounds.
+ *
+ * \param [in] bsp   The collision BSP.
+ * \param [in] accel The acceleration data, with its tables in place.
+ */
+static
+bool sidecar_validate(const collision_bsp *bsp, const collision_bsp_accel *accel);
+
+/**
+ * \brief Returns the identifier of the current process.
+ */
+static
+unsigned long sidecar_process_id(void);
+
+/**
+ * \brief Replaces a file with another, atomically where the platform allows.
+ *
+ * \param [in] source The path of the file to move.
+ * \param [in] target The path of the file to replace.
+ *
+ * \return `true` on success, otherwise `false`.
+ */
+static
+bool sidecar_replace_file(const char *source, const char *target);
+
+/**
+ * \brief Maps a file read-only.
+ *
+ * \param [in]  path The path of the file.
+ * \param [out] size Receives the size of the file, in bytes.
+ *
+ * \return The address of the mapping, or `NULL` if the file could not be mapped.
+ */
+static
+const void *sidecar_map_file(const char *path, blam_long *size);
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+void blam_collision_bsp_hash_content(
+  const collision_bsp *const bsp,
+  content_hash *const        hash)
+{
+  assert(bsp);
+  assert(hash);
+
+  const struct
+  {
+    const struct blam_tag_block *block;
+    size_t                       element_size;
+  } blocks[] = {
+    { &bsp->bsp3d_nodes,      sizeof(struct blam_bsp3d_node)       },
+    { &bsp->planes,           sizeof(blam_plane3d)                 },
+    { &bsp->leaves,           sizeof(struct blam_bsp3d_leaf)       },
+    { &bsp->bsp2d.references, sizeof(struct blam_bsp2d_reference)  },
+    { &bsp->bsp2d.nodes,      sizeof(struct blam_bsp2d_node)       },
+    { &bsp->surfaces,         sizeof(struct blam_collision_surface) },
+    { &bsp->edges,            sizeof(struct blam_collision_edge)   },
+    { &bsp->vertices,         sizeof(struct blam_collision_vertex) }
+  };
+
+  // Each block is hashed with its own seed, so that moving elements from one block
+  // to the next changes the hash.
+  uint64_t result = SIDECAR_HASH_PRIME_3;
+  for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i)
+  {
+    const blam_long count = blocks[i].block->count > 0 ? blocks[i].block->count : 0;
+    result = sidecar_hash_round(result, (uint64_t)count);
+    result = sidecar_hash_round(result, sidecar_hash_bytes(blocks[i].block->address, count * blocks[i].element_size, i));
+  }
+
+  hash->words[0] = (blam_ulong)result;
+  hash->words[1] = (blam_ulong)(result >> 32);
+}
+
+void blam_collision_bsp_sidecar_name(
+  const content_hash *const hash,
+  const blam_flags_long     flags,
+  char                      name[BLAM_COLLISION_BSP_SIDECAR_NAME_SIZE])
+{
+  assert(hash);
+  assert(name);
+
+  snprintf(name, BLAM_COLLISION_BSP_SIDECAR_NAME_SIZE, "%08lx%08lx-%08lx.bsc",
+    (unsigned long)hash->words[1], (unsigned long)hash->words[0], (unsigned long)flags);
+}
+
+blam_bool blam_collision_bsp_sidecar_write(
+  const collision_bsp_accel *const accel,
+  const content_hash *const        hash,
+  const char *const                path)
+{
+  assert(accel);
+  assert(hash);
+  assert(path);
+
+  struct sidecar_header header = {
+    .magic                  = 0,
+    .version                = BLAM_COLLISION_BSP_SIDECAR_VERSION,
+    .byte_order             = SIDECAR_BYTE_ORDER,
+    .size                   = 0,
+    .hash                   = *hash,
+    .flags                  = accel->flags,
+    .plane_count            = accel->plane_classes.plane_count,
+    .leaf_count             = accel->leak_table.leaf_count,
+    .entry_count            = accel->leak_table.entry_count,
+    .candidate_count        = accel->leak_table.candidate_count,
+    .bucket_count           = accel->leak_table.bucket_count,
+    .reference_count        = accel->certification.reference_count,
+    .node_count             = accel->content_bounds.node_count,
+    .bound_count            = accel->leaf_bounds.bound_count,
+    .breakable_count        = accel->breakables.surface_count,
+    .breakable_state_count  = accel->breakables.state_count,
+    .repair_leaf_count      = accel->repair.bsp.leaves.count,
+    .repair_reference_count = accel->repair.bsp.bsp2d.references.count,
+    .synthesized_count      = accel->repair.synthesized_count
+  };
+
+  // The tables are only read through the addresses.
+  void   **addresses[k_sidecar_table_count];
+  uint64_t sizes[k_sidecar_table_count];
+  sidecar_tables((collision_bsp_accel *)accel, addresses, sizes);
+
+  // The sidecar is written beside the one it replaces and then moved over it, so
+  // that a sidecar mapped by another process is never written to.
+  char temporary_path[SIDECAR_MAX_PATH];
+  const int length = snprintf(temporary_path, sizeof(temporary_path), "%s.%lx.tmp", path, sidecar_process_id());
+  if (length < 0 || length >= (int)sizeof(temporary_path))
+    return false;
+
+  FILE *const file = fopen(temporary_path, "wb");
+  if (file == NULL)
+    return false;
+
+  // The header is written with a zero magic until every table is in place.
+  static const char padding[SIDECAR_ALIGNMENT] = { 0 };
+  bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  uint64_t offset = sizeof(header);
+  for (int i = 0; success && i < k_sidecar_table_count; ++i)
+  {
+    const uint64_t padding_size = (SIDECAR_ALIGNMENT - offset % SIDECAR_ALIGNMENT) % SIDECAR_ALIGNMENT;
+    success = fwrite(padding, 1, padding_size, file) == padding_size
+      && (sizes[i] == 0 || fwrite(*addresses[i], 1, sizes[i], file) == sizes[i]);
+
+    header.tables[i].offset = (blam_ulong)(offset + padding_size);
+    header.tables[i].size   = (blam_ulong)sizes[i];
+    offset += padding_size + sizes[i];
+    success = success && offset <= INT32_MAX;
+  }
+
+  header.magic = SIDECAR_MAGIC;
+  header.size  = (blam_ulong)offset;
+
+  success = success
+    && fseek(file, 0, SEEK_SET) == 0
+    && fwrite(&header, sizeof(header), 1, file) == 1;
+  success = fclose(file) == 0 && success;
+  success = success && sidecar_replace_file(temporary_path, path);
+
+  if (!success)
+    remove(temporary_path);
+
+  return success;
+}
+
+blam_bool blam_collision_bsp_sidecar_map(
+  const collision_bsp *const bsp,
+  const content_hash *const  hash,
+  const blam_flags_long      flags,
+  const char *const          path,
+  collision_bsp_accel *const accel)
+{
+  assert(bsp);
+  assert(hash);
+  assert(path);
+  assert(accel);
+
+  memset(accel, 0, sizeof(*accel));
+
+  blam_long size = 0;
+  const void *const mapping = sidecar_map_file(path, &size);
+  if (mapping == NULL)
+    return false;
+
+  const struct sidecar_header *const header = mapping;
+  bool success = size >= (blam_long)sizeof(*header)
+    && header->magic      == SIDECAR_MAGIC
+    && header->version    == BLAM_COLLISION_BSP_SIDECAR_VERSION
+    && header->byte_order == SIDECAR_BYTE_ORDER
+    && header->size       == (blam_ulong)size
+    && header->flags      == flags
+    && memcmp(&header->hash, hash, sizeof(*hash)) == 0;
+
+  // The hash covers the counts of the BSP, but the counts of the tables are checked
+  // against the file anyway, so that a damaged sidecar is never read past its end.
+  if (success)
+  {
+    accel->bsp   = bsp;
+    accel->flags = flags;
+
+    accel->plane_classes.plane_count     = header->plane_count;
+    accel->leak_table.leaf_count         = header->leaf_count;
+    accel->leak_table.entry_count        = header->entry_count;
+    accel->leak_table.candidate_count    = header->candidate_count;
+    accel->leak_table.bucket_count       = header->bucket_count;
+    accel->certification.reference_count = header->reference_count;
+    accel->content_bounds.node_count     = header->node_count;
+    accel->leaf_bounds.leaf_count        = header->leaf_count;
+    accel->leaf_bounds.bound_count       = header->bound_count;
+    accel->breakables.surface_count      = header->breakable_count;
+    accel->breakables.state_count        = header->breakable_state_count;
+
+    if (flags & k_collision_bsp_accel_repair_leaks)
+    {
+      accel->repair.bsp = *bsp;
+      accel->repair.bsp.leaves.count           = header->repair_leaf_count;
+      accel->repair.bsp.bsp2d.references.count = header->repair_reference_count;
+      accel->repair.synthesized_count          = header->synthesized_count;
+    }
+
+    const collision_bsp *const target = blam_collision_bsp_accel_target(accel);
+    success = header->plane_count == bsp->planes.count
+      && header->leaf_count == target->leaves.count
+      && header->reference_count == target->bsp2d.references.count
+      && header->node_count == target->bsp3d_nodes.count
+      && header->entry_count >= 0
+      && header->candidate_count >= 0
+      && header->bucket_count >= 0
+      && header->bound_count >= 0
+      && header->breakable_count >= 0;
+  }
+
+  void   **addresses[k_sidecar_table_count];
+  uint64_t sizes[k_sidecar_table_count];
+  if (success)
+    sidecar_tables(accel, addresses, sizes);
+
+  for (int i = 0; success && i < k_sidecar_table_count; ++i)
+  {
+    const uint64_t offset = header->tables[i].offset;
+    success = header->tables[i].size == sizes[i]
+      && offset % SIDECAR_ALIGNMENT == 0
+      && offset >= sizeof(*header)
+      && offset + sizes[i] <= (uint64_t)size;
+
+    if (success)
+      *addresses[i] = (void *)((const char *)mapping + offset);
+  }
+
+  success = success && sidecar_validate(bsp, accel);
+
+  if (!success)
+  {
+    blam_collision_bsp_sidecar_unmap(mapping, size);
+    memset(accel, 0, sizeof(*accel));
+    return false;
+  }
+
+  accel->mapping      = mapping;
+  accel->mapping_size = size;
+  return true;
+}
+
+void blam_collision_bsp_sidecar_unmap(const void *const mapping, const blam_long mapping_size)
+{
+  if (mapping == NULL)
+    return;
+
+#if defined(_WIN32)
+  (void)mapping_size;
+  UnmapViewOfFile(mapping);
+#else
+  munmap((void *)mapping, (size_t)mapping_size);
+#endif // _WIN32
+}
+
+blam_bool blam_collision_bsp_accel_load(
+  const collision_bsp *const bsp,
+  const blam_flags_long      flags,
+  const char *const          directory,
+  collision_bsp_accel *const accel)
+{
+  assert(bsp);
+  assert(accel);
+
+  if (directory == NULL)
+    return blam_collision_bsp_accel_build(bsp, flags, accel);
+
+  content_hash hash;
+  blam_collision_bsp_hash_content(bsp, &hash);
+
+  char name[BLAM_COLLISION_BSP_SIDECAR_NAME_SIZE];
+  blam_collision_bsp_sidecar_name(&hash, flags, name);
+
+  char path[SIDECAR_MAX_PATH];
+  const int length = snprintf(path, sizeof(path), "%s/%s", directory, name);
+  if (length < 0 || length >= (int)sizeof(path))
+    return blam_collision_bsp_accel_build(bsp, flags, accel);
+
+  if (blam_collision_bsp_sidecar_map(bsp, &hash, flags, path, accel))
+    return true;
+
+  if (!blam_collision_bsp_accel_build(bsp, flags, accel))
+    return false;
+
+  blam_collision_bsp_sidecar_write(accel, &hash, path);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+uint64_t sidecar_hash_round(uint64_t lane, const uint64_t word)
+{
+  lane += word * SIDECAR_HASH_PRIME_2;
+  lane  = (lane << 31) | (lane >> 33);
+  return lane * SIDECAR_HASH_PRIME_1;
+}
+
+uint64_t sidecar_hash_bytes(const void *const data, size_t size, const uint64_t seed)
+{
+  const unsigned char *bytes = data;
+  uint64_t result = seed + SIDECAR_HASH_PRIME_3 + size;
+
+  if (size >= 32)
+  {
+    uint64_t lanes[4] = {
+      seed + SIDECAR_HASH_PRIME_1 + SIDECAR_HASH_PRIME_2,
+      seed + SIDECAR_HASH_PRIME_2,
+      seed,
+      seed - SIDECAR_HASH_PRIME_1
+    };
+
+    for (; size >= 32; bytes += 32, size -= 32)
+    {
+      uint64_t words[4];
+      memcpy(words, bytes, sizeof(words));
+      for (int i = 0; i < 4; ++i)
+        lanes[i] = sidecar_hash_round(lanes[i], words[i]);
+    }
+
+    for (int i = 0; i < 4; ++i)
+      result = sidecar_hash_round(result, lanes[i]);
+  }
+
+  for (; size >= 8; bytes += 8, size -= 8)
+  {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    result = sidecar_hash_round(result, word);
+  }
+
+  for (; size > 0; ++bytes, --size)
+    result = sidecar_hash_round(result, *bytes);
+
+  result ^= result >> 33;
+  result *= SIDECAR_HASH_PRIME_2;
+  result ^= result >> 29;
+  result *= SIDECAR_HASH_PRIME_3;
+  result ^= result >> 32;
+  return result;
+}
+
+void sidecar_tables(
+  collision_bsp_accel *const accel,
+  void                     **addresses[k_sidecar_table_count],
+  uint64_t                   sizes[k_sidecar_table_count])
+{
+  // The spare element some tables are allocated with is not stored.
+  const bool repair = (accel->flags & k_collision_bsp_accel_repair_leaks) != 0;
+  const struct
+  {
+    void   **address;
+    uint64_t count;
+    size_t   element_size;
+  } tables[k_sidecar_table_count] = {
+    [k_sidecar_table_plane_classes]        = { (void **)&accel->plane_classes.classes,                 accel->plane_classes.plane_count,                               sizeof(*accel->plane_classes.classes)   },
+    [k_sidecar_table_covered_leaves]       = { (void **)&accel->leak_table.covered_leaves,             accel->leak_table.leaf_count / SIDECAR_WORD_BITS + 1,           sizeof(blam_ulong)                      },
+    [k_sidecar_table_leak_entries]         = { (void **)&accel->leak_table.entries,                    accel->leak_table.entry_count,                                  sizeof(*accel->leak_table.entries)      },
+    [k_sidecar_table_leak_candidates]      = { (void **)&accel->leak_table.candidates,                 accel->leak_table.candidate_count,                              sizeof(*accel->leak_table.candidates)   },
+    [k_sidecar_table_leak_buckets]         = { (void **)&accel->leak_table.buckets,                    accel->leak_table.bucket_count,                                 sizeof(*accel->leak_table.buckets)      },
+    [k_sidecar_table_certified_references] = { (void **)&accel->certification.certified_references,    accel->certification.reference_count / SIDECAR_WORD_BITS + 1,   sizeof(blam_ulong)                      },
+    [k_sidecar_table_content_bounds]       = { (void **)&accel->content_bounds.nodes,                  accel->content_bounds.node_count,                               sizeof(*accel->content_bounds.nodes)    },
+    [k_sidecar_table_leaf_bound_ranges]    = { (void **)&accel->leaf_bounds.ranges,                    accel->leaf_bounds.leaf_count,                                  sizeof(*accel->leaf_bounds.ranges)      },
+    [k_sidecar_table_leaf_bounds]          = { (void **)&accel->leaf_bounds.bounds,                    accel->leaf_bounds.bound_count,                                 sizeof(*accel->leaf_bounds.bounds)      },
+    [k_sidecar_table_breakable_surfaces]   = { (void **)&accel->breakables.surfaces,                   accel->breakables.surface_count,                                sizeof(*accel->breakables.surfaces)     },
+    [k_sidecar_table_repair_leaves]        = { &accel->repair.bsp.leaves.address,                      repair ? accel->repair.bsp.leaves.count : 0,                    sizeof(struct blam_bsp3d_leaf)          },
+    [k_sidecar_table_repair_references]    = { &accel->repair.bsp.bsp2d.references.address,            repair ? accel->repair.bsp.bsp2d.references.count : 0,          sizeof(struct blam_bsp2d_reference)     }
+  };
+
+  for (int i = 0; i < k_sidecar_table_count; ++i)
+  {
+    addresses[i] = tables[i].address;
+    sizes[i]     = tables[i].count * tables[i].element_size;
+  }
+}
+
+bool sidecar_validate(
+  const collision_bsp *const       bsp,
+  const collision_bsp_accel *const accel)
+{
+  const collision_bsp *const target = blam_collision_bsp_accel_target(accel);
+  const blam_long plane_count     = bsp->planes.count;
+  const blam_long leaf_count      = target->leaves.count;
+  const blam_long reference_count = target->bsp2d.references.count;
+
+  for (blam_long i = 0; i < accel->plane_classes.plane_count; ++i)
+  {
+    const blam_index_long plane_class = accel->plane_classes.classes[i];
+    if (plane_class < 0 || plane_class >= plane_count)
+      return false;
+  }
+
+  // Every candidate range must be within the candidates, and every lookup must
+  // end at an empty bucket.
+  const leak_table *const table = &accel->leak_table;
+  if (table->bucket_count != 0 && (table->bucket_count & (table->bucket_count - 1)) != 0)
+    return false;
+
+  for (blam_long i = 0; i < table->entry_count; ++i)
+  {
+    const struct blam_collision_bsp_leak_entry *const entry = &table->entries[i];
+    if (entry->leaf < 0 || entry->leaf >= leaf_count
+      || entry->plane < 0 || entry->plane >= plane_count
+      || entry->first_candidate < 0 || entry->candidate_count < 0
+      || entry->candidate_count > table->candidate_count - entry->first_candidate)
+      return false;
+  }
+
+  for (blam_long i = 0; i < table->candidate_count; ++i)
+  {
+    const struct blam_collision_bsp_leak_candidate *const candidate = &table->candidates[i];
+    if (candidate->plane < 0 || candidate->plane >= plane_count
+      || candidate->reference < 0 || candidate->reference >= reference_count)
+      return false;
+  }
+
+  bool empty_bucket = table->bucket_count == 0;
+  for (blam_long i = 0; i < table->bucket_count; ++i)
+  {
+    const blam_index_long entry_index = table->buckets[i];
+    if (entry_index < -1 || entry_index >= table->entry_count)
+      return false;
+    empty_bucket = empty_bucket || entry_index == -1;
+  }
+  if (!empty_bucket)
+    return false;
+
+  const leaf_bounds *const bounds = &accel->leaf_bounds;
+  for (blam_long i = 0; i < bounds->leaf_count; ++i)
+  {
+    const struct blam_collision_bsp_leaf_bound_range *const range = &bounds->ranges[i];
+    if (range->first < 0 || range->count < 0 || range->count > bounds->bound_count - range->first)
+      return false;
+  }
+
+  for (blam_long i = 0; i < bounds->bound_count; ++i)
+  {
+    const struct blam_collision_bsp_leaf_bound *const bound = &bounds->bounds[i];
+    if (bound->plane < 0 || bound->plane >= plane_count || (bound->side != 0 && bound->side != 1))
+      return false;
+  }
+
+  // The breakable surfaces are the same as would be derived, as caches rely on a
+  // BSP without any never reading the breakable surfaces state.
+  const struct blam_collision_surface *const surfaces = BLAM_TAG_BLOCK_BASE(bsp, surfaces, surfaces);
+  blam_long breakable_count = 0;
+  blam_long state_count     = 0;
+  for (blam_long i = 0; i < bsp->surfaces.count; ++i)
+  {
+    if ((surfaces[i].flags & 0x08) == 0) // breakable flag
+      continue;
+
+    if (breakable_count >= accel->breakables.surface_count || accel->breakables.surfaces[breakable_count] != i)
+      return false;
+
+    ++breakable_count;
+    if (surfaces[i].breakable_surface >= state_count)
+      state_count = surfaces[i].breakable_surface + 1;
+  }
+  if (breakable_count != accel->breakables.surface_count || state_count != accel->breakables.state_count)
+    return false;
+
+  if ((accel->flags & k_collision_bsp_accel_repair_leaks) == 0)
+    return true;
+
+  const struct blam_bsp3d_leaf *const leaves = BLAM_TAG_BLOCK_BASE(target, leaves, leaves);
+  for (blam_long i = 0; i < leaf_count; ++i)
+  {
+    if (leaves[i].first_reference < 0 || leaves[i].reference_count < 0
+      || leaves[i].reference_count > reference_count - leaves[i].first_reference)
+      return false;
+  }
+
+  const struct blam_bsp2d_reference *const references = BLAM_TAG_BLOCK_BASE(target, references, bsp2d.references);
+  for (blam_long i = 0; i < reference_count; ++i)
+  {
+    const blam_index_long plane_index = blam_sanitize_long(references[i].plane);
+    const blam_index_long root        = references[i].root_node;
+    const bool valid_root = root < 0
+      ? blam_sanitize_long_s(root) < bsp->surfaces.count
+      : root < bsp->bsp2d.nodes.count;
+    if (plane_index >= plane_count || !valid_root)
+      return false;
+  }
+
+  return true;
+}
+
+unsigned long sidecar_process_id(void)
+{
+#if defined(_WIN32)
+  return (unsigned long)GetCurrentProcessId();
+#else
+  return (unsigned long)getpid();
+#endif // _WIN32
+}
+
+bool sidecar_replace_file(const char *const source, const char *const target)
+{
+#if defined(_WIN32)
+  // Fails if the target is mapped, which leaves the mapped sidecar as it was.
+  return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  // Processes that mapped the target keep the file they mapped.
+  return rename(source, target) == 0;
+#endif // _WIN32
+}
+
+const void *sidecar_map_file(const char *const path, blam_long *const size)
+{
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  // The view keeps the file mapping open once both handles are closed.
+  const void *address = NULL;
+  LARGE_INTEGER file_size;
+  if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && file_size.QuadPart <= INT32_MAX)
+  {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+    {
+      address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+  }
+
+  CloseHandle(file);
+  if (address != NULL)
+    *size = (blam_long)file_size.QuadPart;
+
+  return address;
+#else
+  const int file = open(path, O_RDONLY);
+  if (file == -1)
+    return NULL;
+
+  // The mapping stays valid once the file is closed.
+  const void *address = NULL;
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0 && status.st_size <= INT32_MAX)
+  {
+    address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (address == MAP_FAILED)
+      address = NULL;
+  }
+
+  close(file);
+  if (address != NULL)
+    *size = (blam_long)status.st_size;
+
+  return address;
+#endif // _WIN32
+}
@@ -0,0 +1,758 @@
+#include "blam/math_batch.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define MATH_BATCH_X86
+# include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+// Each kernel operates on the vectors from `first` up to `count`, so that the
+// vectorized kernels can leave the vectors past the last whole register to the
+// scalar ones.
+//
+// The vectorized kernels perform the same operations in the same order as the
+// scalar ones, only several vectors at a time, and never contract a product and
+// sum, so their results are identical. This file is built with SSE2 math on x86,
+// as x87 math would carry the scalar intermediates in extended precision.
+
+/**
+ * \brief The implementation of each batch operation for an instruction set.
+ */
+struct math_batch_kernels
+{
+  enum blam_math_isa isa; ///< The instruction set.
+
+  void (*dot)(
+    const blam_real3d *u,
+    const struct blam_real3d_soa *v,
+    blam_long first,
+    blam_long count,
+    blam_real_highp *result);
+
+  void (*plane3d_test)(
+    const blam_plane3d *plane,
+    const struct blam_real3d_soa *v,
+    blam_long first,
+    blam_long count,
+    blam_real_highp *result);
+
+  void (*cross)(
+    const struct blam_real3d_soa *u,
+    const struct blam_real3d_soa *v,
+    blam_long first,
+    blam_long count,
+    const struct blam_real3d_soa *result);
+
+  void (*scalar_triple)(
+    const blam_real3d *u,
+    const struct blam_real3d_soa *v,
+    const struct blam_real3d_soa *w,
+    blam_long first,
+    blam_long count,
+    blam_real_highp *result);
+
+  void (*det)(
+    const struct blam_real2d_soa *u,
+    const struct blam_real2d_soa *v,
+    blam_long first,
+    blam_long count,
+    blam_real_highp *result);
+};
+
+/**
+ * \brief Returns the kernels in use, selecting the best ones on first use.
+ */
+static
+const struct math_batch_kernels *math_batch_kernels(void);
+
+/**
+ * \brief Returns `true` if the processor supports \a isa.
+ */
+static
+bool math_batch_isa_supported(enum blam_math_isa isa);
+
+static
+void math_batch_dot_scalar(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_plane3d_test_scalar(
+  const blam_plane3d *plane,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_cross_scalar(
+  const struct blam_real3d_soa *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  const struct blam_real3d_soa *result);
+
+static
+void math_batch_scalar_triple_scalar(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  const struct blam_real3d_soa *w,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_det_scalar(
+  const struct blam_real2d_soa *u,
+  const struct blam_real2d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static const struct math_batch_kernels math_batch_kernels_scalar =
+{
+  k_blam_math_isa_scalar,
+  math_batch_dot_scalar,
+  math_batch_plane3d_test_scalar,
+  math_batch_cross_scalar,
+  math_batch_scalar_triple_scalar,
+  math_batch_det_scalar,
+};
+
+#ifdef MATH_BATCH_X86
+static
+void math_batch_dot_sse2(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_plane3d_test_sse2(
+  const blam_plane3d *plane,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_cross_sse2(
+  const struct blam_real3d_soa *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  const struct blam_real3d_soa *result);
+
+static
+void math_batch_scalar_triple_sse2(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  const struct blam_real3d_soa *w,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_det_sse2(
+  const struct blam_real2d_soa *u,
+  const struct blam_real2d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_dot_avx2(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_plane3d_test_avx2(
+  const blam_plane3d *plane,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_cross_avx2(
+  const struct blam_real3d_soa *u,
+  const struct blam_real3d_soa *v,
+  blam_long first,
+  blam_long count,
+  const struct blam_real3d_soa *result);
+
+static
+void math_batch_scalar_triple_avx2(
+  const blam_real3d *u,
+  const struct blam_real3d_soa *v,
+  const struct blam_real3d_soa *w,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static
+void math_batch_det_avx2(
+  const struct blam_real2d_soa *u,
+  const struct blam_real2d_soa *v,
+  blam_long first,
+  blam_long count,
+  blam_real_highp *result);
+
+static const struct math_batch_kernels math_batch_kernels_sse2 =
+{
+  k_blam_math_isa_sse2,
+  math_batch_dot_sse2,
+  math_batch_plane3d_test_sse2,
+  math_batch_cross_sse2,
+  math_batch_scalar_triple_sse2,
+  math_batch_det_sse2,
+};
+
+static const struct math_batch_kernels math_batch_kernels_avx2 =
+{
+  k_blam_math_isa_avx2,
+  math_batch_dot_avx2,
+  math_batch_plane3d_test_avx2,
+  math_batch_cross_avx2,
+  math_batch_scalar_triple_avx2,
+  math_batch_det_avx2,
+};
+#endif // MATH_BATCH_X86
+
+/**
+ * \brief The kernels in use, or `NULL` if none were selected yet.
+ *
+ * Atomic, as the first batch operation of every thread may select the kernels.
+ */
+static _Atomic(const struct math_batch_kernels*) math_batch_selected = NULL;
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+enum blam_math_isa blam_math_batch_select(enum blam_math_isa isa)
+{
+  const struct math_batch_kernels *kernels;
+#ifdef MATH_BATCH_X86
+  if (isa >= k_blam_math_isa_avx2 && math_batch_isa_supported(k_blam_math_isa_avx2))
+    kernels = &math_batch_kernels_avx2;
+  else if (isa >= k_blam_math_isa_sse2 && math_batch_isa_supported(k_blam_math_isa_sse2))
+    kernels = &math_batch_kernels_sse2;
+  else
+    kernels = &math_batch_kernels_scalar;
+#else
+  (void)isa;
+  kernels = &math_batch_kernels_scalar;
+#endif // MATH_BATCH_X86
+
+  atomic_store_explicit(&math_batch_selected, kernels, memory_order_release);
+  return kernels->isa;
+}
+
+enum blam_math_isa blam_math_batch_isa(void)
+{
+  return math_batch_kernels()->isa;
+}
+
+void blam_real3d_dot_batch(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  assert(u);
+  assert(v);
+  assert(result || count <= 0);
+
+  if (count > 0)
+    math_batch_kernels()->dot(u, v, 0, count, result);
+}
+
+void blam_plane3d_test_batch(
+  const blam_plane3d *const           plane,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  assert(plane);
+  assert(v);
+  assert(result || count <= 0);
+
+  if (count > 0)
+    math_batch_kernels()->plane3d_test(plane, v, 0, count, result);
+}
+
+void blam_real3d_cross_batch(
+  const struct blam_real3d_soa *const u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     count,
+  const struct blam_real3d_soa *const result)
+{
+  assert(u);
+  assert(v);
+  assert(result);
+
+  if (count > 0)
+    math_batch_kernels()->cross(u, v, 0, count, result);
+}
+
+void blam_real3d_scalar_triple_batch(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const struct blam_real3d_soa *const w,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  assert(u);
+  assert(v);
+  assert(w);
+  assert(result || count <= 0);
+
+  if (count > 0)
+    math_batch_kernels()->scalar_triple(u, v, w, 0, count, result);
+}
+
+void blam_real2d_det_batch(
+  const struct blam_real2d_soa *const u,
+  const struct blam_real2d_soa *const v,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  assert(u);
+  assert(v);
+  assert(result || count <= 0);
+
+  if (count > 0)
+    math_batch_kernels()->det(u, v, 0, count, result);
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+static
+const struct math_batch_kernels *math_batch_kernels(void)
+{
+  // Every thread would select the same kernels, so it does not matter which of
+  // them stores its selection last.
+  const struct math_batch_kernels *kernels = atomic_load_explicit(&math_batch_selected, memory_order_acquire);
+  if (BLAM_UNLIKELY(!kernels))
+  {
+    blam_math_batch_select(k_blam_math_isa_avx2);
+    kernels = atomic_load_explicit(&math_batch_selected, memory_order_acquire);
+  }
+
+  return kernels;
+}
+
+static
+bool math_batch_isa_supported(const enum blam_math_isa isa)
+{
+  switch (isa)
+  {
+#ifdef MATH_BATCH_X86
+  case k_blam_math_isa_sse2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+  case k_blam_math_isa_avx2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif // MATH_BATCH_X86
+  case k_blam_math_isa_scalar:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// SCALAR KERNELS:
+
+static
+void math_batch_dot_scalar(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  for (blam_long i = first; i < count; ++i)
+  {
+    const blam_real3d vi = {{v->components[0][i], v->components[1][i], v->components[2][i]}};
+    result[i] = blam_real3d_dot(u, &vi);
+  }
+}
+
+static
+void math_batch_plane3d_test_scalar(
+  const blam_plane3d *const           plane,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  for (blam_long i = first; i < count; ++i)
+  {
+    const blam_real3d vi = {{v->components[0][i], v->components[1][i], v->components[2][i]}};
+    result[i] = blam_plane3d_test(plane, &vi);
+  }
+}
+
+static
+void math_batch_cross_scalar(
+  const struct blam_real3d_soa *const u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  const struct blam_real3d_soa *const result)
+{
+  for (blam_long i = first; i < count; ++i)
+  {
+    const blam_real3d ui = {{u->components[0][i], u->components[1][i], u->components[2][i]}};
+    const blam_real3d vi = {{v->components[0][i], v->components[1][i], v->components[2][i]}};
+    const blam_real3d cross = blam_real3d_cross(&ui, &vi);
+    result->components[0][i] = cross.components[0];
+    result->components[1][i] = cross.components[1];
+    result->components[2][i] = cross.components[2];
+  }
+}
+
+static
+void math_batch_scalar_triple_scalar(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const struct blam_real3d_soa *const w,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  for (blam_long i = first; i < count; ++i)
+  {
+    const blam_real3d vi = {{v->components[0][i], v->components[1][i], v->components[2][i]}};
+    const blam_real3d wi = {{w->components[0][i], w->components[1][i], w->components[2][i]}};
+    result[i] = blam_real3d_scalar_triple(u, &vi, &wi);
+  }
+}
+
+static
+void math_batch_det_scalar(
+  const struct blam_real2d_soa *const u,
+  const struct blam_real2d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  for (blam_long i = first; i < count; ++i)
+  {
+    const blam_real2d ui = {{u->components[0][i], u->components[1][i]}};
+    const blam_real2d vi = {{v->components[0][i], v->components[1][i]}};
+    result[i] = blam_real2d_det(&ui, &vi);
+  }
+}
+
+#ifdef MATH_BATCH_X86
+
+// SSE2 KERNELS:
+// Two components at a time are loaded as singles and widened to doubles.
+
+#define SSE2_LOAD(address) \
+  _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *)(address))))
+
+#define SSE2_STORE_NARROW(address, value) \
+  _mm_storel_epi64((__m128i *)(address), _mm_castps_si128(_mm_cvtpd_ps((value))))
+
+BLAM_ATTRIBUTE(target("sse2"))
+static
+void math_batch_dot_sse2(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m128d u0 = _mm_set1_pd(u->components[0]);
+  const __m128d u1 = _mm_set1_pd(u->components[1]);
+  const __m128d u2 = _mm_set1_pd(u->components[2]);
+
+  blam_long i = first;
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128d dot = _mm_add_pd(
+      _mm_mul_pd(u0, SSE2_LOAD(&v->components[0][i])),
+      _mm_mul_pd(u1, SSE2_LOAD(&v->components[1][i])));
+    dot = _mm_add_pd(dot, _mm_mul_pd(u2, SSE2_LOAD(&v->components[2][i])));
+    _mm_storeu_pd(&result[i], dot);
+  }
+
+  math_batch_dot_scalar(u, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("sse2"))
+static
+void math_batch_plane3d_test_sse2(
+  const blam_plane3d *const           plane,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m128d n0 = _mm_set1_pd(plane->normal.components[0]);
+  const __m128d n1 = _mm_set1_pd(plane->normal.components[1]);
+  const __m128d n2 = _mm_set1_pd(plane->normal.components[2]);
+  const __m128d d  = _mm_set1_pd(plane->d);
+
+  blam_long i = first;
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128d dot = _mm_add_pd(
+      _mm_mul_pd(n0, SSE2_LOAD(&v->components[0][i])),
+      _mm_mul_pd(n1, SSE2_LOAD(&v->components[1][i])));
+    dot = _mm_add_pd(dot, _mm_mul_pd(n2, SSE2_LOAD(&v->components[2][i])));
+    _mm_storeu_pd(&result[i], _mm_sub_pd(dot, d));
+  }
+
+  math_batch_plane3d_test_scalar(plane, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("sse2"))
+static
+void math_batch_cross_sse2(
+  const struct blam_real3d_soa *const u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  const struct blam_real3d_soa *const result)
+{
+  blam_long i = first;
+  for (; i + 2 <= count; i += 2)
+  {
+    const __m128d u0 = SSE2_LOAD(&u->components[0][i]);
+    const __m128d u1 = SSE2_LOAD(&u->components[1][i]);
+    const __m128d u2 = SSE2_LOAD(&u->components[2][i]);
+    const __m128d v0 = SSE2_LOAD(&v->components[0][i]);
+    const __m128d v1 = SSE2_LOAD(&v->components[1][i]);
+    const __m128d v2 = SSE2_LOAD(&v->components[2][i]);
+    SSE2_STORE_NARROW(&result->components[0][i], _mm_sub_pd(_mm_mul_pd(u1, v2), _mm_mul_pd(u2, v1)));
+    SSE2_STORE_NARROW(&result->components[1][i], _mm_sub_pd(_mm_mul_pd(u2, v0), _mm_mul_pd(u0, v2)));
+    SSE2_STORE_NARROW(&result->components[2][i], _mm_sub_pd(_mm_mul_pd(u0, v1), _mm_mul_pd(u1, v0)));
+  }
+
+  math_batch_cross_scalar(u, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("sse2"))
+static
+void math_batch_scalar_triple_sse2(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const struct blam_real3d_soa *const w,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m128d u0 = _mm_set1_pd(u->components[0]);
+  const __m128d u1 = _mm_set1_pd(u->components[1]);
+  const __m128d u2 = _mm_set1_pd(u->components[2]);
+
+  blam_long i = first;
+  for (; i + 2 <= count; i += 2)
+  {
+    const __m128d v0 = SSE2_LOAD(&v->components[0][i]);
+    const __m128d v1 = SSE2_LOAD(&v->components[1][i]);
+    const __m128d v2 = SSE2_LOAD(&v->components[2][i]);
+    const __m128d w0 = SSE2_LOAD(&w->components[0][i]);
+    const __m128d w1 = SSE2_LOAD(&w->components[1][i]);
+    const __m128d w2 = SSE2_LOAD(&w->components[2][i]);
+    const __m128d cross0 = _mm_sub_pd(_mm_mul_pd(v1, w2), _mm_mul_pd(v2, w1));
+    const __m128d cross1 = _mm_sub_pd(_mm_mul_pd(v2, w0), _mm_mul_pd(v0, w2));
+    const __m128d cross2 = _mm_sub_pd(_mm_mul_pd(v0, w1), _mm_mul_pd(v1, w0));
+    __m128d dot = _mm_add_pd(_mm_mul_pd(u0, cross0), _mm_mul_pd(u1, cross1));
+    dot = _mm_add_pd(dot, _mm_mul_pd(u2, cross2));
+    _mm_storeu_pd(&result[i], dot);
+  }
+
+  math_batch_scalar_triple_scalar(u, v, w, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("sse2"))
+static
+void math_batch_det_sse2(
+  const struct blam_real2d_soa *const u,
+  const struct blam_real2d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  blam_long i = first;
+  for (; i + 2 <= count; i += 2)
+  {
+    const __m128d u0 = SSE2_LOAD(&u->components[0][i]);
+    const __m128d u1 = SSE2_LOAD(&u->components[1][i]);
+    const __m128d v0 = SSE2_LOAD(&v->components[0][i]);
+    const __m128d v1 = SSE2_LOAD(&v->components[1][i]);
+    _mm_storeu_pd(&result[i], _mm_sub_pd(_mm_mul_pd(u0, v1), _mm_mul_pd(u1, v0)));
+  }
+
+  math_batch_det_scalar(u, v, i, count, result);
+}
+
+#undef SSE2_STORE_NARROW
+#undef SSE2_LOAD
+
+// AVX2 KERNELS:
+// Four components at a time are loaded as singles and widened to doubles.
+
+#define AVX2_LOAD(address) \
+  _mm256_cvtps_pd(_mm_loadu_ps((address)))
+
+#define AVX2_STORE_NARROW(address, value) \
+  _mm_storeu_ps((address), _mm256_cvtpd_ps((value)))
+
+BLAM_ATTRIBUTE(target("avx2"))
+static
+void math_batch_dot_avx2(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m256d u0 = _mm256_set1_pd(u->components[0]);
+  const __m256d u1 = _mm256_set1_pd(u->components[1]);
+  const __m256d u2 = _mm256_set1_pd(u->components[2]);
+
+  blam_long i = first;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256d dot = _mm256_add_pd(
+      _mm256_mul_pd(u0, AVX2_LOAD(&v->components[0][i])),
+      _mm256_mul_pd(u1, AVX2_LOAD(&v->components[1][i])));
+    dot = _mm256_add_pd(dot, _mm256_mul_pd(u2, AVX2_LOAD(&v->components[2][i])));
+    _mm256_storeu_pd(&result[i], dot);
+  }
+
+  math_batch_dot_scalar(u, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("avx2"))
+static
+void math_batch_plane3d_test_avx2(
+  const blam_plane3d *const           plane,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m256d n0 = _mm256_set1_pd(plane->normal.components[0]);
+  const __m256d n1 = _mm256_set1_pd(plane->normal.components[1]);
+  const __m256d n2 = _mm256_set1_pd(plane->normal.components[2]);
+  const __m256d d  = _mm256_set1_pd(plane->d);
+
+  blam_long i = first;
+  for (; i + 4 <= count; i += 4)
+  {
+    __m256d dot = _mm256_add_pd(
+      _mm256_mul_pd(n0, AVX2_LOAD(&v->components[0][i])),
+      _mm256_mul_pd(n1, AVX2_LOAD(&v->components[1][i])));
+    dot = _mm256_add_pd(dot, _mm256_mul_pd(n2, AVX2_LOAD(&v->components[2][i])));
+    _mm256_storeu_pd(&result[i], _mm256_sub_pd(dot, d));
+  }
+
+  math_batch_plane3d_test_scalar(plane, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("avx2"))
+static
+void math_batch_cross_avx2(
+  const struct blam_real3d_soa *const u,
+  const struct blam_real3d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  const struct blam_real3d_soa *const result)
+{
+  blam_long i = first;
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m256d u0 = AVX2_LOAD(&u->components[0][i]);
+    const __m256d u1 = AVX2_LOAD(&u->components[1][i]);
+    const __m256d u2 = AVX2_LOAD(&u->components[2][i]);
+    const __m256d v0 = AVX2_LOAD(&v->components[0][i]);
+    const __m256d v1 = AVX2_LOAD(&v->components[1][i]);
+    const __m256d v2 = AVX2_LOAD(&v->components[2][i]);
+    AVX2_STORE_NARROW(&result->components[0][i], _mm256_sub_pd(_mm256_mul_pd(u1, v2), _mm256_mul_pd(u2, v1)));
+    AVX2_STORE_NARROW(&result->components[1][i], _mm256_sub_pd(_mm256_mul_pd(u2, v0), _mm256_mul_pd(u0, v2)));
+    AVX2_STORE_NARROW(&result->components[2][i], _mm256_sub_pd(_mm256_mul_pd(u0, v1), _mm256_mul_pd(u1, v0)));
+  }
+
+  math_batch_cross_scalar(u, v, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("avx2"))
+static
+void math_batch_scalar_triple_avx2(
+  const blam_real3d *const            u,
+  const struct blam_real3d_soa *const v,
+  const struct blam_real3d_soa *const w,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  const __m256d u0 = _mm256_set1_pd(u->components[0]);
+  const __m256d u1 = _mm256_set1_pd(u->components[1]);
+  const __m256d u2 = _mm256_set1_pd(u->components[2]);
+
+  blam_long i = first;
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m256d v0 = AVX2_LOAD(&v->components[0][i]);
+    const __m256d v1 = AVX2_LOAD(&v->components[1][i]);
+    const __m256d v2 = AVX2_LOAD(&v->components[2][i]);
+    const __m256d w0 = AVX2_LOAD(&w->components[0][i]);
+    const __m256d w1 = AVX2_LOAD(&w->components[1][i]);
+    const __m256d w2 = AVX2_LOAD(&w->components[2][i]);
+    const __m256d cross0 = _mm256_sub_pd(_mm256_mul_pd(v1, w2), _mm256_mul_pd(v2, w1));
+    const __m256d cross1 = _mm256_sub_pd(_mm256_mul_pd(v2, w0), _mm256_mul_pd(v0, w2));
+    const __m256d cross2 = _mm256_sub_pd(_mm256_mul_pd(v0, w1), _mm256_mul_pd(v1, w0));
+    __m256d dot = _mm256_add_pd(_mm256_mul_pd(u0, cross0), _mm256_mul_pd(u1, cross1));
+    dot = _mm256_add_pd(dot, _mm256_mul_pd(u2, cross2));
+    _mm256_storeu_pd(&result[i], dot);
+  }
+
+  math_batch_scalar_triple_scalar(u, v, w, i, count, result);
+}
+
+BLAM_ATTRIBUTE(target("avx2"))
+static
+void math_batch_det_avx2(
+  const struct blam_real2d_soa *const u,
+  const struct blam_real2d_soa *const v,
+  const blam_long                     first,
+  const blam_long                     count,
+  blam_real_highp *const              result)
+{
+  blam_long i = first;
+  for (; i + 4 <= count; i += 4)
+  {
+    const __m256d u0 = AVX2_LOAD(&u->components[0][i]);
+    const __m256d u1 = AVX2_LOAD(&u->components[1][i]);
+    const __m256d v0 = AVX2_LOAD(&v->components[0][i]);
+    const __m256d v1 = AVX2_LOAD(&v->components[1][i]);
+    _mm256_storeu_pd(&result[i], _mm256_sub_pd(_mm256_mul_pd(u0, v1), _mm256_mul_pd(u1, v0)));
+  }
+
+  math_batch_det_scalar(u, v, i, count, result);
+}
+
+#undef AVX2_STORE_NARROW
+#undef AVX2_LOAD
+
+#endif // MATH_BATCH_X86
@@ -0,0 +1,767 @@
+#include "blam/collision_bsp.h"
+#include "blam/collision_bsp_accel.h"
+#include "blam/collision_bsp_batch.h"
+#include "blam/collision_bsp_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_bsp.h"
+
+// Checks that the alternative ways of making a BSP-vector test give the results of
+// #blam_collision_bsp_test_vector, bit for bit, over synthetic BSPs rife with BSP
+// leaks and phantom BSP:
+//   - the lite test, which records no leaves;
+//   - packets of up to 8 vectors, with and without a shared origin;
+//   - interleaved tests, and batches run with and without a pool of threads;
+//   - coherent tests along chains of short segments, each from the end of the
+//     last, and with a token carried over to another BSP;
+//   - the first of every intersection, nearest first, with any capacity;
+//   - the tick cache, as the breakable surfaces state changes within ticks;
+//   - a mitigation budget with no limits, or with limits never reached;
+//   - the configured test without a result, for only the fact of a hit.
+// Also checks that incremental searches for the leaf of a jittered point find the
+// leaf of #blam_collision_bsp_search. Each check is made without acceleration 
+// data, and with the data derived with and without sealed-world repair attached 
+// to every BSP.
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+#define TEST_BSP_COUNT    24
+#define TEST_VECTOR_COUNT 0x800
+#define TEST_TICK_COUNT   24
+#define TEST_CHAIN_COUNT  0x20
+#define TEST_CHAIN_LENGTH 0x40
+
+/**
+ * \brief The BSPs and vectors tested, and the breakable surfaces state.
+ */
+struct test_set
+{
+  struct test_bsp    bsps[TEST_BSP_COUNT];
+  struct test_vector vectors[TEST_VECTOR_COUNT];
+
+  blam_ulong             breakable_state[1];
+  struct blam_bit_vector breakable_surfaces;
+};
+
+/**
+ * \brief A way of making BSP-vector tests checked against the plain one.
+ */
+struct test_check
+{
+  const char *name;
+  blam_long (*run)(struct test_set *set);
+};
+
+/**
+ * \brief A batch of queries, made from the leading vectors of the set.
+ */
+struct test_batch_run
+{
+  blam_long                               count;   ///< The number of queries.
+  const struct blam_collision_bsp_config *config;  ///< The mitigations, or `NULL`.
+  bool                                    results; ///< `true` to receive results.
+};
+
+static struct test_set set;
+
+static struct blam_collision_bsp_test_vector_result expected;
+static struct blam_collision_bsp_test_vector_result actual;
+
+static struct blam_collision_bsp_batch_query        batch_queries[TEST_VECTOR_COUNT];
+static struct blam_collision_bsp_test_vector_result batch_results[TEST_VECTOR_COUNT];
+static blam_bool                                    batch_hits[TEST_VECTOR_COUNT];
+
+static
+blam_bool test_results_equal(
+  blam_bool                                           expected_hit,
+  const struct blam_collision_bsp_test_vector_result *expected,
+  blam_bool                                           actual_hit,
+  const struct blam_collision_bsp_test_vector_result *actual);
+
+static
+blam_long test_lite(struct test_set *set);
+
+static
+blam_long test_packet(struct test_set *set);
+
+static
+blam_long test_interleaved(struct test_set *set);
+
+static
+blam_long test_batch(struct test_set *set);
+
+static
+blam_long test_coherent(struct test_set *set);
+
+static
+blam_long test_all(struct test_set *set);
+
+static
+blam_long test_incremental(struct test_set *set);
+
+static
+blam_long test_cached(struct test_set *set);
+
+static
+blam_long test_budget(struct test_set *set);
+
+static
+blam_long test_occlusion(struct test_set *set);
+
+static const struct test_check checks[] =
+{
+  { "lite",        test_lite },
+  { "packet",      test_packet },
+  { "interleaved", test_interleaved },
+  { "batch",       test_batch },
+  { "coherent",    test_coherent },
+  { "all",         test_all },
+  { "incremental", test_incremental },
+  { "cached",      test_cached },
+  { "budget",      test_budget },
+  { "occlusion",   test_occlusion },
+};
+
+// Batches of fewer queries than the interleave width, and of more but not a 
+// multiple of it, with and without a config.
+static const struct test_batch_run batch_runs[] =
+{
+  { 0,                     NULL,                               true },
+  { 1,                     &blam_collision_bsp_default_config, true },
+  { 5,                     NULL,                               true },
+  { 0x13,                  &blam_collision_bsp_default_config, false },
+  { TEST_VECTOR_COUNT - 3, NULL,                               true },
+  { TEST_VECTOR_COUNT - 1, &blam_collision_bsp_default_config, true },
+};
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+int main(void)
+{
+  // Mostly balanced BSPs of various depths, and a few deep chains.
+  for (int i = 0; i < TEST_BSP_COUNT; ++i)
+  {
+    const bool chain = i % 8 == 7;
+    test_bsp_make(&set.bsps[i], i + 1, chain ? 300 : 6 + i % 14, chain);
+  }
+
+  uint64_t state = 0x2545F4914F6CDD1Dull;
+  for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    test_vector_make(&state, &set.vectors[i]);
+
+  set.breakable_surfaces.count = 12;
+  set.breakable_surfaces.state = set.breakable_state;
+
+  static const struct
+  {
+    const char     *name;
+    bool            attach;
+    blam_flags_long flags;
+  } accel_modes[] =
+  {
+    { "plain",    false, 0 },
+    { "accel",    true,  0 },
+    { "repaired", true,  k_collision_bsp_accel_repair_leaks },
+  };
+  static struct blam_collision_bsp_accel accels[TEST_BSP_COUNT];
+
+  blam_long failures = 0;
+  for (size_t m = 0; m < sizeof(accel_modes) / sizeof(accel_modes[0]); ++m)
+  {
+    if (accel_modes[m].attach)
+    {
+      for (int i = 0; i < TEST_BSP_COUNT; ++i)
+      {
+        if (!blam_collision_bsp_accel_build(&set.bsps[i].bsp, accel_modes[m].flags, &accels[i])
+          || !blam_collision_bsp_accel_attach(&accels[i]))
+        {
+          printf("%-8s  could not attach acceleration data\n", accel_modes[m].name);
+          return EXIT_FAILURE;
+        }
+      }
+    }
+
+    for (size_t c = 0; c < sizeof(checks) / sizeof(checks[0]); ++c)
+    {
+      const blam_long mismatches = checks[c].run(&set);
+      printf("%-8s  %-11s  %ld mismatches\n", accel_modes[m].name, checks[c].name, (long)mismatches);
+      failures += mismatches;
+    }
+
+    if (accel_modes[m].attach)
+    {
+      for (int i = 0; i < TEST_BSP_COUNT; ++i)
+      {
+        blam_collision_bsp_accel_detach(&set.bsps[i].bsp);
+        blam_collision_bsp_accel_destroy(&accels[i]);
+      }
+    }
+  }
+
+  for (int i = 0; i < TEST_BSP_COUNT; ++i)
+    test_bsp_destroy(&set.bsps[i]);
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+static
+blam_bool test_results_equal(
+  const blam_bool                                           expected_hit,
+  const struct blam_collision_bsp_test_vector_result *const expected,
+  const blam_bool                                           actual_hit,
+  const struct blam_collision_bsp_test_vector_result *const actual)
+{
+  if (expected_hit != actual_hit
+    || memcmp(&expected->fraction, &actual->fraction, sizeof(actual->fraction)) != 0
+    || expected->leaves.count != actual->leaves.count
+    || memcmp(expected->leaves.stack, actual->leaves.stack, actual->leaves.count * sizeof(actual->leaves.stack[0])) != 0)
+    return false;
+
+  // The surface is only written if there is an intersection.
+  return !actual_hit
+    || (expected->last_split == actual->last_split
+      && memcmp(&expected->surface, &actual->surface, sizeof(actual->surface)) == 0);
+}
+
+static
+void test_expect(
+  struct test_set *const          set,
+  const struct test_bsp *const    bsp,
+  const struct test_vector *const vector,
+  blam_bool *const                hit)
+{
+  memset(&expected, 0xCD, sizeof(expected));
+  *hit = blam_collision_bsp_test_vector(
+    &bsp->bsp,
+    set->breakable_surfaces,
+    &vector->origin,
+    &vector->delta,
+    vector->max_scale,
+    vector->flags,
+    &expected);
+}
+
+static
+blam_long test_lite(struct test_set *const set)
+{
+  blam_long mismatches = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+    for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    {
+      const struct test_vector *const vector = &set->vectors[i];
+
+      blam_bool expected_hit;
+      test_expect(set, &set->bsps[b], vector, &expected_hit);
+
+      struct blam_collision_bsp_test_vector_hit hit;
+      memset(&hit, 0xCD, sizeof(hit));
+      const blam_bool actual_hit = blam_collision_bsp_test_vector_lite(
+        &set->bsps[b].bsp,
+        set->breakable_surfaces,
+        &vector->origin,
+        &vector->delta,
+        vector->max_scale,
+        vector->flags,
+        &hit);
+
+      // The lite result holds the leading fields of the full one.
+      memset(&actual, 0xCD, sizeof(actual));
+      actual.fraction   = hit.fraction;
+      actual.last_split = hit.last_split;
+      actual.surface    = hit.surface;
+      actual.leaves     = expected.leaves;
+
+      mismatches += !test_results_equal(expected_hit, &expected, actual_hit, &actual);
+    }
+  }
+  return mismatches;
+}
+
+static
+blam_long test_packet(struct test_set *const set)
+{
+  static struct blam_collision_bsp_test_vector_result results[BLAM_COLLISION_BSP_PACKET_SIZE];
+
+  blam_long mismatches = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+
+    // Packets of every size, of consecutive vectors. Every other packet is made a
+    // fan, with the origin of its first vector. The vectors of a packet share the
+    // scale and flags of the first.
+    int packet_index = 0;
+    for (int first = 0; first < TEST_VECTOR_COUNT; ++packet_index)
+    {
+      int count = 1 + packet_index % BLAM_COLLISION_BSP_PACKET_SIZE;
+      if (count > TEST_VECTOR_COUNT - first)
+        count = TEST_VECTOR_COUNT - first;
+
+      const bool fan = packet_index / BLAM_COLLISION_BSP_PACKET_SIZE % 2 == 1;
+      struct test_vector vectors[BLAM_COLLISION_BSP_PACKET_SIZE];
+      blam_real3d        origins[BLAM_COLLISION_BSP_PACKET_SIZE];
+      blam_real3d        deltas[BLAM_COLLISION_BSP_PACKET_SIZE];
+      for (int i = 0; i < count; ++i)
+      {
+        vectors[i]           = set->vectors[first + i];
+        vectors[i].max_scale = set->vectors[first].max_scale;
+        vectors[i].flags     = set->vectors[first].flags;
+        if (fan)
+          vectors[i].origin = set->vectors[first].origin;
+
+        origins[i] = vectors[i].origin;
+        deltas[i]  = vectors[i].delta;
+      }
+
+      memset(results, 0xCD, sizeof(results));
+      const blam_flags_long mask = blam_collision_bsp_test_vector_packet(
+        &set->bsps[b].bsp,
+        set->breakable_surfaces,
+        origins,
+        deltas,
+        count,
+        vectors[0].max_scale,
+        vectors[0].flags,
+        results);
+
+      for (int i = 0; i < count; ++i)
+      {
+        blam_bool expected_hit;
+        test_expect(set, &set->bsps[b], &vectors[i], &expected_hit);
+
+        const blam_bool actual_hit = (mask >> i & 1) != 0;
+        mismatches += !test_results_equal(expected_hit, &expected, actual_hit, &results[i]);
+      }
+      mismatches += (mask >> count) != 0;
+
+      first += count;
+    }
+  }
+  return mismatches;
+}
+
+static
+void test_batch_begin(struct test_set *const set, const int bsp_index)
+{
+  set->breakable_state[0] = 0x5A5u + (blam_ulong)bsp_index;
+  for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+  {
+    batch_queries[i].origin    = set->vectors[i].origin;
+    batch_queries[i].delta     = set->vectors[i].delta;
+    batch_queries[i].max_scale = set->vectors[i].max_scale;
+    batch_queries[i].flags     = set->vectors[i].flags;
+  }
+  memset(batch_results, 0xCD, sizeof(batch_results));
+  memset(batch_hits, 0xCD, sizeof(batch_hits));
+}
+
+static
+blam_long test_batch_compare(
+  struct test_set *const             set,
+  const int                          bsp_index,
+  const struct test_batch_run *const run,
+  const blam_long                    hit_count)
+{
+  blam_long mismatches = 0;
+  blam_long expected_hit_count = 0;
+  for (blam_long i = 0; i < run->count; ++i)
+  {
+    blam_bool expected_hit;
+    test_expect(set, &set->bsps[bsp_index], &set->vectors[i], &expected_hit);
+    expected_hit_count += expected_hit ? 1 : 0;
+
+    if (run->results)
+      mismatches += !test_results_equal(expected_hit, &expected, batch_hits[i], &batch_results[i]);
+    else
+      mismatches += expected_hit != batch_hits[i];
+  }
+  mismatches += hit_count != expected_hit_count;
+
+  // Queries past the count must be left alone.
+  for (blam_long i = run->count; i < TEST_VECTOR_COUNT; ++i)
+  {
+    const unsigned char *const bytes = (const unsigned char *)&batch_hits[i];
+    mismatches += bytes[0] != 0xCD;
+  }
+  return mismatches;
+}
+
+static
+blam_long test_interleaved(struct test_set *const set)
+{
+  blam_long mismatches = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    for (size_t r = 0; r < sizeof(batch_runs) / sizeof(batch_runs[0]); ++r)
+    {
+      const struct test_batch_run *const run = &batch_runs[r];
+      test_batch_begin(set, b);
+
+      const blam_long hit_count = blam_collision_bsp_test_vector_interleaved(
+        run->config,
+        &set->bsps[b].bsp,
+        set->breakable_surfaces,
+        batch_queries,
+        run->count,
+        run->results ? batch_results : NULL,
+        batch_hits);
+
+      mismatches += test_batch_compare(set, b, run, hit_count);
+    }
+  }
+  return mismatches;
+}
+
+static
+blam_long test_batch(struct test_set *const set)
+{
+  struct blam_collision_bsp_batch_pool *const pool = blam_collision_bsp_batch_pool_create(4);
+  if (pool == NULL)
+    return 1;
+
+  blam_long mismatches = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    for (size_t r = 0; r < sizeof(batch_runs) / sizeof(batch_runs[0]); ++r)
+    {
+      for (int pooled = 0; pooled < 2; ++pooled)
+      {
+        const struct test_batch_run *const run = &batch_runs[r];
+        test_batch_begin(set, b);
+
+        const blam_long hit_count = blam_collision_bsp_test_vector_batch(
+          pooled ? pool : NULL,
+          run->config,
+          &set->bsps[b].bsp,
+          set->breakable_surfaces,
+          batch_queries,
+          run->count,
+          run->results ? batch_results : NULL,
+          batch_hits);
+
+        mismatches += test_batch_compare(set, b, run, hit_count);
+      }
+    }
+  }
+
+  blam_collision_bsp_batch_pool_destroy(pool);
+  return mismatches;
+}
+
+static
+blam_long test_coherent(struct test_set *const set)
+{
+  uint64_t state = 0xDA3E39CB94B95BDBull;
+
+  blam_long mismatches  = 0;
+  blam_long below_root = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+    for (int c = 0; c < TEST_CHAIN_COUNT; ++c)
+    {
+      struct blam_collision_bsp_coherence coherence;
+      memset(&coherence, 0, sizeof(coherence));
+
+      // The last segment of each chain is tested against the next BSP with the 
+      // same token, which must then be ignored.
+      struct test_vector vector = set->vectors[(b * TEST_CHAIN_COUNT + c) % TEST_VECTOR_COUNT];
+      for (int i = 0; i <= TEST_CHAIN_LENGTH; ++i)
+      {
+        const struct test_bsp *const bsp = &set->bsps[(b + (i == TEST_CHAIN_LENGTH)) % TEST_BSP_COUNT];
+        for (int j = 0; j < 3; ++j)
+          vector.delta.components[j] = (blam_real)((int)(test_random(&state) % 2001) - 1000) * 0.0005f;
+
+        below_root += coherence.bsp == &bsp->bsp && coherence.node != 0;
+
+        blam_bool expected_hit;
+        test_expect(set, bsp, &vector, &expected_hit);
+
+        memset(&actual, 0xCD, sizeof(actual));
+        const blam_bool actual_hit = blam_collision_bsp_test_vector_coherent(
+          &bsp->bsp,
+          set->breakable_surfaces,
+          &vector.origin,
+          &vector.delta,
+          vector.max_scale,
+          vector.flags,
+          &coherence,
+          &actual);
+
+        mismatches += !test_results_equal(expected_hit, &expected, actual_hit, &actual);
+        mismatches += coherence.bsp != &bsp->bsp;
+
+        // The next segment starts where this one ended.
+        const blam_real scale = vector.max_scale < 0.0f ? 0.0f : vector.max_scale > 1.0f ? 1.0f : vector.max_scale;
+        for (int j = 0; j < 3; ++j)
+          vector.origin.components[j] += vector.delta.components[j] * scale;
+      }
+    }
+  }
+
+  // Tokens must have been left below the root for the comparison to be of any use.
+  if (below_root == 0)
+    ++mismatches;
+
+  return mismatches;
+}
+
+static
+blam_long test_all(struct test_set *const set)
+{
+  static const blam_long capacities[] = { 1, 2, 0x10 };
+  struct blam_collision_bsp_test_vector_hit hits[0x10];
+
+  blam_long mismatches     = 0;
+  blam_long multiple_count = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+    for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    {
+      const struct test_vector *const vector = &set->vectors[i];
+
+      blam_bool expected_hit;
+      test_expect(set, &set->bsps[b], vector, &expected_hit);
+
+      for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); ++c)
+      {
+        memset(hits, 0xCD, sizeof(hits));
+        const blam_long hit_count = blam_collision_bsp_test_vector_all(
+          &set->bsps[b].bsp,
+          set->breakable_surfaces,
+          &vector->origin,
+          &vector->delta,
+          vector->max_scale,
+          vector->flags,
+          hits,
+          capacities[c]);
+
+        if (hit_count < 0 || hit_count > capacities[c] || (hit_count > 0) != expected_hit)
+        {
+          ++mismatches;
+          continue;
+        }
+
+        // The first hit is the plain result, and the rest follow it in order.
+        if (hit_count > 0
+          && (memcmp(&hits[0].fraction, &expected.fraction, sizeof(expected.fraction)) != 0
+            || hits[0].last_split != expected.last_split
+            || memcmp(&hits[0].surface, &expected.surface, sizeof(expected.surface)) != 0))
+          ++mismatches;
+        for (blam_long h = 1; h < hit_count; ++h)
+          mismatches += !(hits[h - 1].fraction <= hits[h].fraction);
+
+        // Hits past the count must be left alone.
+        for (blam_long h = hit_count; h < capacities[c]; ++h)
+        {
+          const unsigned char *const bytes = (const unsigned char *)&hits[h];
+          mismatches += bytes[0] != 0xCD;
+        }
+
+        multiple_count += hit_count > 1;
+      }
+    }
+  }
+
+  // Vectors must have gone on to hit more than one surface for the order to have
+  // been checked.
+  if (multiple_count == 0)
+    ++mismatches;
+
+  return mismatches;
+}
+
+static
+blam_long test_incremental(struct test_set *const set)
+{
+  uint64_t state = 0x4F1BBCDCBFA53E0Bull;
+
+  blam_long mismatches = 0;
+  blam_long kept_count = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    const struct blam_collision_bsp *const bsp = &set->bsps[b].bsp;
+    for (int w = 0; w < TEST_CHAIN_COUNT; ++w)
+    {
+      // Some walks start from a leaf the point is not known to be in.
+      struct blam_structure_location location = { -1, -1 };
+      if (w % 4 == 3)
+        location.leaf = (blam_index_long)(test_random(&state) % (uint32_t)bsp->leaves.count);
+
+      blam_real3d point = set->vectors[(b * TEST_CHAIN_COUNT + w) % TEST_VECTOR_COUNT].origin;
+      for (int i = 0; i < TEST_CHAIN_LENGTH; ++i)
+      {
+        // Mostly small steps, some tiny, and now and then a step onto a plane.
+        const blam_real step = i % 8 == 0 ? 1.0f : i % 8 == 1 ? 1.0e-4f : 0.05f;
+        for (int j = 0; j < 3; ++j)
+          point.components[j] += (blam_real)((int)(test_random(&state) % 2001) - 1000) * 0.001f * step;
+
+        if (i % 16 == 15)
+        {
+          const blam_index_long     plane_index = (blam_index_long)(test_random(&state) % (uint32_t)bsp->planes.count);
+          const blam_plane3d *const plane       = BLAM_TAG_BLOCK_GET(bsp, plane, planes, plane_index);
+          const blam_real distance = (blam_real)blam_plane3d_test(plane, &point);
+          for (int j = 0; j < 3; ++j)
+            point.components[j] -= distance * plane->normal.components[j];
+        }
+
+        const blam_index_long previous = location.leaf;
+        const blam_index_long expected_leaf = blam_collision_bsp_search(bsp, 0, &point);
+        const blam_index_long actual_leaf   = blam_collision_bsp_search_incremental(bsp, &point, &location);
+
+        mismatches += expected_leaf != actual_leaf || location.leaf != actual_leaf;
+        kept_count += previous != -1 && actual_leaf == previous;
+      }
+    }
+  }
+
+  // Points must have stayed in their leaves for the comparison to be of any use.
+  if (kept_count == 0)
+    ++mismatches;
+
+  return mismatches;
+}
+
+static
+blam_long test_cached(struct test_set *const set)
+{
+  struct blam_collision_bsp_cache cache;
+  if (!blam_collision_bsp_cache_create(&cache, 0x40000))
+    return 1;
+
+  struct blam_collision_bsp_breakable_generation tracker = { 0 };
+  uint64_t state = 0x853C49E6748FEA9Bull;
+
+  // Each tick makes tests from a window of the vectors, so that many of them are
+  // made more than once within the tick, and the breakable surfaces state changes
+  // midway through some ticks.
+  blam_long mismatches = 0;
+  set->breakable_state[0] = 0x5A5u;
+  for (int tick = 0; tick < TEST_TICK_COUNT; ++tick)
+  {
+    blam_collision_bsp_cache_begin_tick(&cache);
+    for (int t = 0; t < 0x400; ++t)
+    {
+      if (tick % 4 == 1 && t == 0x200)
+        set->breakable_state[0] ^= 0x30u;
+
+      const struct test_bsp *const    bsp    = &set->bsps[test_random(&state) % TEST_BSP_COUNT];
+      const struct test_vector *const vector = &set->vectors[(tick * 37 + test_random(&state) % 0x96) % TEST_VECTOR_COUNT];
+
+      blam_bool expected_hit;
+      test_expect(set, bsp, vector, &expected_hit);
+
+      memset(&actual, 0xCD, sizeof(actual));
+      const blam_bool actual_hit = blam_collision_bsp_test_vector_cached(
+        &cache,
+        &bsp->bsp,
+        set->breakable_surfaces,
+        blam_collision_bsp_breakable_generation_update(&tracker, set->breakable_surfaces),
+        &vector->origin,
+        &vector->delta,
+        vector->max_scale,
+        vector->flags,
+        &actual);
+
+      mismatches += !test_results_equal(expected_hit, &expected, actual_hit, &actual);
+    }
+  }
+
+  // Tests answered from the cache must have been checked for the comparison to
+  // be of any use.
+  if (cache.stats.hit_count == 0)
+    ++mismatches;
+
+  blam_collision_bsp_cache_destroy(&cache);
+  return mismatches;
+}
+
+static
+blam_long test_budget(struct test_set *const set)
+{
+  // A budget without limits, and one whose limits are never reached, must leave
+  // every result as it is without one.
+  struct blam_collision_bsp_budget budgets[2];
+  blam_collision_bsp_budget_init(&budgets[0], -1, -1, -1, -1);
+  blam_collision_bsp_budget_init(&budgets[1], 0x10000, 0x1000000, 0x1000000, 0x7FFFFFFF);
+
+  blam_long mismatches = 0;
+  for (int k = 0; k < 2; ++k)
+  {
+    struct blam_collision_bsp_config config = blam_collision_bsp_default_config;
+    config.budget = &budgets[k];
+
+    for (int b = 0; b < TEST_BSP_COUNT; ++b)
+    {
+      set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+      blam_collision_bsp_budget_begin_tick(&budgets[k]);
+      for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+      {
+        const struct test_vector *const vector = &set->vectors[i];
+
+        blam_bool expected_hit;
+        test_expect(set, &set->bsps[b], vector, &expected_hit);
+
+        memset(&actual, 0xCD, sizeof(actual));
+        const blam_bool actual_hit = blam_collision_bsp_test_vector_configured(
+          &config,
+          &set->bsps[b].bsp,
+          set->breakable_surfaces,
+          &vector->origin,
+          &vector->delta,
+          vector->max_scale,
+          vector->flags,
+          &actual);
+
+        mismatches += !test_results_equal(expected_hit, &expected, actual_hit, &actual);
+      }
+    }
+
+    // Leaks must have been resolved under the budget, and it must never have run
+    // out, for the comparison to be of any use.
+    if (budgets[k].stats.attempt_count == 0 || budgets[k].stats.exhausted_count != 0)
+      ++mismatches;
+  }
+  return mismatches;
+}
+
+static
+blam_long test_occlusion(struct test_set *const set)
+{
+  blam_long mismatches = 0;
+  for (int b = 0; b < TEST_BSP_COUNT; ++b)
+  {
+    set->breakable_state[0] = 0x5A5u + (blam_ulong)b;
+    for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    {
+      const struct test_vector *const vector = &set->vectors[i];
+
+      blam_bool expected_hit;
+      test_expect(set, &set->bsps[b], vector, &expected_hit);
+
+      const blam_bool actual_hit = blam_collision_bsp_test_vector_configured(
+        &blam_collision_bsp_default_config,
+        &set->bsps[b].bsp,
+        set->breakable_surfaces,
+        &vector->origin,
+        &vector->delta,
+        vector->max_scale,
+        vector->flags,
+        NULL);
+
+      mismatches += expected_hit != actual_hit;
+    }
+  }
+  return mismatches;
+}
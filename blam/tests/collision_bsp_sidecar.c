@@ -0,0 +1,353 @@
+#include "blam/collision_bsp.h"
+#include "blam/collision_bsp_accel.h"
+#include "blam/collision_bsp_sidecar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_bsp.h"
+
+// Checks that acceleration data mapped from a sidecar gives the same results as
+// the data it was written from, and that sidecars damaged so that an index goes
+// out of bounds are rejected rather than read. Sidecars are written to the
+// working directory.
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+#define TEST_BSP_COUNT    8
+#define TEST_VECTOR_COUNT 0x400
+
+#define TEST_PATH           "test_sidecar.bsc"
+#define TEST_DAMAGED_PATH   "test_sidecar_damaged.bsc"
+
+/**
+ * \brief A way to damage a sidecar, by overwriting a word of one of its tables.
+ */
+struct test_damage
+{
+  const char *name;
+
+  /**
+   * \brief Gets the word to overwrite, and the value to overwrite it with.
+   *
+   * \param [in]  accel The data mapped from the undamaged sidecar.
+   * \param [out] word  Receives the address of the word, within the mapping.
+   * \param [out] value Receives the value.
+   *
+   * \return `false` if the data has no such word to damage.
+   */
+  bool (*locate)(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+};
+
+static
+blam_long test_round_trip(const struct test_bsp *bsp, blam_flags_long flags, const struct test_vector *vectors);
+
+static
+blam_long test_damaged(const struct test_bsp *bsp, blam_flags_long flags);
+
+static
+bool test_damage_bucket(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_candidate_range(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_candidate_reference(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_bound_range(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_bound_plane(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_breakable(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static
+bool test_damage_repair_leaf(const struct blam_collision_bsp_accel *accel, const void **word, blam_long *value);
+
+static const struct test_damage damages[] =
+{
+  { "bucket",              test_damage_bucket },
+  { "candidate range",     test_damage_candidate_range },
+  { "candidate reference", test_damage_candidate_reference },
+  { "bound range",         test_damage_bound_range },
+  { "bound plane",         test_damage_bound_plane },
+  { "breakable surface",   test_damage_breakable },
+  { "repaired leaf",       test_damage_repair_leaf },
+};
+
+static struct test_vector vectors[TEST_VECTOR_COUNT];
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+int main(void)
+{
+  uint64_t state = 0x2545F4914F6CDD1Dull;
+  for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    test_vector_make(&state, &vectors[i]);
+
+  blam_long failures = 0;
+  for (int i = 0; i < TEST_BSP_COUNT; ++i)
+  {
+    const bool chain = i % 4 == 3;
+    struct test_bsp bsp;
+    test_bsp_make(&bsp, i + 1, chain ? 200 : 6 + i % 10, chain);
+
+    for (blam_flags_long flags = 0; flags <= k_collision_bsp_accel_repair_leaks; ++flags)
+    {
+      const blam_long mismatches = test_round_trip(&bsp, flags, vectors);
+      const blam_long accepted   = test_damaged(&bsp, flags);
+      printf("bsp %d  flags %ld  %ld mismatches  %ld damaged sidecars accepted\n", i, (long)flags, (long)mismatches, (long)accepted);
+      failures += mismatches + accepted;
+    }
+
+    test_bsp_destroy(&bsp);
+  }
+
+  remove(TEST_PATH);
+  remove(TEST_DAMAGED_PATH);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+static
+blam_long test_run(
+  const struct test_bsp *const                  bsp,
+  const struct blam_collision_bsp_accel *const  accel,
+  const struct test_vector *const               vectors,
+  struct blam_collision_bsp_test_vector_hit    *hits)
+{
+  if (!blam_collision_bsp_accel_attach(accel))
+    return 1;
+
+  blam_ulong breakable_state[1] = { 0x5A5u };
+  const struct blam_bit_vector breakable_surfaces = { 12, breakable_state };
+  for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+  {
+    memset(&hits[i], 0, sizeof(hits[i]));
+    blam_collision_bsp_test_vector_lite(
+      &bsp->bsp,
+      breakable_surfaces,
+      &vectors[i].origin,
+      &vectors[i].delta,
+      vectors[i].max_scale,
+      vectors[i].flags,
+      &hits[i]);
+  }
+
+  blam_collision_bsp_accel_detach(&bsp->bsp);
+  return 0;
+}
+
+static
+blam_long test_round_trip(
+  const struct test_bsp *const    bsp,
+  const blam_flags_long           flags,
+  const struct test_vector *const vectors)
+{
+  static struct blam_collision_bsp_test_vector_hit derived_hits[TEST_VECTOR_COUNT];
+  static struct blam_collision_bsp_test_vector_hit mapped_hits[TEST_VECTOR_COUNT];
+
+  struct blam_collision_bsp_content_hash hash;
+  blam_collision_bsp_hash_content(&bsp->bsp, &hash);
+
+  struct blam_collision_bsp_accel derived;
+  if (!blam_collision_bsp_accel_build(&bsp->bsp, flags, &derived))
+    return 1;
+
+  // The sidecar is written twice, so that the second replaces the first while the
+  // first is still mapped.
+  struct blam_collision_bsp_accel mapped;
+  blam_long mismatches = !blam_collision_bsp_sidecar_write(&derived, &hash, TEST_PATH)
+    || !blam_collision_bsp_sidecar_map(&bsp->bsp, &hash, flags, TEST_PATH, &mapped);
+  if (mismatches != 0)
+  {
+    blam_collision_bsp_accel_destroy(&derived);
+    return mismatches;
+  }
+
+#if !defined(_WIN32)
+  mismatches += !blam_collision_bsp_sidecar_write(&derived, &hash, TEST_PATH);
+#endif // _WIN32
+
+  mismatches += test_run(bsp, &derived, vectors, derived_hits);
+  mismatches += test_run(bsp, &mapped, vectors, mapped_hits);
+  for (int i = 0; i < TEST_VECTOR_COUNT; ++i)
+    mismatches += memcmp(&derived_hits[i], &mapped_hits[i], sizeof(mapped_hits[i])) != 0;
+
+  // Sidecars of other flags or BSPs are not mapped.
+  struct blam_collision_bsp_accel other;
+  struct blam_collision_bsp_content_hash other_hash = hash;
+  other_hash.words[0] ^= 1;
+  mismatches += blam_collision_bsp_sidecar_map(&bsp->bsp, &hash, flags ^ k_collision_bsp_accel_repair_leaks, TEST_PATH, &other);
+  mismatches += blam_collision_bsp_sidecar_map(&bsp->bsp, &other_hash, flags, TEST_PATH, &other);
+
+  blam_collision_bsp_accel_destroy(&mapped);
+  blam_collision_bsp_accel_destroy(&derived);
+  return mismatches;
+}
+
+static
+blam_long test_damaged(const struct test_bsp *const bsp, const blam_flags_long flags)
+{
+  struct blam_collision_bsp_content_hash hash;
+  blam_collision_bsp_hash_content(&bsp->bsp, &hash);
+
+  struct blam_collision_bsp_accel mapped;
+  if (!blam_collision_bsp_sidecar_map(&bsp->bsp, &hash, flags, TEST_PATH, &mapped))
+    return 1;
+
+  FILE *file = fopen(TEST_PATH, "rb");
+  char *const contents = malloc(mapped.mapping_size);
+  const bool read = file != NULL && contents != NULL
+    && fread(contents, 1, mapped.mapping_size, file) == (size_t)mapped.mapping_size;
+  if (file != NULL)
+    fclose(file);
+  if (!read)
+  {
+    free(contents);
+    blam_collision_bsp_accel_destroy(&mapped);
+    return 1;
+  }
+
+  // Each damage is made to a copy of the sidecar, at the offset of the word within
+  // the mapping.
+  blam_long accepted = 0;
+  for (size_t i = 0; i < sizeof(damages) / sizeof(damages[0]); ++i)
+  {
+    const void *word;
+    blam_long   value;
+    if (!damages[i].locate(&mapped, &word, &value))
+      continue;
+
+    const size_t offset = (size_t)((const char *)word - (const char *)mapped.mapping);
+    blam_long original;
+    memcpy(&original, contents + offset, sizeof(original));
+    memcpy(contents + offset, &value, sizeof(value));
+
+    file = fopen(TEST_DAMAGED_PATH, "wb");
+    const bool written = file != NULL && fwrite(contents, 1, mapped.mapping_size, file) == (size_t)mapped.mapping_size;
+    if (file != NULL)
+      fclose(file);
+    memcpy(contents + offset, &original, sizeof(original));
+
+    struct blam_collision_bsp_accel damaged;
+    if (written && !blam_collision_bsp_sidecar_map(&bsp->bsp, &hash, flags, TEST_DAMAGED_PATH, &damaged))
+      continue;
+
+    printf("damaged sidecar accepted: %s\n", damages[i].name);
+    if (written)
+      blam_collision_bsp_accel_destroy(&damaged);
+    ++accepted;
+  }
+
+  free(contents);
+  blam_collision_bsp_accel_destroy(&mapped);
+  return accepted;
+}
+
+static
+bool test_damage_bucket(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->leak_table.bucket_count == 0)
+    return false;
+
+  *word  = &accel->leak_table.buckets[0];
+  *value = accel->leak_table.entry_count;
+  return true;
+}
+
+static
+bool test_damage_candidate_range(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->leak_table.entry_count == 0)
+    return false;
+
+  const struct blam_collision_bsp_leak_entry *const entry = &accel->leak_table.entries[0];
+  *word  = &entry->candidate_count;
+  *value = accel->leak_table.candidate_count - entry->first_candidate + 1;
+  return true;
+}
+
+static
+bool test_damage_candidate_reference(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->leak_table.candidate_count == 0)
+    return false;
+
+  *word  = &accel->leak_table.candidates[0].reference;
+  *value = blam_collision_bsp_accel_target(accel)->bsp2d.references.count;
+  return true;
+}
+
+static
+bool test_damage_bound_range(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->leaf_bounds.leaf_count == 0)
+    return false;
+
+  *word  = &accel->leaf_bounds.ranges[0].first;
+  *value = accel->leaf_bounds.bound_count;
+  return accel->leaf_bounds.ranges[0].count > 0;
+}
+
+static
+bool test_damage_bound_plane(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->leaf_bounds.bound_count == 0)
+    return false;
+
+  *word  = &accel->leaf_bounds.bounds[0].plane;
+  *value = accel->bsp->planes.count;
+  return true;
+}
+
+static
+bool test_damage_breakable(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if (accel->breakables.surface_count == 0)
+    return false;
+
+  *word  = &accel->breakables.surfaces[0];
+  *value = accel->bsp->surfaces.count;
+  return true;
+}
+
+static
+bool test_damage_repair_leaf(
+  const struct blam_collision_bsp_accel *const accel,
+  const void **const                           word,
+  blam_long *const                             value)
+{
+  if ((accel->flags & k_collision_bsp_accel_repair_leaks) == 0 || accel->repair.bsp.leaves.count == 0)
+    return false;
+
+  const struct blam_bsp3d_leaf *const leaf = accel->repair.bsp.leaves.address;
+  *word  = &leaf->first_reference;
+  *value = accel->repair.bsp.bsp2d.references.count;
+  return leaf->reference_count > 0;
+}
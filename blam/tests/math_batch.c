@@ -0,0 +1,292 @@
+#include "blam/math_batch.h"
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Checks that every implementation of the batch operations the processor supports
+// gives results bit-identical to the scalar one, and to math.h where it applies.
+// Run with `benchmark` as an argument to also time each operation.
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+/**
+ * \brief The number of vectors operated on; not a multiple of any vector width.
+ */
+#define TEST_COUNT 0x403
+
+/**
+ * \brief The number of times each operation is timed over #TEST_COUNT vectors.
+ */
+#define BENCHMARK_REPETITIONS 0x1000
+
+/**
+ * \brief The results of every batch operation, for one implementation.
+ */
+struct test_results
+{
+  blam_real_highp dot[TEST_COUNT];
+  blam_real_highp plane_test[TEST_COUNT];
+  blam_real       cross[3][TEST_COUNT];
+  blam_real_highp scalar_triple[TEST_COUNT];
+  blam_real_highp det[TEST_COUNT];
+};
+
+/**
+ * \brief The inputs of every batch operation.
+ */
+struct test_inputs
+{
+  blam_real3d  u;
+  blam_plane3d plane;
+  blam_real    components[10][TEST_COUNT + 1];
+
+  struct blam_real3d_soa v;
+  struct blam_real3d_soa w;
+  struct blam_real2d_soa p;
+  struct blam_real2d_soa q;
+};
+
+static const char *const isa_names[] = { "scalar", "sse2", "avx2" };
+
+static struct test_inputs  inputs;
+static struct test_results results[3];
+
+static
+blam_real test_random_real(uint64_t *state);
+
+static
+void test_inputs_init(struct test_inputs *in);
+
+static
+void test_run(const struct test_inputs *in, blam_long count, struct test_results *out);
+
+static
+blam_long test_compare(const struct test_results *expected, const struct test_results *actual);
+
+static
+blam_long test_compare_math(const struct test_inputs *in, const struct test_results *actual);
+
+static
+double test_seconds(void);
+
+static
+void test_benchmark(const struct test_inputs *in, enum blam_math_isa isa);
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+int main(int argc, char **argv)
+{
+  const bool benchmark = argc > 1 && strcmp(argv[1], "benchmark") == 0;
+
+  test_inputs_init(&inputs);
+
+  // Every count up to a few vector widths, so that each kernel is checked with
+  // every number of vectors left to the scalar one.
+  static const blam_long counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 17, TEST_COUNT };
+
+  blam_long failures = 0;
+  for (int isa = k_blam_math_isa_scalar; isa <= k_blam_math_isa_avx2; ++isa)
+  {
+    if (blam_math_batch_select(isa) != (enum blam_math_isa)isa)
+    {
+      printf("%-6s  not supported, skipped\n", isa_names[isa]);
+      continue;
+    }
+
+    blam_long mismatches = 0;
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+    {
+      test_run(&inputs, counts[i], &results[isa]);
+      if (isa != k_blam_math_isa_scalar)
+      {
+        blam_math_batch_select(k_blam_math_isa_scalar);
+        test_run(&inputs, counts[i], &results[k_blam_math_isa_scalar]);
+        blam_math_batch_select(isa);
+        mismatches += test_compare(&results[k_blam_math_isa_scalar], &results[isa]);
+      }
+    }
+
+    // math.h only agrees when `blam_real_highp` arithmetic is not carried out in
+    // extended precision.
+#if FLT_EVAL_METHOD == 0
+    if (isa == k_blam_math_isa_scalar)
+      mismatches += test_compare_math(&inputs, &results[isa]);
+#endif // FLT_EVAL_METHOD == 0
+
+    printf("%-6s  %ld mismatches\n", isa_names[isa], (long)mismatches);
+    failures += mismatches;
+
+    if (benchmark)
+      test_benchmark(&inputs, isa);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+static
+blam_real test_random_real(uint64_t *const state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+
+  // Mostly map-sized coordinates, with some far smaller and larger magnitudes and
+  // exact zeros, so that products and sums round and cancel.
+  const uint32_t bits      = (uint32_t)(*state >> 32);
+  const blam_real mantissa = (blam_real)((int32_t)bits >> 8) * 0x1p-23f;
+  switch (bits & 0x0F)
+  {
+  case 0:
+    return 0.0f;
+  case 1:
+    return mantissa * 0x1p-20f;
+  case 2:
+    return mantissa * 0x1p+20f;
+  default:
+    return mantissa * (blam_real)(1 << (bits >> 4 & 0x0F));
+  }
+}
+
+static
+void test_inputs_init(struct test_inputs *const in)
+{
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+
+  for (int c = 0; c < 3; ++c)
+  {
+    in->u.components[c]            = test_random_real(&state);
+    in->plane.normal.components[c] = test_random_real(&state);
+  }
+  in->plane.d = test_random_real(&state);
+
+  for (int k = 0; k < 10; ++k)
+  {
+    for (int i = 0; i < TEST_COUNT + 1; ++i)
+      in->components[k][i] = test_random_real(&state);
+  }
+
+  // Start past the first element, so that the vectorized kernels load from
+  // unaligned addresses.
+  for (int c = 0; c < 3; ++c)
+  {
+    in->v.components[c] = &in->components[0 + c][1];
+    in->w.components[c] = &in->components[3 + c][1];
+  }
+  for (int c = 0; c < 2; ++c)
+  {
+    in->p.components[c] = &in->components[6 + c][1];
+    in->q.components[c] = &in->components[8 + c][1];
+  }
+}
+
+static
+void test_run(
+  const struct test_inputs *const in,
+  const blam_long                 count,
+  struct test_results *const      out)
+{
+  // Results past the count must be left alone.
+  memset(out, 0xCD, sizeof(*out));
+
+  const struct blam_real3d_soa cross = {{ out->cross[0], out->cross[1], out->cross[2] }};
+  blam_real3d_dot_batch(&in->u, &in->v, count, out->dot);
+  blam_plane3d_test_batch(&in->plane, &in->v, count, out->plane_test);
+  blam_real3d_cross_batch(&in->v, &in->w, count, &cross);
+  blam_real3d_scalar_triple_batch(&in->u, &in->v, &in->w, count, out->scalar_triple);
+  blam_real2d_det_batch(&in->p, &in->q, count, out->det);
+}
+
+static
+blam_long test_compare(
+  const struct test_results *const expected,
+  const struct test_results *const actual)
+{
+  // The whole of each result is compared, so that writes past the count are
+  // caught as well.
+  blam_long mismatches = 0;
+  mismatches += memcmp(expected->dot, actual->dot, sizeof(actual->dot)) != 0;
+  mismatches += memcmp(expected->plane_test, actual->plane_test, sizeof(actual->plane_test)) != 0;
+  mismatches += memcmp(expected->cross, actual->cross, sizeof(actual->cross)) != 0;
+  mismatches += memcmp(expected->scalar_triple, actual->scalar_triple, sizeof(actual->scalar_triple)) != 0;
+  mismatches += memcmp(expected->det, actual->det, sizeof(actual->det)) != 0;
+  return mismatches;
+}
+
+static
+blam_long test_compare_math(
+  const struct test_inputs *const  in,
+  const struct test_results *const actual)
+{
+  blam_long mismatches = 0;
+  for (int i = 0; i < TEST_COUNT; ++i)
+  {
+    const blam_real3d v = {{ in->v.components[0][i], in->v.components[1][i], in->v.components[2][i] }};
+    const blam_real3d w = {{ in->w.components[0][i], in->w.components[1][i], in->w.components[2][i] }};
+    const blam_real2d p = {{ in->p.components[0][i], in->p.components[1][i] }};
+    const blam_real2d q = {{ in->q.components[0][i], in->q.components[1][i] }};
+
+    const blam_real_highp dot           = blam_real3d_dot(&in->u, &v);
+    const blam_real_highp plane_test    = blam_plane3d_test(&in->plane, &v);
+    const blam_real3d     cross         = blam_real3d_cross(&v, &w);
+    const blam_real_highp scalar_triple = blam_real3d_scalar_triple(&in->u, &v, &w);
+    const blam_real_highp det           = blam_real2d_det(&p, &q);
+
+    mismatches += memcmp(&dot, &actual->dot[i], sizeof(dot)) != 0;
+    mismatches += memcmp(&plane_test, &actual->plane_test[i], sizeof(plane_test)) != 0;
+    for (int c = 0; c < 3; ++c)
+      mismatches += memcmp(&cross.components[c], &actual->cross[c][i], sizeof(cross.components[c])) != 0;
+    mismatches += memcmp(&scalar_triple, &actual->scalar_triple[i], sizeof(scalar_triple)) != 0;
+    mismatches += memcmp(&det, &actual->det[i], sizeof(det)) != 0;
+  }
+  return mismatches;
+}
+
+static
+double test_seconds(void)
+{
+  struct timespec time;
+  timespec_get(&time, TIME_UTC);
+  return (double)time.tv_sec + (double)time.tv_nsec * 1.0e-9;
+}
+
+static
+void test_benchmark(const struct test_inputs *const in, const enum blam_math_isa isa)
+{
+  struct test_results *const out = &results[isa];
+  const struct blam_real3d_soa cross = {{ out->cross[0], out->cross[1], out->cross[2] }};
+
+  double seconds[5] = { 0 };
+  for (int r = 0; r < BENCHMARK_REPETITIONS; ++r)
+  {
+    const double t0 = test_seconds();
+    blam_real3d_dot_batch(&in->u, &in->v, TEST_COUNT, out->dot);
+    const double t1 = test_seconds();
+    blam_plane3d_test_batch(&in->plane, &in->v, TEST_COUNT, out->plane_test);
+    const double t2 = test_seconds();
+    blam_real3d_cross_batch(&in->v, &in->w, TEST_COUNT, &cross);
+    const double t3 = test_seconds();
+    blam_real3d_scalar_triple_batch(&in->u, &in->v, &in->w, TEST_COUNT, out->scalar_triple);
+    const double t4 = test_seconds();
+    blam_real2d_det_batch(&in->p, &in->q, TEST_COUNT, out->det);
+    const double t5 = test_seconds();
+
+    seconds[0] += t1 - t0;
+    seconds[1] += t2 - t1;
+    seconds[2] += t3 - t2;
+    seconds[3] += t4 - t3;
+    seconds[4] += t5 - t4;
+  }
+
+  const double scale = 1.0e9 / ((double)BENCHMARK_REPETITIONS * TEST_COUNT);
+  printf("        ns/vector: dot %.3f, plane test %.3f, cross %.3f, scalar triple %.3f, det %.3f\n",
+    seconds[0] * scale, seconds[1] * scale, seconds[2] * scale, seconds[3] * scale, seconds[4] * scale);
+}
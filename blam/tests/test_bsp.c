@@ -0,0 +1,430 @@
+#include "test_bsp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// INTERNAL DECLARATIONS, STRUCTURES, ENUMS
+
+/**
+ * \brief The most nodes up the path of a leaf.
+ */
+#define TEST_MAX_DEPTH 0x200
+
+/**
+ * \brief A tag block being built, and the number of elements it has room for.
+ */
+struct test_block
+{
+  void  *address;
+  int    count;
+  int    capacity;
+  size_t element_size;
+};
+
+/**
+ * \brief The state of a synthetic BSP being made.
+ */
+struct test_builder
+{
+  uint64_t state; ///< The state of the random number generator.
+  int      depth; ///< The depth of the BSP3D.
+  bool     chain; ///< See #test_bsp_make.
+
+  struct test_block nodes;
+  struct test_block planes;
+  struct test_block leaves;
+  struct test_block references;
+  struct test_block bsp2d_nodes;
+  struct test_block surfaces;
+  struct test_block edges;
+  struct test_block vertices;
+
+  int path[TEST_MAX_DEPTH]; ///< The planes up the path of the current node.
+  int path_length;          ///< The number of planes in #path.
+};
+
+static
+float test_random_real(uint64_t *state, float lower, float upper);
+
+static
+int test_random_index(uint64_t *state, int count);
+
+static
+int test_block_add(struct test_block *block);
+
+static
+void *test_block_get(const struct test_block *block, int index);
+
+static
+void test_normalize(float *components, int count);
+
+static
+int test_make_plane(struct test_builder *builder);
+
+static
+int test_make_surface(struct test_builder *builder, int plane_index);
+
+static
+blam_index_long test_make_bsp2d(struct test_builder *builder, int plane_index, int depth);
+
+static
+blam_index_long test_make_leaf(struct test_builder *builder);
+
+static
+blam_index_long test_make_node(struct test_builder *builder, int depth);
+
+// -----------------------------------------------------------------------------
+// EXPOSED API
+
+void test_bsp_make(
+  struct test_bsp *const bsp,
+  const uint64_t         seed,
+  const int              depth,
+  const bool             chain)
+{
+  struct test_builder builder =
+  {
+    .state       = seed * 0x9E3779B97F4A7C15ull + 0x3039,
+    .depth       = depth < TEST_MAX_DEPTH ? depth : TEST_MAX_DEPTH - 1,
+    .chain       = chain,
+    .nodes       = { .element_size = sizeof(struct blam_bsp3d_node) },
+    .planes      = { .element_size = sizeof(blam_plane3d) },
+    .leaves      = { .element_size = sizeof(struct blam_bsp3d_leaf) },
+    .references  = { .element_size = sizeof(struct blam_bsp2d_reference) },
+    .bsp2d_nodes = { .element_size = sizeof(struct blam_bsp2d_node) },
+    .surfaces    = { .element_size = sizeof(struct blam_collision_surface) },
+    .edges       = { .element_size = sizeof(struct blam_collision_edge) },
+    .vertices    = { .element_size = sizeof(struct blam_collision_vertex) },
+  };
+
+  // The root is always a node.
+  test_make_node(&builder, 0);
+
+  memset(bsp, 0, sizeof(*bsp));
+  bsp->nodes       = builder.nodes.address;
+  bsp->planes      = builder.planes.address;
+  bsp->leaves      = builder.leaves.address;
+  bsp->references  = builder.references.address;
+  bsp->bsp2d_nodes = builder.bsp2d_nodes.address;
+  bsp->surfaces    = builder.surfaces.address;
+  bsp->edges       = builder.edges.address;
+  bsp->vertices    = builder.vertices.address;
+
+  bsp->bsp.bsp3d_nodes      = (struct blam_tag_block){ builder.nodes.count,       bsp->nodes,       NULL };
+  bsp->bsp.planes           = (struct blam_tag_block){ builder.planes.count,      bsp->planes,      NULL };
+  bsp->bsp.leaves           = (struct blam_tag_block){ builder.leaves.count,      bsp->leaves,      NULL };
+  bsp->bsp.bsp2d.references = (struct blam_tag_block){ builder.references.count,  bsp->references,  NULL };
+  bsp->bsp.bsp2d.nodes      = (struct blam_tag_block){ builder.bsp2d_nodes.count, bsp->bsp2d_nodes, NULL };
+  bsp->bsp.surfaces         = (struct blam_tag_block){ builder.surfaces.count,    bsp->surfaces,    NULL };
+  bsp->bsp.edges            = (struct blam_tag_block){ builder.edges.count,       bsp->edges,       NULL };
+  bsp->bsp.vertices         = (struct blam_tag_block){ builder.vertices.count,    bsp->vertices,    NULL };
+}
+
+void test_bsp_destroy(struct test_bsp *const bsp)
+{
+  free(bsp->nodes);
+  free(bsp->planes);
+  free(bsp->leaves);
+  free(bsp->references);
+  free(bsp->bsp2d_nodes);
+  free(bsp->surfaces);
+  free(bsp->edges);
+  free(bsp->vertices);
+  memset(bsp, 0, sizeof(*bsp));
+}
+
+void test_vector_make(uint64_t *const state, struct test_vector *const vector)
+{
+  // Scales outside of [0, 1] are clamped by the tests, and a third of the vectors
+  // are short so that they often end within the leaf they start in.
+  static const blam_real scales[] = { 1.0f, 1.0f, 0.5f, 1.5f, -0.5f, 0.0f, 0.999f };
+  const blam_real length = test_random_index(state, 3) == 0 ? 1.0f : 0.1f;
+
+  for (int c = 0; c < 3; ++c)
+  {
+    vector->origin.components[c] = test_random_real(state, -10.0f, 10.0f);
+    vector->delta.components[c]  = test_random_real(state, -20.0f, 20.0f) * length;
+  }
+  vector->max_scale = scales[test_random_index(state, sizeof(scales) / sizeof(scales[0]))];
+  vector->flags     = test_random(state) & 0x1F;
+}
+
+uint32_t test_random(uint64_t *const state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return (uint32_t)(*state >> 11);
+}
+
+// -----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS
+
+static
+float test_random_real(uint64_t *const state, const float lower, const float upper)
+{
+  return lower + (upper - lower) * (float)(test_random(state) % 1000001) / 1000000.0f;
+}
+
+static
+int test_random_index(uint64_t *const state, const int count)
+{
+  return (int)(test_random(state) % (uint32_t)count);
+}
+
+static
+int test_block_add(struct test_block *const block)
+{
+  if (block->count == block->capacity)
+  {
+    block->capacity = block->capacity != 0 ? block->capacity * 2 : 0x40;
+    block->address  = realloc(block->address, block->capacity * block->element_size);
+    if (block->address == NULL)
+    {
+      fputs("out of memory\n", stderr);
+      exit(EXIT_FAILURE);
+    }
+  }
+  return block->count++;
+}
+
+static
+void *test_block_get(const struct test_block *const block, const int index)
+{
+  return (char*)block->address + index * block->element_size;
+}
+
+static
+void test_normalize(float *const components, const int count)
+{
+  float length = 0.0f;
+  for (int c = 0; c < count; ++c)
+    length += components[c] * components[c];
+  length = sqrtf(length) + 1.0e-6f;
+
+  for (int c = 0; c < count; ++c)
+    components[c] /= length;
+}
+
+static
+int test_make_plane(struct test_builder *const builder)
+{
+  uint64_t *const state = &builder->state;
+
+  blam_plane3d plane;
+  const int kind = test_random_index(state, 10);
+  if (builder->planes.count > 0 && kind < 3)
+  {
+    // Nearly coplanar with an existing plane, and maybe opposite it.
+    plane = *(const blam_plane3d*)test_block_get(&builder->planes, test_random_index(state, builder->planes.count));
+    for (int c = 0; c < 3; ++c)
+      plane.normal.components[c] += test_random_real(state, -0.05f, 0.05f);
+    test_normalize(plane.normal.components, 3);
+    plane.d += test_random_real(state, -0.02f, 0.02f);
+
+    if (test_random_index(state, 2) != 0)
+    {
+      for (int c = 0; c < 3; ++c)
+        plane.normal.components[c] = -plane.normal.components[c];
+      plane.d = -plane.d;
+    }
+  } else if (kind < 6)
+  {
+    // Axis-aligned.
+    memset(&plane, 0, sizeof(plane));
+    plane.normal.components[test_random_index(state, 3)] = test_random_index(state, 2) != 0 ? 1.0f : -1.0f;
+    plane.d = test_random_real(state, -8.0f, 8.0f);
+  } else
+  {
+    for (int c = 0; c < 3; ++c)
+      plane.normal.components[c] = test_random_real(state, -1.0f, 1.0f);
+    test_normalize(plane.normal.components, 3);
+    plane.d = test_random_real(state, -6.0f, 6.0f);
+  }
+
+  const int plane_index = test_block_add(&builder->planes);
+  *(blam_plane3d*)test_block_get(&builder->planes, plane_index) = plane;
+  return plane_index;
+}
+
+static
+int test_make_surface(struct test_builder *const builder, const int plane_index)
+{
+  uint64_t *const state = &builder->state;
+  const blam_plane3d plane = *(const blam_plane3d*)test_block_get(&builder->planes, plane_index);
+
+  // A basis of the plane.
+  const float *const n = plane.normal.components;
+  float a[3] = { 1.0f, 0.0f, 0.0f };
+  if (fabsf(n[0]) > 0.8f)
+  {
+    a[0] = 0.0f;
+    a[1] = 1.0f;
+  }
+  float u[3] = { n[1] * a[2] - n[2] * a[1], n[2] * a[0] - n[0] * a[2], n[0] * a[1] - n[1] * a[0] };
+  test_normalize(u, 3);
+  const float v[3] = { n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0] };
+
+  // A convex polygon about a random center, wound either way.
+  const float cx     = test_random_real(state, -6.0f, 6.0f);
+  const float cy     = test_random_real(state, -6.0f, 6.0f);
+  const float radius = test_random_real(state, 2.0f, 9.0f);
+  const float winding = test_random_index(state, 2) != 0 ? 1.0f : -1.0f;
+  const int vertex_count = 3 + test_random_index(state, 3);
+
+  const int surface_index = test_block_add(&builder->surfaces);
+  const int first_edge    = builder->edges.count;
+  const int first_vertex  = builder->vertices.count;
+  for (int i = 0; i < vertex_count; ++i)
+  {
+    const float angle = winding * (float)i * 6.2831853f / (float)vertex_count + test_random_real(state, -0.2f, 0.2f);
+    const float x = cx + radius * cosf(angle);
+    const float y = cy + radius * sinf(angle);
+
+    struct blam_collision_vertex *const vertex = test_block_get(&builder->vertices, test_block_add(&builder->vertices));
+    for (int c = 0; c < 3; ++c)
+      vertex->point.components[c] = n[c] * plane.d + u[c] * x + v[c] * y;
+    vertex->first_edge = first_edge + i;
+  }
+  for (int i = 0; i < vertex_count; ++i)
+  {
+    struct blam_collision_edge *const edge = test_block_get(&builder->edges, test_block_add(&builder->edges));
+    edge->vertices[0] = first_vertex + i;
+    edge->vertices[1] = first_vertex + (i + 1) % vertex_count;
+    edge->edges[0]    = first_edge + (i + 1) % vertex_count;
+    edge->edges[1]    = -1;
+    edge->surfaces[0] = surface_index;
+    edge->surfaces[1] = -1;
+  }
+
+  // Some surfaces are two-sided (0x01), invisible (0x02) or breakable (0x08).
+  blam_flags_byte flags = 0;
+  if (test_random_index(state, 10) == 0)
+    flags |= 0x02;
+  if (test_random_index(state, 8) == 0)
+    flags |= 0x08;
+  if (test_random_index(state, 10) == 0)
+    flags |= 0x01;
+
+  struct blam_collision_surface *const surface = test_block_get(&builder->surfaces, surface_index);
+  surface->plane             = plane_index;
+  surface->first_edge        = first_edge;
+  surface->flags             = flags;
+  surface->breakable_surface = (blam_index_byte)test_random_index(state, 12);
+  surface->material          = (blam_index_short)test_random_index(state, 30);
+  return surface_index;
+}
+
+static
+blam_index_long test_make_bsp2d(
+  struct test_builder *const builder,
+  const int                  plane_index,
+  const int                  depth)
+{
+  uint64_t *const state = &builder->state;
+
+  if (depth <= 0 || test_random_index(state, 3) == 0)
+  {
+    if (test_random_index(state, 12) == 0)
+      return -1;
+
+    // Some leaves share a surface made for another plane.
+    const int surface_index = test_random_index(state, 4) == 0 && builder->surfaces.count > 0
+      ? test_random_index(state, builder->surfaces.count)
+      : test_make_surface(builder, plane_index);
+    return (blam_index_long)(0x80000000u | (uint32_t)surface_index);
+  }
+
+  const int node_index = test_block_add(&builder->bsp2d_nodes);
+  struct blam_bsp2d_node node;
+  node.plane.normal.components[0] = test_random_real(state, -1.0f, 1.0f);
+  node.plane.normal.components[1] = test_random_real(state, -1.0f, 1.0f);
+  test_normalize(node.plane.normal.components, 2);
+  node.plane.d     = test_random_real(state, -5.0f, 5.0f);
+  node.children[0] = test_make_bsp2d(builder, plane_index, depth - 1);
+  node.children[1] = test_make_bsp2d(builder, plane_index, depth - 1);
+  *(struct blam_bsp2d_node*)test_block_get(&builder->bsp2d_nodes, node_index) = node;
+  return node_index;
+}
+
+static
+blam_index_long test_make_leaf(struct test_builder *const builder)
+{
+  uint64_t *const state = &builder->state;
+
+  struct blam_bsp3d_leaf leaf;
+  leaf.flags           = test_random_index(state, 5) == 0 ? 1 : 0;
+  leaf.first_reference = builder->references.count;
+
+  // References for about half of the nearest planes up the path, some of them
+  // flipped, and sometimes one for an unrelated plane.
+  int reference_count = 0;
+  for (int i = builder->path_length - 1; i >= 0 && reference_count < 8; --i)
+  {
+    if (test_random_index(state, 100) < 45)
+      continue;
+
+    const int plane_index = builder->path[i];
+    struct blam_bsp2d_reference reference;
+    reference.plane = test_random_index(state, 3) == 0
+      ? (blam_index_long)(0x80000000u | (uint32_t)plane_index)
+      : plane_index;
+    reference.root_node = test_make_bsp2d(builder, plane_index, 2);
+    *(struct blam_bsp2d_reference*)test_block_get(&builder->references, test_block_add(&builder->references)) = reference;
+    ++reference_count;
+  }
+  if (test_random_index(state, 4) == 0)
+  {
+    const int plane_index = test_random_index(state, builder->planes.count);
+    struct blam_bsp2d_reference reference;
+    reference.plane     = plane_index;
+    reference.root_node = test_make_bsp2d(builder, plane_index, 1);
+    *(struct blam_bsp2d_reference*)test_block_get(&builder->references, test_block_add(&builder->references)) = reference;
+    ++reference_count;
+  }
+  leaf.reference_count = (blam_short)reference_count;
+
+  const int leaf_index = test_block_add(&builder->leaves);
+  *(struct blam_bsp3d_leaf*)test_block_get(&builder->leaves, leaf_index) = leaf;
+  return (blam_index_long)(0x80000000u | (uint32_t)leaf_index);
+}
+
+static
+blam_index_long test_make_node(struct test_builder *const builder, const int depth)
+{
+  uint64_t *const state = &builder->state;
+
+  if (depth > 0)
+  {
+    if (depth >= builder->depth || (depth > 2 && !builder->chain && test_random_index(state, 6) == 0))
+      return test_random_index(state, 3) == 0 ? -1 : test_make_leaf(builder);
+  }
+
+  const int node_index  = test_block_add(&builder->nodes);
+  const int plane_index = builder->planes.count > 4 && test_random_index(state, 4) == 0
+    ? test_random_index(state, builder->planes.count)
+    : test_make_plane(builder);
+  builder->path[builder->path_length++] = plane_index;
+
+  blam_index_long children[2];
+  if (builder->chain && depth > 0)
+  {
+    const int side = test_random_index(state, 2);
+    children[!side] = test_random_index(state, 3) == 0 ? -1 : test_make_leaf(builder);
+    children[side]  = test_make_node(builder, depth + 1);
+  } else
+  {
+    children[0] = test_make_node(builder, depth + 1);
+    children[1] = test_make_node(builder, depth + 1);
+  }
+  --builder->path_length;
+
+  struct blam_bsp3d_node *const node = test_block_get(&builder->nodes, node_index);
+  node->plane       = plane_index;
+  node->children[0] = children[0];
+  node->children[1] = children[1];
+  return node_index;
+}
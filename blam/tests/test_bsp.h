@@ -0,0 +1,72 @@
+#ifndef BLAM_TEST_BSP_H
+#define BLAM_TEST_BSP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "blam/collision_bsp.h"
+
+// Synthetic collision BSPs for the tests. They are not sealed worlds: leaves are
+// flagged interior at random and get BSP2D references for only some of the planes
+// up their path, so BSP leaks and phantom BSP are common, and surfaces are shared
+// and overlap. Every index is valid, so any query may be made against them.
+
+/**
+ * \brief A collision BSP with the tag blocks it owns.
+ */
+struct test_bsp
+{
+  struct blam_collision_bsp bsp; ///< The BSP, pointing into the blocks below.
+
+  struct blam_bsp3d_node       *nodes;
+  blam_plane3d                 *planes;
+  struct blam_bsp3d_leaf       *leaves;
+  struct blam_bsp2d_reference  *references;
+  struct blam_bsp2d_node       *bsp2d_nodes;
+  struct blam_collision_surface *surfaces;
+  struct blam_collision_edge   *edges;
+  struct blam_collision_vertex *vertices;
+};
+
+/**
+ * \brief A vector to test against a synthetic BSP.
+ */
+struct test_vector
+{
+  blam_real3d     origin;
+  blam_real3d     delta;
+  blam_real       max_scale;
+  blam_flags_long flags; // enum blam_collision_test_flags
+};
+
+/**
+ * \brief Makes a synthetic collision BSP.
+ *
+ * \param [out] bsp   The BSP.
+ * \param [in]  seed  Selects the BSP; the same seed always makes the same one.
+ * \param [in]  depth The depth of the BSP3D.
+ * \param [in]  chain If `true`, every node has a leaf or nothing on one side, so
+ *                    that the BSP3D is as deep as \a depth and leaks are resolved
+ *                    up long paths.
+ */
+void test_bsp_make(struct test_bsp *bsp, uint64_t seed, int depth, bool chain);
+
+/**
+ * \brief Releases the blocks of a synthetic collision BSP.
+ */
+void test_bsp_destroy(struct test_bsp *bsp);
+
+/**
+ * \brief Makes a vector to test against the synthetic BSPs.
+ *
+ * \param [in,out] state The state of the random number generator.
+ * \param [out]    vector The vector.
+ */
+void test_vector_make(uint64_t *state, struct test_vector *vector);
+
+/**
+ * \brief Returns the next random number of a generator.
+ */
+uint32_t test_random(uint64_t *state);
+
+#endif // BLAM_TEST_BSP_H